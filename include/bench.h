@@ -0,0 +1,48 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// 各个 benchmark 场景，与 main.cpp 中的示例一样在 main() 里按需打开
+// 都会创建一个隐藏窗口以获得 GL context，结果输出到 stdout
+
+// light() 每帧 uniform 上传的 CPU 开销：按名字查询 vs 预解析句柄 vs Lighting uniform block
+void bench_uniforms();
+// clustered forward 光照：灯数从 4 扫到 4096，对比 cluster 遍历与逐片段遍历所有灯
+void bench_clustered();
+// 前向与延迟渲染：overdraw 层数与点光源数同时增长时的帧时间
+void bench_deferred();
+// 实例化：1k/10k/100k 个箱子，逐物体 glDrawArrays 对比单次 glDrawArraysInstanced
+void bench_instancing();
+// 法线矩阵：CPU 端标量 / SSE / 等比缩放快速路径的耗时，以及高面数网格上逐顶点求逆的顶点吞吐对比
+void bench_normal_matrix();
+// 64 个 program 的启动耗时：逐个同步编译 vs 一次性提交后异步等待 (GL_KHR_parallel_shader_compile)
+void bench_shader_compile();
+// light.fs 的特化版本 (去掉聚光灯、高光贴图、部分点光源) 的片段开销，以及 variant 缓存的命中
+void bench_shader_variants();
+// 4096 个随机材质的物体：按提交顺序逐个绘制 vs 64 位 key 基数排序后的渲染队列，状态切换次数与 CPU 提交耗时
+void bench_render_queue();
+// 64 张纹理：渲染线程同步解码上传 vs 工作线程解码、按每帧字节预算上传，客户端内存直接上传 vs PBO ring
+void bench_texture_streaming();
+// light() 的纹理启动耗时：stb_image 解码 + glGenerateMipmap vs 映射预烘焙 mip 链的 .ltex，冷/热 page cache
+void bench_texture_bake();
+// BC1/BC3/BC4/BC5 编码：PSNR、压缩后大小、单线程与多线程编码吞吐，以及 glCompressedTexImage2D 上传
+void bench_block_compression();
+// CPU mip 链生成：box/Kaiser、线性/sRGB 下 SIMD 与标量实现的 MPix/s，以及驱动 glGenerateMipmap 的对照
+void bench_mip_generation();
+// 64/256/1024 种材质的 4096 个箱子：每材质独立 2D 纹理 + 排序队列 vs texture array 一次实例化绘制
+void bench_texture_array();
+// 256 个材质槽引用同一图像的不同路径写法与内容相同的拷贝：无缓存 vs 引用计数缓存的纹理数、显存与命中率
+void bench_texture_cache();
+// 128 张 1024x1024 贴图的走廊飞行：不同显存预算下的驻留峰值、每帧上传耗时、帧时间尾部与欠采样的纹理数
+void bench_texture_residency();
+// 焊接重复顶点：立方体与展开的球面焊接前后的顶点数、显存，glDrawArrays 与 glDrawElements 的顶点着色器调用次数
+void bench_mesh_welding();
+// 索引缓冲的三角形与顶点重排：各步骤前后的 ACMR/ATVR、顶点读取量，以及顶点着色器调用次数与 overdraw
+void bench_mesh_optimization();
+// 高面数网格的 32/16/12 字节顶点布局：量化误差、顶点缓冲大小与顶点吞吐
+void bench_vertex_formats();
+// 约 380 MB 的 OBJ：getline + istringstream vs mmap + from_chars 分块并行解析的 MB/s (冷/热、1..N 线程)，以及 .glb
+void bench_mesh_import();
+// 同一 OBJ 的启动路径：解析 + 优化 + 量化 vs 映射 .lmesh 直接 glBufferData，冷/热耗时、LOD 表，与只读文件对照
+void bench_mesh_cache();
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef BLOCK_COMPRESS_H
+#define BLOCK_COMPRESS_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// S3TC (GL_EXT_texture_compression_s3tc) 不是核心功能，不在 glad 生成的范围内，常量手动补上
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+constexpr GLenum GL_COMPRESSED_RGB_S3TC_DXT1_EXT = 0x83F0;
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+constexpr GLenum GL_COMPRESSED_RGBA_S3TC_DXT5_EXT = 0x83F3;
+#endif
+
+// 4x4 块压缩格式
+//   BC1 (DXT1)：RGB，两个 565 端点 + 16 个 2 bit 索引，每块 8 字节
+//   BC3 (DXT5)：RGBA，BC4 编码的 alpha 块 + BC1 颜色块，每块 16 字节
+//   BC4 (RGTC1)：单通道，两个 8 bit 端点 + 16 个 3 bit 索引，每块 8 字节
+//   BC5 (RGTC2)：两个 BC4 块分别存 R 与 G，用于法线贴图的 XY，每块 16 字节
+enum class BlockFormat { BC1, BC3, BC4, BC5 };
+
+struct BlockFormatInfo {
+    GLenum internalFormat;
+    GLenum format;  // 解压后的像素格式，驱动不支持该压缩格式时用它上传解压结果
+    uint32_t blockBytes;
+    uint32_t channels;  // 保存的通道数
+    const char *name;
+};
+
+const BlockFormatInfo &block_format_info(BlockFormat format);
+std::optional<BlockFormat> block_format_from_gl(GLenum internalFormat);
+// 按源图像通道数选择：1 → BC4，2 → BC5，3 → BC1，4 → BC3
+BlockFormat block_format_for(uint32_t channels);
+size_t compressed_size(BlockFormat format, uint32_t width, uint32_t height);
+// 需要当前 context；RGTC (BC4/BC5) 从 GL 3.0 起是核心功能，S3TC 需要扩展，结果只查询一次
+bool block_format_supported(BlockFormat format);
+
+// 压缩 width x height、每像素 channels 字节的图像，源图像的前几个通道依次对应 R/G/B/A，
+// 单通道图像复制到 RGB；不足 4 像素的边缘块重复最后一行/列
+// 按块行分给 threads 个线程 (含调用线程)，为 0 时使用硬件线程数
+std::vector<uint8_t> compress_blocks(const uint8_t *pixels, uint32_t width, uint32_t height,
+                                     uint32_t channels, BlockFormat format, uint32_t threads = 0);
+// 解压为每像素 block_format_info(format).channels 字节
+std::vector<uint8_t> decompress_blocks(const uint8_t *blocks, uint32_t width, uint32_t height,
+                                       BlockFormat format);
+// 两幅图像共有的前 min(aChannels, bChannels) 个通道的 PSNR (dB)，完全相同时为无穷大
+double psnr(const uint8_t *a, uint32_t aChannels, const uint8_t *b, uint32_t bChannels,
+            uint32_t width, uint32_t height);
+
+#endif
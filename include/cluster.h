@@ -0,0 +1,66 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "lighting.h"
+#include "shader.h"
+
+// 视锥体在屏幕 x/y 上均匀划分，在深度方向上按指数划分，
+// 与 shader/light_clustered.fs 中的 CLUSTER_X/Y/Z 保持一致
+constexpr uint32_t CLUSTER_X = 16;
+constexpr uint32_t CLUSTER_Y = 9;
+constexpr uint32_t CLUSTER_Z = 24;
+constexpr uint32_t CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+
+// clustered forward 光照使用的纹理单元，0/1 留给 material.diffuse/specular
+constexpr uint32_t CLUSTER_LIGHTS_UNIT = 2;
+constexpr uint32_t CLUSTER_GRID_UNIT = 3;
+constexpr uint32_t CLUSTER_INDICES_UNIT = 4;
+
+// 把任意数量的点光源分配到视锥体的 3D cluster 中，结果放在 3 个 texture buffer 里：
+//   clusterLights  : 所有点光源，每个 4 个 RGBA32F texel
+//   clusterGrid    : 每个 cluster 的 (offset, count)
+//   clusterIndices : 所有 cluster 的光源下标首尾相接
+// GL 3.3 core 没有 SSBO，texture buffer 是能在片段着色器中随机读取大数组的最低要求
+class ClusterGrid {
+public:
+    ClusterGrid(float zNear, float zFar);
+
+    // 设置 light_clustered.fs 中与视锥体划分相关的常量以及 sampler 的纹理单元
+    void attach(const Shader &shader, uint32_t screenWidth, uint32_t screenHeight) const;
+    // 帧缓冲大小变化后调用，片段的 tile 由 gl_FragCoord 除以这个大小得到
+    void resize(const Shader &shader, uint32_t screenWidth, uint32_t screenHeight) const;
+    // 在 CPU 上把 lights 分配到 cluster 并上传，每帧或者灯光/摄像机变化时调用
+    // fovy 为弧度，与构造 projection 矩阵时使用的参数一致
+    void update(const std::vector<PointLight> &lights, const glm::mat4 &view, float fovy,
+                float aspect);
+    // 绑定 3 个 texture buffer 到各自的纹理单元
+    void bind() const;
+    // 释放所有 GL 对象，需在 glfwTerminate() 之前调用
+    void release();
+
+    // 上一次 update() 写入的光源下标总数，用来观察 cluster 的平均负载
+    size_t index_count() const { return indices_.size(); }
+
+private:
+    float zNear_;
+    float zFar_;
+    uint32_t buffers_[3];
+    uint32_t textures_[3];
+
+    // 每个光源覆盖的 cluster 范围，update() 中两遍遍历共用
+    struct ClusterRange {
+        uint16_t x0, x1, y0, y1, z0, z1;
+    };
+    std::vector<ClusterRange> ranges_;
+    std::vector<uint32_t> grid_;
+    std::vector<uint32_t> indices_;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef DEFERRED_H
+#define DEFERRED_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "lighting.h"
+#include "shader.h"
+
+// 渲染路径，在启动时选择
+enum class RenderPath { Forward, Deferred };
+
+// G-buffer 与光照 pass 使用的纹理单元
+constexpr uint32_t GBUFFER_ALBEDO_SPEC_UNIT = 0;
+constexpr uint32_t GBUFFER_NORMAL_UNIT = 1;
+constexpr uint32_t GBUFFER_DEPTH_UNIT = 2;
+constexpr uint32_t DEFERRED_LIGHTS_UNIT = 3;
+
+// 延迟渲染：几何 pass 把材质与法线写入 G-buffer，
+// 光照 pass 先用全屏三角形计算方向光与聚光灯，再把每个点光源画成一个光体积累加上去。
+// 光照计算与前向渲染共用 lighting.glsl 中的 Calc*Light
+class DeferredRenderer {
+public:
+    DeferredRenderer(uint32_t width, uint32_t height);
+
+    // 光照 pass 从 Lighting uniform block 读取方向光、聚光灯与 viewPos
+    void attach(const LightingBuffer &lighting) const;
+    // 上传点光源，只在灯光变化时调用；radius 决定光体积的大小
+    void set_point_lights(const std::vector<PointLight> &lights);
+    // 目标 framebuffer 大小变化后调用：重新分配 G-buffer 并更新光照 pass 的 screenSize
+    void resize(uint32_t width, uint32_t height);
+    // 绑定 G-buffer 并清除，之后用 gbuffer.fs 绘制所有不透明物体
+    void begin_geometry() const;
+    // 执行光照 pass，结果写入 targetFbo，并把 G-buffer 的深度拷贝过去供之后的前向绘制使用
+    // targetFbo 必须与 G-buffer 同样大小，返回时视口覆盖整个目标
+    void resolve(const glm::mat4 &view, const glm::mat4 &projection, float shininess,
+                 uint32_t targetFbo = 0) const;
+    // 释放所有 GL 对象，需在 glfwTerminate() 之前调用
+    void release();
+
+private:
+    uint32_t width_;
+    uint32_t height_;
+    uint32_t fbo_;
+    uint32_t albedoSpec_;
+    uint32_t normal_;
+    uint32_t depth_;
+
+    uint32_t emptyVao_;
+    uint32_t volumeVao_;
+    uint32_t volumeVbo_;
+    uint32_t volumeEbo_;
+    uint32_t lightBuffer_;
+    uint32_t lightTexture_;
+    uint32_t lightCount_;
+
+    Shader ambientPass_;
+    Shader pointPass_;
+    Uniform<glm::mat4> ambientInvViewProjection_;
+    Uniform<float> ambientShininess_;
+    Uniform<glm::mat4> pointInvViewProjection_;
+    Uniform<glm::mat4> pointViewProjection_;
+    Uniform<float> pointShininess_;
+};
+
+#endif
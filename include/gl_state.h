@@ -0,0 +1,96 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string_view>
+
+// GL 状态的影子副本：调用前先与记录的当前值比较，相同则不再交给驱动
+// 只对经过这里的调用有效，所以程序里所有的 program/VAO/buffer/纹理/开关/视口绑定都应走这里；
+// 新建 context 之后或者第三方代码直接改过状态之后调用 invalidate()
+class GLState {
+public:
+    // 每帧的调用统计，filtered 为被判定为冗余而没有发出的调用
+    struct Counters {
+        uint32_t issued = 0;
+        uint32_t filtered = 0;
+    };
+
+    GLState();
+
+    void use_program(uint32_t program);
+    // ELEMENT_ARRAY_BUFFER 的绑定属于 VAO，切换 VAO 时它的影子会被作废
+    void bind_vertex_array(uint32_t vao);
+    void bind_buffer(GLenum target, uint32_t buffer);
+    // glBindBufferBase 同时改变 target 的通用绑定点
+    void bind_buffer_base(GLenum target, uint32_t index, uint32_t buffer);
+    // 绘制用：把 texture 绑定到 unit，必要时切换 active texture
+    void bind_texture(uint32_t unit, GLenum target, uint32_t texture);
+    // 修改纹理用 (glTexImage2D 等)：绑定到当前 active unit，不切换 unit
+    void edit_texture(GLenum target, uint32_t texture);
+    void bind_framebuffer(GLenum target, uint32_t framebuffer);
+
+    void enable(GLenum capability);
+    void disable(GLenum capability);
+    void blend_func(GLenum source, GLenum destination);
+    void cull_face(GLenum mode);
+    void depth_mask(bool enabled);
+    void viewport(int32_t x, int32_t y, int32_t width, int32_t height);
+
+    // 删除对象前先从影子里清掉，否则名字被复用后新对象的绑定会被误判为冗余
+    void delete_textures(int32_t count, const uint32_t *textures);
+    void delete_buffers(int32_t count, const uint32_t *buffers);
+    // 删除当前绑定的 VAO/FBO 时 GL 把绑定恢复为 0，影子随之更新
+    void delete_vertex_arrays(int32_t count, const uint32_t *vertexArrays);
+    void delete_framebuffers(int32_t count, const uint32_t *framebuffers);
+
+    // 所有影子置为未知，下一次调用一定会发出
+    void invalidate();
+
+    // 当前帧的统计
+    const Counters &frame() const { return frame_; }
+    // 上一帧的统计，由 end_frame() 滚动
+    const Counters &last_frame() const { return lastFrame_; }
+    void end_frame();
+
+private:
+    static constexpr uint32_t UNKNOWN = 0xFFFFFFFFu;
+    static constexpr uint32_t MAX_UNITS = 16;
+    static constexpr uint32_t TEXTURE_TARGETS = 4;
+    static constexpr uint32_t BUFFER_TARGETS = 6;
+    static constexpr uint32_t CAPABILITIES = 5;
+    static constexpr uint32_t UNIFORM_BINDINGS = 16;
+
+    uint32_t program_;
+    uint32_t vertexArray_;
+    uint32_t buffers_[BUFFER_TARGETS];
+    uint32_t uniformBindings_[UNIFORM_BINDINGS];
+    uint32_t activeUnit_;
+    uint32_t textures_[MAX_UNITS][TEXTURE_TARGETS];
+    uint32_t drawFramebuffer_;
+    uint32_t readFramebuffer_;
+    // 0 关闭、1 打开、UNKNOWN 未知
+    uint32_t capabilities_[CAPABILITIES];
+    uint32_t blendSource_;
+    uint32_t blendDestination_;
+    uint32_t cullFace_;
+    uint32_t depthMask_;
+    int32_t viewport_[4];
+    bool viewportKnown_;
+
+    Counters frame_;
+    Counters lastFrame_;
+
+    // 比较并更新影子，返回是否需要真正发出调用
+    bool update(uint32_t &shadow, uint32_t value);
+    void set_capability(GLenum capability, bool enabled);
+};
+
+// 当前 context 的状态影子
+GLState &gl_state();
+
+// 当前 context 是否支持扩展 name，逐个比较 glGetStringi 的结果，不要每帧调用
+bool has_extension(std::string_view name);
+
+#endif
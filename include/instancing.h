@@ -0,0 +1,68 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// 每实例的 model 矩阵占用 4 个连续的 vec4 属性位置，
+// 与 coordinate.vs / light.vs / light_cube.vs 中的 layout (location = 3) in mat4 aModel 对应
+constexpr uint32_t INSTANCE_MODEL_LOCATION = 3;
+// 法线矩阵紧随其后占用 3 个属性位置，对应 light.vs 中的 layout (location = 7) in mat3 aNormalMatrix
+constexpr uint32_t INSTANCE_NORMAL_LOCATION = INSTANCE_MODEL_LOCATION + 4;
+
+// 调用方对一批 model 矩阵的保证，决定法线矩阵的求法
+enum class TransformKind {
+    General,       // 任意仿射变换，法线矩阵为左上 3x3 的逆转置
+    UniformScale,  // 只含旋转、平移与等比缩放，左上 3x3 与逆转置只差一个常数倍，直接拿来用
+};
+
+// 实例缓冲中的一项，法线矩阵的每一列补齐为 vec4，便于 SIMD 整列读写
+struct alignas(16) InstanceData {
+    glm::mat4 model;
+    glm::vec4 normal[3];
+};
+static_assert(sizeof(InstanceData) == 112);
+
+// 由 model 矩阵求出每个实例的法线矩阵，General 每次用 SSE 同时处理 4 个矩阵
+void build_instances(const glm::mat4 *models, size_t count, TransformKind kind,
+                     InstanceData *instances);
+// 逐个 glm::inverse 的标量实现，只用作 benchmark 的对照
+void build_instances_scalar(const glm::mat4 *models, size_t count, InstanceData *instances);
+
+// 保存每实例 model 与法线矩阵的 GL_ARRAY_BUFFER，配合 glDrawArraysInstanced 一次绘制整批物体
+class InstanceBuffer {
+public:
+    uint32_t id_;
+
+    // 与 Shader 一样不在析构时释放，由调用方在 glfwTerminate() 之前 glDeleteBuffers
+    InstanceBuffer();
+
+    // 把 model 与法线矩阵接到 vao 的 INSTANCE_MODEL_LOCATION 起 7 个属性上，每个实例前进一次
+    void attach(uint32_t vao) const;
+    // 上传 count 个 model 矩阵及其法线矩阵；超出已有容量时重新分配，否则原地覆盖
+    void upload(const glm::mat4 *models, size_t count, TransformKind kind = TransformKind::General);
+    void upload(const std::vector<glm::mat4> &models, TransformKind kind = TransformKind::General)
+    {
+        upload(models.data(), models.size(), kind);
+    }
+
+    size_t count() const { return count_; }
+
+private:
+    size_t count_ = 0;
+    size_t capacity_ = 0;
+    // 复用的暂存区，避免每次 upload 分配内存
+    std::vector<InstanceData> staging_;
+};
+
+// light() 场景中第 i 个箱子的 model 矩阵
+glm::mat4 cube_model(uint32_t i);
+// 以原点为中心、间距为 spacing 的 3D 网格上摆放 count 个随机朝向的箱子
+std::vector<glm::mat4> cube_field(uint32_t count, float spacing = 2.0f, uint32_t seed = 1);
+
+#endif
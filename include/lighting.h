@@ -0,0 +1,138 @@
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "shader.h"
+
+// 与 shader/lighting.glsl 中的 NR_POINT_LIGHTS 保持一致
+constexpr uint32_t NR_POINT_LIGHTS = 4;
+// Lighting uniform block 使用的绑定点，所有 program 都映射到这里
+constexpr uint32_t LIGHTING_BINDING = 0;
+
+// 以下结构体是 lighting.glsl 中 std140 布局的 C++ 镜像
+// std140 下 vec3 按 16 字节对齐，所以 vec3 后面紧跟的 float 正好占用它的第 4 个分量
+struct alignas(16) DirLight {
+    glm::vec3 direction;
+    float pad0;
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+};
+
+struct alignas(16) PointLight {
+    glm::vec3 position;
+    float constant;
+    glm::vec3 ambient;
+    float linear;
+    glm::vec3 diffuse;
+    float quadratic;
+    glm::vec3 specular;
+    // std140 填充位，clustered 光照用它存放影响半径
+    float radius;
+};
+
+struct alignas(16) SpotLight {
+    glm::vec3 position;
+    float constant;
+    glm::vec3 direction;
+    float linear;
+    glm::vec3 ambient;
+    float quadratic;
+    glm::vec3 diffuse;
+    float cutOff;
+    glm::vec3 specular;
+    float outerCutOff;
+};
+
+struct alignas(16) LightBlock {
+    DirLight dirLight;
+    PointLight pointLights[NR_POINT_LIGHTS];
+    SpotLight spotLight;
+    glm::vec3 viewPos;
+    float pad0;
+};
+
+// 偏移量按 std140 规则手算，任何一项不符都意味着 GLSL 与 C++ 两侧的布局不一致
+static_assert(sizeof(glm::vec3) == 12, "lighting block assumes a tightly packed glm::vec3");
+static_assert(offsetof(DirLight, direction) == 0);
+static_assert(offsetof(DirLight, ambient) == 16);
+static_assert(offsetof(DirLight, diffuse) == 32);
+static_assert(offsetof(DirLight, specular) == 48);
+static_assert(sizeof(DirLight) == 64);
+
+static_assert(offsetof(PointLight, position) == 0);
+static_assert(offsetof(PointLight, constant) == 12);
+static_assert(offsetof(PointLight, ambient) == 16);
+static_assert(offsetof(PointLight, linear) == 28);
+static_assert(offsetof(PointLight, diffuse) == 32);
+static_assert(offsetof(PointLight, quadratic) == 44);
+static_assert(offsetof(PointLight, specular) == 48);
+static_assert(offsetof(PointLight, radius) == 60);
+static_assert(sizeof(PointLight) == 64);
+
+static_assert(offsetof(SpotLight, position) == 0);
+static_assert(offsetof(SpotLight, constant) == 12);
+static_assert(offsetof(SpotLight, direction) == 16);
+static_assert(offsetof(SpotLight, linear) == 28);
+static_assert(offsetof(SpotLight, ambient) == 32);
+static_assert(offsetof(SpotLight, quadratic) == 44);
+static_assert(offsetof(SpotLight, diffuse) == 48);
+static_assert(offsetof(SpotLight, cutOff) == 60);
+static_assert(offsetof(SpotLight, specular) == 64);
+static_assert(offsetof(SpotLight, outerCutOff) == 76);
+static_assert(sizeof(SpotLight) == 80);
+
+static_assert(offsetof(LightBlock, dirLight) == 0);
+static_assert(offsetof(LightBlock, pointLights) == 64);
+static_assert(offsetof(LightBlock, spotLight) == 64 + 64 * NR_POINT_LIGHTS);
+static_assert(offsetof(LightBlock, viewPos) == 144 + 64 * NR_POINT_LIGHTS);
+static_assert(sizeof(LightBlock) == 160 + 64 * NR_POINT_LIGHTS);
+
+// 点光源衰减到这个亮度以下即视为没有贡献
+constexpr float LIGHT_CUTOFF = 5.0f / 256.0f;
+
+// 衰减后的亮度低于 threshold 时的距离，超出这个半径的片段忽略该光源
+float point_light_radius(const PointLight &light, float threshold = LIGHT_CUTOFF);
+// 在 light() 场景的 10 个箱子周围随机撒 count 个点光源，seed 固定时结果可复现
+std::vector<PointLight> random_point_lights(uint32_t count, uint32_t seed = 1);
+
+// light() 场景的默认灯光参数；聚光灯与 viewPos 跟随摄像机，需要调用方每帧更新
+LightBlock scene_light_block(const glm::vec3 *pointLightPositions);
+
+// Lighting uniform block 对应的 UBO，构造时即绑定到 LIGHTING_BINDING，
+// 之后每帧只需一次 upload()，所有 attach 过的 program 共享同一份数据
+class LightingBuffer {
+public:
+    uint32_t id_;
+
+    // 与 Shader 一样不在析构时释放，由调用方在 glfwTerminate() 之前 glDeleteBuffers
+    LightingBuffer();
+
+    // 把 program 中名为 Lighting 的 uniform block 映射到 LIGHTING_BINDING
+    void attach(const Shader &shader) const;
+    // 单次 glBufferSubData 上传整个 block
+    void upload(const LightBlock &block) const;
+};
+
+// light.fs 中不属于 Lighting block 的逐帧 uniform
+struct LightingUniforms {
+    Uniform<float> shininess;
+    Uniform<glm::mat4> view;
+    Uniform<glm::mat4> projection;
+
+    explicit LightingUniforms(const Shader &shader)
+        : shininess(shader.uniform<float>("material.shininess")),
+          view(shader.uniform<glm::mat4>("view")),
+          projection(shader.uniform<glm::mat4>("projection"))
+    {}
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 只读映射整个文件，内容按需从 page cache 缺页载入，不经过额外的读缓冲拷贝
+// POSIX 上使用 mmap，Windows 上使用 CreateFileMapping/MapViewOfFile
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // 失败时输出错误并返回 false，空文件同样视为失败
+    bool open(const std::string &path);
+    void close();
+
+    bool is_open() const { return data_ != nullptr; }
+    const uint8_t *data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // 提前把所有页读入内存，让缺页发生在调用线程上，而不是之后使用这段内存的 GL 线程上
+    void prefetch() const;
+
+private:
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void *file_ = nullptr;
+    void *mapping_ = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "vertex_layout.h"
+
+// CPU 端的索引网格：每个顶点 components 个 float，依次紧挨着存放
+struct IndexedMesh {
+    uint32_t components = 0;
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+
+    size_t vertex_count() const { return components == 0 ? 0 : vertices.size() / components; }
+};
+
+// 把 vertexCount 个展开的顶点 (三个一组的三角形列表，每个顶点 components 个 float) 焊接为索引网格：
+// 所有分量逐位相同的顶点只保留第一次出现的那个，+0 与 -0 视为相同
+// 以开放寻址的哈希表查重，整体 O(n)；保留顶点首次出现的顺序，索引顺序与输入相同
+IndexedMesh weld_vertices(const float *vertices, size_t vertexCount, uint32_t components);
+// 已经是索引网格 (例如 uv_sphere 的输出) 时按索引展开成三角形列表，用于对照
+std::vector<float> unweld_vertices(const IndexedMesh &mesh);
+
+// 要求顶点的前 3 个分量是位置、接下来 3 个分量是法线
+// 按面积加权累加相邻三角形的法线；onlyMissing 时只替换原来为零向量的法线
+void generate_normals(IndexedMesh &mesh, bool onlyMissing);
+
+// 顶点不超过 65536 个时用 16 位索引
+GLenum index_type_for(size_t vertexCount);
+
+// 索引缓冲中的一段，各级 LOD 依次存放、共用同一个顶点缓冲
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;  // 与第 0 级相比的最大几何误差，模型空间的长度
+};
+
+// 上传到 GPU 的索引网格，glDrawElements 绘制，让相邻三角形共用的顶点命中 post-transform 缓存
+// 与 Shader 一样不在析构时释放，由调用方在 glfwTerminate() 之前 release()
+class Mesh {
+public:
+    uint32_t vao_ = 0;
+    uint32_t vbo_ = 0;
+    uint32_t ebo_ = 0;
+
+    Mesh() = default;
+    // 按 layout 量化后上传，layout.components() 等于 mesh.components
+    // optimize 时先按 mesh_optimizer.h 重排三角形与顶点再上传，此时 location 0 须为位置
+    Mesh(const IndexedMesh &mesh, const VertexLayout &layout, bool optimize = true);
+    // 全部以 float 存放，attributeSizes[i] 为 location i 的分量数
+    Mesh(const IndexedMesh &mesh, std::initializer_list<uint32_t> attributeSizes,
+         bool optimize = true);
+    // 已经按 layout 量化好的顶点与 indexType 的索引 (例如 mesh_cache.h 映射的文件)，原样上传
+    // lods 覆盖的索引依次排列，总数即索引缓冲的大小
+    Mesh(const VertexLayout &layout, const void *vertices, uint32_t vertexCount,
+         const void *indices, GLenum indexType, const std::vector<MeshLod> &lods);
+
+    // 把顶点属性与索引缓冲接到另一个 vao 上，用于与别的实例缓冲组合 (同一网格的多批实例)
+    void attach(uint32_t vao) const;
+    // 在 vao (默认为自己的 VAO) 上绘制第 lod 级，instances 为 0 时不实例化
+    void draw(int32_t instances = 0, uint32_t lod = 0) const { draw_on(vao_, instances, lod); }
+    void draw_on(uint32_t vao, int32_t instances = 0, uint32_t lod = 0) const;
+
+    GLenum index_type() const { return indexType_; }
+    // 第 0 级 (完整网格) 的索引数
+    int32_t index_count() const { return lods_.empty() ? 0 : (int32_t)lods_[0].indexCount; }
+    uint32_t lod_count() const { return static_cast<uint32_t>(lods_.size()); }
+    const MeshLod &lod(uint32_t index) const { return lods_[index]; }
+    uint32_t vertex_count() const { return vertexCount_; }
+    const VertexLayout &layout() const { return layout_; }
+    // 顶点与索引缓冲 (含所有 LOD) 的总字节数
+    size_t bytes() const;
+
+    void release();
+
+private:
+    // 创建缓冲与 VAO，vertices/indices 的大小由 vertexCount_、layout_ 与 lods_ 决定
+    void upload(const void *vertices, const void *indices);
+    size_t index_bytes() const;
+
+    VertexLayout layout_;
+    uint32_t vertexCount_ = 0;
+    GLenum indexType_ = GL_UNSIGNED_INT;
+    std::vector<MeshLod> lods_;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "mesh.h"
+#include "vertex_layout.h"
+
+// 导入、优化、量化之后的网格缓存 (.lmesh)，与 .ltex 一样映射后直接按结构体访问：
+//   MeshCacheHeader | MeshCacheAttribute[attributeCount] | MeshLod[lodCount] | 顶点 | 索引
+// 顶点与索引按 MESH_CACHE_ALIGNMENT 对齐，已经是 GPU 上的格式，映射后原样交给 glBufferData，
+// 不再解析、优化或逐顶点转换；字段按本机字节序 (小端) 存放
+constexpr char MESH_CACHE_MAGIC[4] = {'L', 'M', 'S', 'H'};
+constexpr uint32_t MESH_CACHE_VERSION = 1;
+constexpr size_t MESH_CACHE_ALIGNMENT = 64;
+constexpr const char *MESH_CACHE_EXTENSION = ".lmesh";
+constexpr uint32_t MESH_CACHE_MAX_LODS = 8;
+
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t attributeCount;
+    uint32_t lodCount;      // 第 0 级为完整网格
+    uint32_t stride;        // 与按属性表重建的 VertexLayout 一致
+    uint32_t vertexCount;
+    uint32_t indexType;     // GL_UNSIGNED_SHORT 或 GL_UNSIGNED_INT
+    uint32_t indexCount;    // 所有级别的索引数之和
+    uint64_t vertexOffset;  // 相对文件开头
+    uint64_t indexOffset;
+    float boundsMin[3];     // 量化前的位置的包围盒
+    float boundsMax[3];
+    float sphereCenter[3];  // 包围球，中心取包围盒中心
+    float sphereRadius;
+};
+
+struct MeshCacheAttribute {
+    uint32_t components;
+    uint32_t format;  // VertexFormat
+};
+
+// 优化三角形与顶点顺序、以 simplify_clustered 生成至多 lodCount 级 LOD，按 layout 量化后写入
+// destination；LOD 的格子从 256 开始减半，三角形没有减少到上一级的 70% 以下的级别跳过
+bool write_mesh_cache(const IndexedMesh &mesh, const VertexLayout &layout,
+                      const std::string &destination, uint32_t lodCount = 4);
+// source 同目录下同名、扩展名为 .lmesh 的文件
+std::string mesh_cache_path(const std::string &source);
+
+// 映射后的网格缓存，open() 时校验头部、属性表与各段的范围，之后的访问不再检查
+class MeshCache {
+public:
+    bool open(const std::string &path);
+    // 覆盖写入同一文件之前必须先解除映射
+    void close();
+
+    const MeshCacheHeader &header() const { return *header_; }
+    VertexLayout layout() const;
+    const MeshLod &lod(uint32_t index) const { return lods_[index]; }
+    const uint8_t *vertex_data() const { return file_.data() + header_->vertexOffset; }
+    const uint8_t *index_data() const { return file_.data() + header_->indexOffset; }
+    size_t file_bytes() const { return file_.size(); }
+    // 提前读入所有页，缺页发生在调用线程上而不是 glBufferData 里
+    void prefetch() const { file_.prefetch(); }
+
+    // 以映射的顶点与索引创建 Mesh，包含所有 LOD
+    Mesh create_mesh() const;
+
+private:
+    MappedFile file_;
+    const MeshCacheHeader *header_ = nullptr;
+    const MeshCacheAttribute *attributes_ = nullptr;
+    const MeshLod *lods_ = nullptr;
+};
+
+// 缓存存在、不比 source 旧且布局与 layout 相同时直接打开，否则用 load_mesh 导入 source (threads 个
+// 线程解析)、写出缓存后再打开；缓存无法写入时返回 false
+bool open_mesh_cache(const std::string &source, const VertexLayout &layout, MeshCache &cache,
+                     uint32_t threads = 0);
+
+#endif
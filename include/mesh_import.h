@@ -0,0 +1,34 @@
+#ifndef MESH_IMPORT_H
+#define MESH_IMPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "mesh.h"
+
+// 外部网格的导入，结果为与 CUBE_VERTICES 相同布局 (position, normal, texcoord，8 个 float) 的索引网格，
+// 可以直接交给 Mesh 上传；缺少法线时按面积加权的面法线生成，缺少纹理坐标时为 0
+// 文件都以 MappedFile 映射读取，失败时输出 ERROR::MESH_IMPORT::... 并返回 false
+
+struct MeshImportStats {
+    size_t fileBytes = 0;
+    double parseNs = 0.0;  // 文本/JSON 解析与属性读取
+    double buildNs = 0.0;  // 合并分块、建立索引、生成法线
+    uint32_t threads = 0;  // 实际使用的线程数
+    uint32_t chunks = 0;   // OBJ 切分的块数
+};
+
+// Wavefront OBJ：v/vt/vn/f，多边形按扇形切成三角形，支持负数 (相对) 索引，其余语句忽略
+// 文件按行边界切成若干块，由 threads 个线程 (含调用线程，为 0 时使用硬件线程数) 并行解析，
+// 浮点数用 std::from_chars 解析；(v, vt, vn) 组合相同的角共用一个顶点
+bool load_obj(const std::string &path, IndexedMesh &mesh, uint32_t threads = 0,
+              MeshImportStats *stats = nullptr);
+// glTF 2.0：.glb 或引用外部 .bin 的 .gltf (不支持 data URI 与稀疏 accessor)
+// 默认场景中所有节点的三角形图元按节点的世界变换合并成一个网格
+bool load_gltf(const std::string &path, IndexedMesh &mesh, MeshImportStats *stats = nullptr);
+// 按扩展名选择 load_obj 或 load_gltf
+bool load_mesh(const std::string &path, IndexedMesh &mesh, uint32_t threads = 0,
+               MeshImportStats *stats = nullptr);
+
+#endif
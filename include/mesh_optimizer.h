@@ -0,0 +1,41 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mesh.h"
+
+// 索引网格的三角形与顶点重排，不改变网格的形状，只改变 GPU 处理它的顺序：
+//   1. optimize_vertex_cache：Forsyth 的贪心排序，让相邻三角形共用的顶点留在 post-transform 缓存里
+//   2. optimize_overdraw：把上一步的结果切成若干簇，朝外的簇先画，提前深度测试挡掉后画的片段
+//   3. optimize_vertex_fetch：按索引第一次引用的顺序重排顶点，取顶点时沿缓冲顺序读
+// 三步依次执行，后一步不会破坏前一步的结果；三角形按卷绕 (逆时针为正面) 求法线
+
+// 以 FIFO 缓存模拟 GPU 的 post-transform 缓存与顶点读取
+struct VertexCacheStats {
+    double acmr = 0.0;       // 平均每个三角形变换的顶点数，下限约 0.5，完全不共用时为 3
+    double atvr = 0.0;       // 变换的顶点数 / 顶点数，理想值为 1
+    double overfetch = 0.0;  // 读取的字节数 / 顶点缓冲的字节数，按 64 字节的缓存行计，理想值为 1
+};
+
+// cacheSize 为模拟的 post-transform 缓存的顶点数，常见硬件在 16 到 32 之间
+VertexCacheStats analyze_vertex_cache(const IndexedMesh &mesh, uint32_t cacheSize = 16);
+
+// 只重排三角形，顶点与每个三角形内的卷绕不变
+void optimize_vertex_cache(IndexedMesh &mesh);
+// 在 optimize_vertex_cache 之后调用：每个顶点的前 3 个分量是位置
+// 切分后的簇的 ACMR 最多变为原来的 threshold 倍，越大簇越小、排序越自由
+void optimize_overdraw(IndexedMesh &mesh, float threshold = 1.05f);
+// 重排顶点并改写索引，没有被引用的顶点被丢弃
+void optimize_vertex_fetch(IndexedMesh &mesh);
+// 依次执行以上三步
+void optimize_mesh(IndexedMesh &mesh);
+
+// 顶点聚类简化，用于生成 LOD：包围盒按最长边切成 gridSize 格的立方体网格，同一格内被引用的顶点
+// 合并到其中离格子中心最近的那个，去掉退化与重复的三角形；只改写索引，顶点缓冲不变，
+// 三角形的顺序被打乱，之后应再 optimize_vertex_cache
+// 返回合并造成的最大位移 (模型空间的长度)，即这一级相对输入的几何误差上限
+float simplify_clustered(IndexedMesh &mesh, uint32_t gridSize);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU 端的 mip 链生成，替代 GL 线程上的 glGenerateMipmap，可以在解码线程上运行
+// 每一级由上一级的浮点结果可分离地缩小一半 (先水平后垂直)，量化只发生在输出时，误差不会逐级累积
+//   Box：2x2 平均，与 glGenerateMipmap 的常见实现一致
+//   Kaiser：8 抽头 Kaiser 窗 sinc，缩小后更锐利、摩尔纹更少
+enum class MipFilter { Box, Kaiser };
+
+struct MipOptions {
+    MipFilter filter = MipFilter::Box;
+    // RGB 按 sRGB 编码：先解码到线性空间再平均，输出时重新编码；alpha 始终是线性的
+    bool srgb = false;
+};
+
+// level 1 到 1x1 的所有级别，依次紧挨着存放在 data 中，每像素与源图像相同的通道数，行间没有填充
+struct MipChain {
+    struct Level {
+        uint32_t width;
+        uint32_t height;
+        size_t offset;
+        size_t size;
+    };
+    std::vector<Level> levels;
+    std::vector<uint8_t> data;
+};
+
+// 按 CPU 支持的指令集选择 AVX2 或 SSE2 实现
+MipChain generate_mips(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels,
+                       const MipOptions &options = {});
+// 相同算法的标量实现，作为正确性与性能的参照
+MipChain generate_mips_scalar(const uint8_t *pixels, uint32_t width, uint32_t height,
+                              uint32_t channels, const MipOptions &options = {});
+// generate_mips() 实际使用的实现："AVX2"、"SSE2" 或 "scalar"
+const char *mip_simd_path();
+
+#endif
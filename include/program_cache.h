@@ -0,0 +1,56 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+
+// 基于 glGetProgramBinary / glProgramBinary 的磁盘缓存，省去每次启动时的编译与链接
+// 缓存文件名取自着色器源码的哈希，文件头里记录驱动 (vendor/renderer/version) 的哈希，
+// 驱动更新后头部对不上，旧文件在下一次 store 时被覆盖
+class ProgramCache {
+public:
+    // 默认目录 ./shader_cache，首次使用时创建
+    explicit ProgramCache(std::string directory = "./shader_cache");
+
+    // 关闭后 load 总是未命中、store 什么也不做，Shader 退化为每次都从源码构建
+    void set_enabled(bool enabled) { enabled_ = enabled; }
+    void set_directory(std::string directory) { directory_ = std::move(directory); }
+
+    // 需要 GL 4.1 或驱动至少支持一种二进制格式，首次调用时查询并记住结果
+    bool available();
+
+    // 命中时返回已链接好的 program，未命中或二进制被驱动拒绝时返回 0
+    uint32_t load(const std::string &vertexCode, const std::string &fragmentCode);
+    // 链接前调用，提示驱动保留可导出的二进制
+    void prepare(uint32_t program);
+    // 把刚从源码构建的 program 写入缓存；compileNs 为编译加链接的耗时，只用于统计
+    void store(uint32_t program, const std::string &vertexCode, const std::string &fragmentCode,
+               double compileNs);
+
+    // 输出命中/未命中次数以及读取缓存与编译的耗时
+    void report() const;
+
+    uint32_t hits() const { return hits_; }
+    uint32_t misses() const { return misses_; }
+
+private:
+    std::string directory_;
+    bool enabled_ = true;
+    int availability_ = -1;  // -1 未查询，0 不可用，1 可用
+    uint64_t driverHash_ = 0;
+
+    uint32_t hits_ = 0;
+    uint32_t misses_ = 0;
+    uint32_t rejected_ = 0;  // 文件存在但格式、驱动或 glProgramBinary 校验失败
+    double loadNs_ = 0.0;
+    double compileNs_ = 0.0;
+
+    std::string path_for(uint64_t sourceHash) const;
+};
+
+// Shader 构造时使用的全局缓存
+ProgramCache &program_cache();
+
+#endif
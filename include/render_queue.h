@@ -0,0 +1,89 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "instancing.h"
+#include "shader.h"
+
+// 每条命令绑定的纹理数，对应 material.diffuse/specular 使用的纹理单元 0/1
+constexpr uint32_t DRAW_TEXTURE_UNITS = 2;
+
+// 不透明物体按状态排序、状态相同时由近到远 (利于 early-Z)；
+// 半透明物体排在所有不透明物体之后，由远到近绘制并开启混合
+enum class DrawPass { Opaque, Transparent };
+
+// 一次绘制需要的状态，按值存放在队列中
+struct DrawCommand {
+    const Shader *shader = nullptr;
+    uint32_t vao = 0;
+    // 0 表示这个纹理单元用不到，保持原来的绑定
+    uint32_t textures[DRAW_TEXTURE_UNITS] = {};
+    GLenum mode = GL_TRIANGLES;
+    // GL_NONE 时 glDrawArrays，否则为 glDrawElements 的索引类型，first 为首个索引的下标
+    GLenum indexType = GL_NONE;
+    int32_t first = 0;
+    int32_t count = 0;
+    // 0 表示单个物体，model 与法线矩阵以常量顶点属性提供，vao 上不能启用实例属性数组；
+    // 大于 0 时绘制 vao 上 attach 的 InstanceBuffer 中的前 instanceCount 个实例
+    int32_t instanceCount = 0;
+    DrawPass pass = DrawPass::Opaque;
+};
+
+// 场景代码只提交命令，排序后统一执行，program/VAO/纹理的切换次数降到最少
+// 每帧的 uniform (view/projection 等) 属于 program 自身的状态，由调用方在 execute() 之前设置好
+class RenderQueue {
+public:
+    // execute() 中相对上一条命令真正发生的切换次数
+    struct Stats {
+        uint32_t draws = 0;
+        uint32_t programs = 0;
+        uint32_t vertexArrays = 0;
+        uint32_t textures = 0;
+    };
+
+    // depth 为物体在 view 空间中到摄像机的距离
+    void submit(const DrawCommand &command, float depth, const glm::mat4 &model);
+    // 实例化绘制，实例数据已在 command.vao 上
+    void submit(const DrawCommand &command, float depth);
+    // 按 64 位 key 基数排序，并一次性求出所有单个物体的法线矩阵
+    void sort();
+    // 按排序结果发出 GL 调用，状态经过 gl_state() 过滤
+    Stats execute() const;
+    // 清空命令，program/纹理/VAO 的排序编号保留，下一帧的 key 保持稳定
+    void clear();
+
+    size_t size() const { return commands_.size(); }
+
+private:
+    struct QueuedCommand {
+        DrawCommand command;
+        uint32_t instance;  // instances_ 中的下标，实例化绘制时不使用
+    };
+    struct SortItem {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    std::vector<QueuedCommand> commands_;
+    std::vector<SortItem> order_;
+    std::vector<SortItem> scratch_;
+    std::vector<glm::mat4> models_;
+    std::vector<InstanceData> instances_;
+
+    // GL 名字映射为连续的小编号，才能放进 key 中有限的位数
+    std::unordered_map<uint32_t, uint32_t> programIds_;
+    std::unordered_map<uint32_t, uint32_t> vertexArrayIds_;
+    std::unordered_map<uint64_t, uint32_t> textureSetIds_;
+
+    uint64_t make_key(const DrawCommand &command, float depth);
+    void push(const DrawCommand &command, float depth, uint32_t instance);
+};
+
+#endif
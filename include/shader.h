@@ -3,28 +3,185 @@
 
 #include <glad/glad.h>  // 包含glad来获取所有的必须OpenGL头文件
 
+#include <chrono>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 #include <glm/glm.hpp>
 
+// FNV-1a 64 位哈希，constexpr 以便 uniform 名字可以在编译期求值
+constexpr uint64_t uniform_hash(std::string_view name)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// 预先解析好的 uniform 句柄，T 只用于在编译期区分 set() 的重载
+// location 为 -1 时 glUniform* 会静默忽略，与 glGetUniformLocation 找不到名字时的行为一致
+template <typename T>
+struct Uniform {
+    int32_t location = -1;
+};
+
+// 编译期开关，注入为 #define name value
+struct ShaderDefine {
+    std::string name;
+    std::string value = "1";
+};
+using ShaderDefines = std::vector<ShaderDefine>;
+
+// 把 defines 按名字排序后插到 #version 行之后，同名的后者覆盖前者；
+// 排序保证同一组 define 无论传入顺序如何都得到相同的源码，从而命中同一个缓存
+std::string inject_defines(const std::string &source, const ShaderDefines &defines);
+
+// Sync 在构造函数里等待编译链接完成；Async 只提交编译与链接，
+// 结果留到第一次 use()/uniform 查询或 ready() 返回 true 时才取
+enum class BuildMode { Sync, Async };
+
 class Shader {
 public:
     // 程序ID
     uint32_t id_;
 
-    // 构造器，读取并构建着色器
-    Shader(const char *vertexPath, const char *fragmentPath);
+    // 构造器，读取并构建着色器，defines 同时注入顶点与片段着色器
+    Shader(const char *vertexPath, const char *fragmentPath, const ShaderDefines &defines = {},
+           BuildMode mode = BuildMode::Sync);
+    Shader(const char *vertexPath, const char *fragmentPath, BuildMode mode)
+        : Shader(vertexPath, fragmentPath, {}, mode)
+    {}
+    // 直接从已展开 include 的源码构建
+    static Shader from_source(std::string vertexCode, std::string fragmentCode,
+                              BuildMode mode = BuildMode::Sync);
+    // 读取 shader 文件并展开其中的 #include，dependencies 非空时追加读到的每个文件路径
+    static std::string read_source(const char *path,
+                                   std::vector<std::string> *dependencies = nullptr);
     // 使用/激活程序
-    void use();
+    void use() const;
+
+    // 驱动支持 GL_KHR_parallel_shader_compile 时打开后台编译线程，每个 context 调用一次
+    // load 与 gladLoadGLLoader 用的是同一个函数，返回是否支持
+    static bool enable_parallel_compile(GLADloadproc load);
+    // 不阻塞地检查异步构建是否完成，完成时顺带做完状态检查与 uniform 反射；
+    // 不支持 parallel compile 时无法不阻塞地查询，直接等待完成并返回 true
+    bool ready() const;
+    // 阻塞直到构建完成
+    void finish() const;
+    // 构建完成前用 fallback 代替自己绘制
+    const Shader &or_fallback(const Shader &fallback) const
+    {
+        return ready() ? *this : fallback;
+    }
+
+    // 热重载：重新读取源文件并异步构建，完成前继续使用当前 program
+    void reload();
+    // 重载完成时返回 true；链接成功则替换 id_ 并删除旧 program，失败则保留旧 program
+    bool poll_reload();
+    bool reloading() const { return reloading_ != nullptr; }
+    // 每次成功重载加一；新 program 的 uniform location、sampler 单元与 block 绑定都要重新设置，
+    // 持有 Uniform<T> 句柄的调用方比较这个值决定是否重新解析
+    uint32_t generation() const { return generation_; }
+    // 构造时读过的所有文件 (包括 #include 展开的)
+    const std::vector<std::string> &dependencies() const { return dependencies_; }
+
+    // 从 link 时反射得到的表中查找 uniform location，不会调用 glGetUniformLocation
+    int32_t location(std::string_view name) const;
+    // 在进入渲染循环前解析句柄，循环内只使用句柄：无字符串哈希、无内存分配、无驱动查询
+    template <typename T>
+    Uniform<T> uniform(std::string_view name) const
+    {
+        return {location(name)};
+    }
+
+    // 句柄版本的 uniform 工具函数
+    void set(Uniform<bool> uniform, bool value) const;
+    void set(Uniform<int> uniform, int value) const;
+    void set(Uniform<float> uniform, float value) const;
+    void set(Uniform<glm::vec3> uniform, float x, float y, float z) const;
+    void set(Uniform<glm::vec3> uniform, const glm::vec3 &value) const;
+    void set(Uniform<glm::mat4> uniform, const glm::mat4 &value) const;
+
     // uniform工具函数
-    void set_bool(const std::string &name, bool value) const;
-    void set_int(const std::string &name, int value) const;
-    void set_float(const std::string &name, float value) const;
-    void set_vec3(const std::string &name, float x, float y, float z) const;
-    void set_vec3(const std::string &name, const glm::vec3 &value) const;
-    void set_mat4(const std::string &name, glm::mat4 &value) const;
+    void set_bool(std::string_view name, bool value) const;
+    void set_int(std::string_view name, int value) const;
+    void set_float(std::string_view name, float value) const;
+    void set_vec3(std::string_view name, float x, float y, float z) const;
+    void set_vec3(std::string_view name, const glm::vec3 &value) const;
+    void set_mat4(std::string_view name, const glm::mat4 &value) const;
+
+private:
+    Shader() = default;
+    // 先查 program binary 缓存，未命中再提交编译
+    void build(std::string vertexCode, std::string fragmentCode, BuildMode mode);
+
+    // 开放寻址哈希表的一个槽位，hash 为 0 表示空槽
+    struct UniformSlot {
+        uint64_t hash = 0;
+        int32_t location = -1;
+        std::string name;
+    };
+    // 容量为 2 的幂，负载因子不超过 0.5
+    // 异步构建时到完成那一刻才填充，所以与 pending_ 一样允许在 const 成员里修改
+    mutable std::vector<UniformSlot> uniforms_;
+
+    // 已提交但还没查询过状态的构建
+    struct PendingBuild {
+        uint32_t vertexShader;
+        uint32_t fragmentShader;
+        std::string vertexCode;
+        std::string fragmentCode;
+        std::chrono::steady_clock::time_point start;
+    };
+    mutable std::unique_ptr<PendingBuild> pending_;
+
+    // 热重载所需的构造参数，from_source 构造的 Shader 没有路径，不支持重载
+    std::string vertexPath_;
+    std::string fragmentPath_;
+    ShaderDefines defines_;
+    std::vector<std::string> dependencies_;
+    std::unique_ptr<Shader> reloading_;
+    uint32_t generation_ = 0;
+
+    // 提交编译与链接，不查询任何状态，program binary 缓存未命中时调用
+    void begin_build(std::string vertexCode, std::string fragmentCode);
+    // 删除 program 以及未完成构建的 shader object，不查询任何状态
+    void discard();
+    // 通过 glGetActiveUniform 反射所有 active uniform 并填充 uniforms_
+    void reflect_uniforms() const;
+    void insert_uniform(std::string name, int32_t location) const;
+};
+
+// 同一对 shader 文件的各个 define 组合，按 (源码哈希, define 集合) 缓存，每种组合只编译一次
+// 缓存持有这些 Shader，调用方拿到的引用在 release() 之前一直有效
+class ShaderVariants {
+public:
+    // 同一 (路径, define 集合) 第二次起直接命中，不再读取、哈希源文件
+    const Shader &get(const char *vertexPath, const char *fragmentPath,
+                      const ShaderDefines &defines = {}, BuildMode mode = BuildMode::Sync);
+    // 源文件改动后调用：之后的 get() 重新读取并哈希源码，内容没变的组合仍然命中已有 program
+    void reload();
+    // 删除所有 program，需在 glfwTerminate() 之前调用
+    void release();
+
+    size_t size() const { return variants_.size(); }
+    uint32_t hits() const { return hits_; }
+    uint32_t misses() const { return misses_; }
+
+private:
+    std::unordered_map<std::string, std::unique_ptr<Shader>> variants_;
+    // (路径, define 集合) 到 variants_ 中 Shader 的映射
+    std::unordered_map<std::string, const Shader *> resolved_;
+    uint32_t hits_ = 0;
+    uint32_t misses_ = 0;
 };
 
 #endif
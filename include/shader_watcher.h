@@ -0,0 +1,45 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shader.h"
+
+// 监视 shader 目录，文件写入后重新构建引用了它的 Shader
+// 后台线程阻塞在 inotify 上，渲染线程每帧的 update() 在没有变化时只读一个原子变量
+// inotify 只在 Linux 上可用，其他平台上 watch/update 什么也不做
+class ShaderWatcher {
+public:
+    explicit ShaderWatcher(std::string directory = "./shader");
+    ~ShaderWatcher();
+    ShaderWatcher(const ShaderWatcher &) = delete;
+    ShaderWatcher &operator=(const ShaderWatcher &) = delete;
+
+    // shader 的生命周期必须长于 watcher
+    void watch(Shader &shader);
+    // 每帧在渲染线程调用：为受影响的 Shader 发起异步重载，并完成已经编译好的重载
+    void update();
+
+private:
+    std::string directory_;
+    std::vector<Shader *> shaders_;
+    // 正在后台编译的 Shader，非空时 update() 每帧轮询一次
+    std::vector<Shader *> reloading_;
+
+    // 后台线程写入、渲染线程取走的变化文件
+    std::atomic<bool> changed_ {false};
+    std::mutex mutex_;
+    std::vector<std::string> changedFiles_;
+
+    int inotifyFd_ = -1;
+    int wakeFd_ = -1;  // 析构时唤醒后台线程
+    std::thread thread_;
+
+    void run();
+};
+
+#endif
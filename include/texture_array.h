@@ -0,0 +1,106 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "instancing.h"
+#include "mip_generator.h"
+
+// 每实例的材质层号紧随法线矩阵之后，对应 light.vs 中 USE_TEXTURE_ARRAY 时的
+// layout (location = 10) in vec2 aMaterialLayers
+constexpr uint32_t INSTANCE_LAYER_LOCATION = INSTANCE_NORMAL_LOCATION + 3;
+
+// 一张纹理在 TextureArrays 中的位置
+// array 是管理器内的编号而不是 GL 名字：array 扩容时会换成新的纹理对象，编号不变
+struct TextureLayer {
+    static constexpr uint32_t INVALID = 0xFFFFFFFFu;
+
+    uint32_t array = INVALID;
+    uint32_t layer = 0;
+
+    bool valid() const { return array != INVALID; }
+};
+
+// 把尺寸、通道数与 mip 级数都相同的纹理放进同一个 GL_TEXTURE_2D_ARRAY 的不同层
+// 同一 array 里的材质只需绑定一次，层号作为每实例属性传给着色器，不同材质的物体可以在同一个
+// 实例化批次中绘制，不再为每个材质切换纹理
+// array 的容量从 INITIAL_LAYERS 开始按两倍增长，在 GPU 上拷贝已有的层；达到层数上限后另开一个
+// 与 Shader 一样不在析构时释放，由调用方在 glfwTerminate() 之前 release()
+class TextureArrays {
+public:
+    static constexpr uint32_t INITIAL_LAYERS = 4;
+
+    struct Stats {
+        uint32_t arrays = 0;
+        uint32_t layers = 0;
+        uint32_t grows = 0;   // 扩容次数，每次都要拷贝 array 中已有的全部层
+        size_t bytes = 0;     // 按已分配容量计的显存 (含 mip)
+    };
+
+    // 每个 array 的层数上限取 maxLayers 与 GL_MAX_ARRAY_TEXTURE_LAYERS 中的较小者，需要当前 context
+    explicit TextureArrays(uint32_t maxLayers = 2048);
+
+    // 以 GL_LINEAR_MIPMAP_LINEAR / GL_REPEAT 采样，mips 为 generate_mips() 的结果，
+    // 为空时只有一级；失败时返回无效的 TextureLayer
+    TextureLayer add(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels,
+                     const MipChain &mips = {});
+    // 在调用线程上同步解码并生成 mip 链后 add()
+    TextureLayer load(const std::string &path, bool flipVertically = false,
+                      const MipOptions &mipOptions = {});
+
+    uint32_t texture(uint32_t array) const { return arrays_[array].id; }
+    // 把第 array 个 array 绑定到 unit，供 sampler2DArray 采样
+    void bind(uint32_t unit, uint32_t array) const;
+
+    size_t array_count() const { return arrays_.size(); }
+    Stats stats() const;
+    void release();
+
+private:
+    struct Array {
+        uint32_t id;
+        uint32_t width;
+        uint32_t height;
+        uint32_t channels;
+        uint32_t levels;
+        uint32_t layers;    // 已使用的层数
+        uint32_t capacity;  // 已分配的层数
+    };
+
+    std::vector<Array> arrays_;
+    uint32_t maxLayers_;
+    uint32_t grows_ = 0;
+    uint32_t copyFramebuffer_ = 0;  // GL 4.3 以下扩容时用来读取旧 array 的层
+
+    uint32_t allocate(const Array &array, uint32_t capacity) const;
+    void grow(Array &array);
+};
+
+// 每实例的 (diffuse 层, specular 层)，配合 InstanceBuffer 挂在同一个 VAO 上
+struct MaterialLayers {
+    uint16_t diffuse;
+    uint16_t specular;
+};
+
+// 保存每实例材质层号的 GL_ARRAY_BUFFER，实例顺序与 InstanceBuffer 一致
+class MaterialLayerBuffer {
+public:
+    uint32_t id_;
+
+    MaterialLayerBuffer();
+
+    // 接到 vao 的 INSTANCE_LAYER_LOCATION 上，每个实例前进一次
+    void attach(uint32_t vao) const;
+    void upload(const MaterialLayers *layers, size_t count);
+    void upload(const std::vector<MaterialLayers> &layers) { upload(layers.data(), layers.size()); }
+
+private:
+    size_t capacity_ = 0;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef TEXTURE_BAKE_H
+#define TEXTURE_BAKE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "mapped_file.h"
+#include "mip_generator.h"
+
+// 离线烘焙的纹理容器 (.ltex)，布局参考 KTX2：
+//   BakedTextureHeader | BakedLevel[levelCount] | 各级数据，每级起始按 BAKED_DATA_ALIGNMENT 对齐
+// 烘焙时生成完整的 mip 链 (可选 BC 块压缩)，运行时映射文件后逐级 glTexImage2D 或
+// glCompressedTexImage2D，既不解码也不 glGenerateMipmap
+// 字段按本机字节序 (小端) 存放，映射后直接按结构体访问
+constexpr char BAKED_TEXTURE_MAGIC[4] = {'L', 'T', 'E', 'X'};
+constexpr uint32_t BAKED_TEXTURE_VERSION = 2;
+constexpr size_t BAKED_DATA_ALIGNMENT = 16;
+constexpr const char *BAKED_TEXTURE_EXTENSION = ".ltex";
+
+struct BakedTextureHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t channels;        // 保存的通道数
+    uint32_t format;          // 像素 (或解压后) 的格式：GL_RED/GL_RG/GL_RGB/GL_RGBA
+    uint32_t internalFormat;  // 未压缩时与 format 相同，否则为 GL_COMPRESSED_* 格式
+    uint32_t type;            // GL_UNSIGNED_BYTE，行之间没有填充
+    uint32_t blockBytes;      // 压缩格式每个 4x4 块的字节数，0 表示未压缩
+};
+
+struct BakedLevel {
+    uint64_t offset;  // 相对文件开头
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct BakeOptions {
+    // 翻转与否在烘焙时决定，运行时不再处理
+    bool flipVertically = false;
+    // 每一级按源图像通道数压缩为 BC4/BC5/BC1/BC3，见 block_format_for()
+    bool compress = false;
+    // 法线贴图只保留 XY 并压缩为 BC5，着色器以 shader/normal_map.glsl 的 DecodeNormalMap 重建 Z，
+    // 隐含 compress
+    bool normalMap = false;
+    MipFilter mipFilter = MipFilter::Box;
+    // RGB 按 sRGB 编码，mip 在线性空间平均
+    bool srgb = false;
+};
+
+// 用 stb_image 解码 source，generate_mips() 逐级生成到 1x1，写入 destination
+bool bake_texture(const std::string &source, const std::string &destination,
+                  const BakeOptions &options = {});
+// 同上，源图像已在内存中 (程序生成的纹理等)，options.flipVertically 不起作用
+bool bake_pixels(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels,
+                 const std::string &destination, const BakeOptions &options = {});
+// source 同目录下同名、扩展名为 .ltex 的文件
+std::string baked_texture_path(const std::string &source);
+// 烘焙文件存在且不比 source 旧时返回它，否则返回 source 本身
+std::string prefer_baked(const std::string &source);
+
+// 映射后的烘焙纹理，open() 时校验头部与每一级的范围，之后的访问不再检查
+class BakedTexture {
+public:
+    bool open(const std::string &path);
+
+    const BakedTextureHeader &header() const { return *header_; }
+    const BakedLevel &level(uint32_t index) const { return levels_[index]; }
+    const uint8_t *level_data(uint32_t index) const { return file_.data() + levels_[index].offset; }
+    // 所有级别的数据字节数
+    size_t data_bytes() const;
+    // 第 index 级上传后占用的显存，驱动不支持其压缩格式时按 CPU 解压后的大小计
+    size_t resident_bytes(uint32_t index) const;
+    void prefetch() const { file_.prefetch(); }
+
+    // 逐级上传到当前绑定的 GL_TEXTURE_2D，GL_TEXTURE_MAX_LEVEL 设为最后一级
+    // 驱动不支持其中的压缩格式时在 CPU 上解压后上传；调用方需保证 GL_PIXEL_UNPACK_BUFFER 没有绑定
+    void upload() const;
+    // 只上传第 index 级，不改动 BASE/MAX_LEVEL，供按需逐级驻留的调用方使用
+    void upload_level(uint32_t index) const;
+
+private:
+    MappedFile file_;
+    const BakedTextureHeader *header_ = nullptr;
+    const BakedLevel *levels_ = nullptr;
+};
+
+#endif
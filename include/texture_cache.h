@@ -0,0 +1,67 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "texture_loader.h"
+
+// 引用计数的纹理缓存，建立在 TextureLoader 之上
+// 同一路径在采样选项也相同时共用一个纹理，只解码上传一次；打开 shareContent 后，路径不同但文件
+// 内容逐字节相同的也共用，内容以文件字节的 64 位哈希加长度索引，命中后再逐字节比较确认，
+// 哈希碰撞不会把不同的图像合并
+// 内容共享的哈希与比较都在 GL 线程上读完整个文件，未命中的请求越多、文件越大，到第一帧前的
+// 时间越长，所以默认只按路径共享，留给加载时间不敏感、重复拷贝多的场合 (如离线的关卡加载) 使用
+// 引用数降到 0 时立即删除纹理，尚未上传完的同时取消其加载
+class TextureCache {
+public:
+    struct Stats {
+        uint32_t textures = 0;     // 当前驻留的纹理数
+        size_t residentBytes = 0;  // 这些纹理占用的显存 (含 mip)，未上传完的按占位像素计
+        uint64_t requests = 0;
+        uint64_t pathHits = 0;     // 路径与选项都相同
+        uint64_t contentHits = 0;  // 路径不同，文件内容相同，只在 shareContent 时出现
+        uint32_t evictions = 0;    // 引用数归零后删除的纹理数
+
+        double hit_rate() const
+        {
+            return requests == 0 ? 0.0 : (double)(pathHits + contentHits) / requests;
+        }
+    };
+
+    // loader 的生命周期需要覆盖缓存；shareContent 为 false 时 acquire() 不读取文件
+    explicit TextureCache(TextureLoader &loader, bool shareContent = false);
+
+    // 在 GL 线程调用：返回共享的纹理名并增加一次引用；未命中时交给 loader 异步加载
+    // 读不到文件时同样交给 loader，由它报告错误，这样的纹理只按路径共享
+    uint32_t acquire(const std::string &path, const TextureOptions &options = {});
+    // 在 GL 线程调用：减少一次引用，归零时删除纹理
+    void release(uint32_t texture);
+    // 删除所有纹理，不论引用数，在 glfwTerminate() 之前调用
+    void clear();
+
+    uint32_t references(uint32_t texture) const;
+    Stats stats() const;
+
+private:
+    struct Entry {
+        std::vector<std::string> pathKeys;  // 按内容命中的路径也登记进来，下次直接按路径命中
+        std::string contentKey;             // 为空表示没有按内容登记
+        std::string path;                   // 按内容命中时用来逐字节比较的文件
+        uint32_t references;
+    };
+
+    TextureLoader &loader_;
+    bool shareContent_;
+    std::unordered_map<std::string, uint32_t> paths_;     // 规范化路径 + 选项 → 纹理
+    std::unordered_map<std::string, uint32_t> contents_;  // 内容哈希 + 长度 + 选项 → 纹理
+    std::unordered_map<uint32_t, Entry> entries_;
+    Stats stats_;
+
+    void erase(uint32_t texture);
+};
+
+#endif
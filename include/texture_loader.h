@@ -0,0 +1,126 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "mip_generator.h"
+#include "texture_bake.h"
+#include "upload_ring.h"
+
+// 纹理的采样参数与解码选项
+struct TextureOptions {
+    bool flipVertically = false;
+    GLint wrap = GL_REPEAT;
+    GLint minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    GLint magFilter = GL_LINEAR;
+    // minFilter 使用 mipmap 时在工作线程上用 generate_mips() 生成整条链，GL 线程不再 glGenerateMipmap
+    MipFilter mipFilter = MipFilter::Box;
+    // 图像按 sRGB 编码，mip 在线性空间平均；内部格式不变，与场景目前的采样方式一致
+    bool srgb = false;
+};
+
+// 异步纹理加载：stbi_load 与 mip 生成在工作线程上进行，GL 线程每帧按字节预算上传
+// load() 立即返回纹理名，解码上传完成之前它的内容是一个 1x1 的灰色占位像素，
+// 完成后原地替换为真正的图像，所以调用方可以从第一帧起就绑定它
+// 像素经过 PixelUploadRing 上传，持久映射可用时工作线程解码后直接写入映射的 staging 内存
+class TextureLoader {
+public:
+    // 每帧默认最多上传 4 MiB，约等于一张 1024x1024 的 RGBA 图像
+    static constexpr size_t DEFAULT_UPLOAD_BUDGET = 4 << 20;
+    // staging ring 默认 32 MiB，fence 通常滞后两三帧，足够容纳几帧的默认预算
+    static constexpr size_t DEFAULT_STAGING_BYTES = 32 << 20;
+
+    // GL 线程上传一侧的累计统计
+    struct UploadStats {
+        size_t bytes = 0;
+        double uploadNs = 0.0;  // stage 拷贝 + 各级 glTexImage2D 的 GL 线程耗时
+        uint32_t staged = 0;    // 经过 PBO 上传的图像数
+        uint32_t direct = 0;    // ring 放不下或被禁用时，从客户端内存直接上传的图像数
+    };
+
+    // 在 GL 线程构造，threads 为 0 时使用硬件线程数减一，至少一个；stagingBytes 为 0 时不使用 PBO
+    explicit TextureLoader(uint32_t threads = 0, size_t stagingBytes = DEFAULT_STAGING_BYTES);
+    // 只停止工作线程、释放尚未上传的像素，staging buffer 需要在 glfwTerminate() 之前 release()，
+    // 纹理由调用方 glDeleteTextures
+    ~TextureLoader();
+    TextureLoader(const TextureLoader &) = delete;
+    TextureLoader &operator=(const TextureLoader &) = delete;
+
+    // 在 GL 线程调用：创建带占位像素的纹理并提交解码任务
+    // .ltex 烘焙文件只在工作线程上映射，上传时直接使用其中的 mip 链，options 中只有采样参数生效
+    uint32_t load(const std::string &path, const TextureOptions &options = {});
+    // 每帧在 GL 线程调用：上传已解码的图像，累计超过 byteBudget 后留到下一帧；
+    // 单张超过预算的图像在本帧还没有上传过任何图像时照常上传，否则它永远排不上
+    void update(size_t byteBudget = DEFAULT_UPLOAD_BUDGET);
+    // 阻塞直到已提交的纹理全部上传完，不受字节预算限制
+    void finish();
+    // 在 GL 线程调用：停止工作线程并删除 staging buffer，之后不能再 load()
+    void release();
+    // 在 GL 线程调用：不再需要 texture，尚未上传的图像解码后直接丢弃，调用方随后可以立即删除它
+    // texture 已经上传完 (或不是 load() 返回的) 时返回 false
+    bool cancel(uint32_t texture);
+
+    // 已提交但还没有上传 (或失败) 的纹理数
+    size_t pending() const { return submitted_ - completed_; }
+    // 上一次 update() 上传的字节数
+    size_t frame_bytes() const { return frameBytes_; }
+    const UploadStats &upload_stats() const { return uploadStats_; }
+    // texture 当前占用的显存 (含 mip)，上传完成之前为占位像素的 4 字节，未知的纹理为 0
+    size_t texture_bytes(uint32_t texture) const;
+    PixelUploadRing::Stats staging_stats() const { return ring_.stats(); }
+
+private:
+    struct Job {
+        uint64_t serial;  // 纹理名在删除后可能被复用，取消时按序号而不是名字识别任务
+        uint32_t texture;
+        std::string path;
+        TextureOptions options;
+    };
+    struct Decoded {
+        Job job;
+        unsigned char *pixels;  // stbi_load 的结果，已拷进 staging 或失败时为 nullptr
+        int width;
+        int height;
+        int channels;
+        MipChain mips;                        // level 1 起，已拷进 staging 时 data 为空
+        PixelUploadRing::Allocation staging;  // 工作线程写入的 staging 区域，level 0 后紧跟 mip 链
+        std::unique_ptr<BakedTexture> baked;  // .ltex 文件，已映射并预读
+    };
+
+    PixelUploadRing ring_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable jobReady_;
+    std::condition_variable decoded_;
+    std::deque<Job> jobs_;
+    std::deque<Decoded> ready_;
+    bool stopping_ = false;
+
+    // 以下只在 GL 线程访问
+    size_t submitted_ = 0;
+    size_t completed_ = 0;
+    size_t frameBytes_ = 0;
+    UploadStats uploadStats_;
+    uint64_t nextSerial_ = 1;
+    std::unordered_map<uint32_t, uint64_t> inFlight_;  // 已提交未上传的纹理 → 任务序号
+    std::unordered_set<uint64_t> cancelled_;            // 已经在解码、结果要丢弃的任务
+    std::unordered_map<uint32_t, size_t> residentBytes_;
+
+    void stop();
+    void run();
+    void upload(const Decoded &image);
+};
+
+#endif
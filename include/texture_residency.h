@@ -0,0 +1,103 @@
+#ifndef TEXTURE_RESIDENCY_H
+#define TEXTURE_RESIDENCY_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "texture_bake.h"
+
+// 显存预算下的纹理驻留管理，纹理来自映射的 .ltex 烘焙文件，每一级都可以单独上传或丢弃
+// 每个纹理只驻留 [base, 最后一级]，GL_TEXTURE_BASE_LEVEL 始终等于 base，采样不会用到未驻留的级别：
+//   - 不超过 RESIDENT_TAIL_SIZE 的小级别在 add() 时上传并一直驻留，任何时候都有东西可以采样；
+//     丢弃其他纹理的级别后仍放不下时 add() 失败
+//   - 每帧由 use() 记录的包围球与相机的距离求出需要的最高一级，逐级向上补齐，
+//     每帧上传的字节数受 uploadBudget 限制，近处、缺得多的纹理优先
+//   - 放不下时先从最久未使用的纹理丢弃当前用不到的最高一级，仍然不够就暂缓补齐；
+//     预算被调低时连正在使用的级别也会按 LRU 丢弃；只有预算调到所有常驻级别之和以下时，
+//     驻留量才会超出预算
+// 丢弃的级别以 0x0 的图像重新定义，驱动随之释放其存储
+class TextureResidency {
+public:
+    // 边长不超过它的级别常驻
+    static constexpr uint32_t RESIDENT_TAIL_SIZE = 64;
+    static constexpr size_t DEFAULT_UPLOAD_BUDGET = 4 << 20;
+    static constexpr uint32_t INVALID = 0xFFFFFFFFu;
+
+    struct Stats {
+        size_t budget = 0;
+        size_t resident = 0;       // 所有已驻留级别的显存
+        size_t peak = 0;           // resident 的历史最大值
+        size_t frameUploaded = 0;  // 上一次 update() 上传的字节数
+        double frameUploadNs = 0.0;
+        uint32_t textures = 0;
+        uint32_t starved = 0;  // 上一帧用到、但驻留级别比需要的低的纹理数
+        uint64_t levelsStreamed = 0;
+        uint64_t levelsDropped = 0;
+    };
+
+    // 需要当前 context
+    explicit TextureResidency(size_t budgetBytes, size_t uploadBudget = DEFAULT_UPLOAD_BUDGET);
+
+    // 映射 path 并上传常驻的小级别，返回句柄；文件无效或常驻级别超出预算时返回 INVALID
+    uint32_t add(const std::string &path);
+    uint32_t texture(uint32_t handle) const { return textures_[handle].id; }
+
+    // 每帧在 use() 之前调用：记下相机位置与投影，供 use() 求物体在屏幕上的大小
+    void set_view(const Camera &camera, float viewportHeight);
+    // 本帧要绘制 handle，物体的包围球为 (center, radius)，纹理完整覆盖物体一次
+    void use(uint32_t handle, const glm::vec3 &center, float radius);
+    // 每帧在 GL 线程调用一次，在所有 use() 之后、绘制之前：调整驻留并开始新的一帧
+    void update();
+    // 下一次 update() 时生效；低于所有常驻级别之和时，驻留量停在这个和上
+    void set_budget(size_t budgetBytes) { budget_ = budgetBytes; }
+
+    // handle 当前驻留的最高一级与上一帧需要的最高一级
+    uint32_t resident_level(uint32_t handle) const { return textures_[handle].base; }
+    uint32_t wanted_level(uint32_t handle) const { return textures_[handle].wanted; }
+    Stats stats() const;
+    // 删除所有纹理并解除映射，在 glfwTerminate() 之前调用
+    void release();
+
+private:
+    struct Texture {
+        uint32_t id;
+        std::unique_ptr<BakedTexture> file;
+        uint32_t levels;
+        bool compressed;    // 以压缩格式驻留 (驱动支持其块格式)
+        uint32_t tail;      // 常驻的第一级
+        uint32_t base;      // 已驻留的最高一级
+        uint32_t wanted;    // 本帧需要的最高一级，未使用时为 tail
+        float pixels;       // 本帧在屏幕上覆盖的最大像素数 (直径方向)
+        uint64_t lastUsed;  // 最后一次 use() 的帧号
+        std::vector<size_t> levelBytes;
+    };
+
+    std::vector<Texture> textures_;
+    size_t budget_;
+    size_t uploadBudget_;
+    size_t resident_ = 0;
+    size_t peak_ = 0;
+    uint64_t frame_ = 1;
+    glm::vec3 eye_ = glm::vec3(0.0f);
+    float pixelsPerUnit_ = 0.0f;  // 距离为 1 处每单位长度在屏幕上的像素数
+    size_t frameUploaded_ = 0;
+    double frameUploadNs_ = 0.0;
+    uint32_t starved_ = 0;
+    uint64_t levelsStreamed_ = 0;
+    uint64_t levelsDropped_ = 0;
+
+    void stream_in(Texture &texture);
+    void drop(Texture &texture);
+    // 按 LRU 丢弃级别直到再放得下 bytes；onlyUnwanted 时只丢弃当前用不到的级别，不碰 except
+    bool make_room(size_t bytes, bool onlyUnwanted, const Texture *except);
+};
+
+#endif
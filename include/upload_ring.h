@@ -0,0 +1,96 @@
+#ifndef UPLOAD_RING_H
+#define UPLOAD_RING_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// 纹理上传用的 GL_PIXEL_UNPACK_BUFFER 环形缓冲
+// glTexImage2D 的数据来源是 PBO 时只记录一次 DMA，调用立即返回，不再在 GL 线程上拷贝客户端内存
+//
+// GL 4.4 起用 glBufferStorage 持久映射：任意线程都能 allocate() 并直接写入 data，
+// 每帧上传完后插入 glFenceSync，fence 完成后区域才会被回收
+// 3.3 上 buffer 不能在使用时保持映射，只能由 GL 线程 stage() 拷贝；空间不足时不等待 fence，
+// 而是 glBufferData(NULL) orphan 掉整个 buffer 从头开始，旧存储由驱动在 GPU 用完后回收
+class PixelUploadRing {
+public:
+    struct Allocation {
+        uint8_t *data = nullptr;  // 持久映射时可直接写入；orphan 模式下为空
+        size_t offset = 0;        // 作为 glTexImage2D 的数据指针传入
+        size_t size = 0;
+        uint64_t serial = 0;      // 0 表示分配失败
+    };
+
+    struct Stats {
+        size_t capacity = 0;
+        bool persistent = false;
+        size_t inUse = 0;  // 已分配、还没有被 fence 回收的字节，含回绕时跳过的尾部
+        size_t peak = 0;
+        uint32_t fenceWaits = 0;
+        double fenceWaitNs = 0.0;
+        uint32_t orphans = 0;
+    };
+
+    uint32_t id_ = 0;
+
+    // capacity 为 0 时不创建 buffer，enabled() 返回 false
+    explicit PixelUploadRing(size_t capacity);
+
+    bool enabled() const { return id_ != 0; }
+    bool persistent() const { return mapped_ != nullptr; }
+
+    // 持久映射模式下任意线程可调用；空间不足时立即返回失败，不等待
+    Allocation allocate(size_t size);
+    // GL 线程：分配并把 pixels 拷贝进去，空间不足时持久映射模式等待最旧的 fence，
+    // orphan 模式直接 orphan；仍然放不下 (比整个 ring 还大) 时返回失败
+    Allocation stage(const void *pixels, size_t size);
+    // GL 线程：allocation 的上传命令已经发出
+    void submit(const Allocation &allocation);
+    // GL 线程：为本帧 submit 的区域插入 fence，并回收 fence 已完成的区域
+    void fence();
+    // GL 线程：删除 buffer 与 fence，之后 allocate() 总是失败
+    void release();
+
+    Stats stats() const;
+
+private:
+    struct Region {
+        uint64_t serial;
+        size_t bytes;        // 含回绕时跳过的尾部
+        uint64_t fence = 0;  // 覆盖它的 fence 序号，0 表示还没有 submit
+    };
+
+    size_t capacity_;
+    uint8_t *mapped_ = nullptr;
+    mutable std::mutex mutex_;
+    size_t head_ = 0;
+    size_t used_ = 0;
+    size_t peak_ = 0;
+    uint64_t nextSerial_ = 1;
+    std::deque<Region> regions_;
+
+    // 以下只在 GL 线程访问
+    uint64_t nextFence_ = 1;
+    uint64_t pendingFence_ = 0;  // 本帧有 submit 时为即将插入的 fence 序号
+    struct Fence {
+        uint64_t serial;
+        GLsync sync;
+    };
+    std::deque<Fence> fences_;
+    uint32_t fenceWaits_ = 0;
+    double fenceWaitNs_ = 0.0;
+    uint32_t orphans_ = 0;
+
+    // 已加锁
+    Allocation allocate_locked(size_t size);
+    // 回收 serial 不超过 completed 的连续区域，已加锁
+    void retire_locked(uint64_t completed);
+    // 检查 fence，wait 为 true 时阻塞等待最旧的一个，返回是否回收了空间
+    bool poll_fences(bool wait);
+    void orphan();
+};
+
+#endif
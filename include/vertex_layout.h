@@ -0,0 +1,70 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "shader.h"
+
+// 顶点属性在缓冲中的存储格式，源数据总是 float
+enum class VertexFormat : uint8_t {
+    Float,
+    Half,           // 每分量 16 位浮点，位置在几千个单位以内时精度约为 1/1000
+    Unorm16,        // [0, 1] 映射到 16 位无符号归一化整数，纹理坐标超出 [0, 1] (重复平铺) 时用 Half
+    Snorm16,        // [-1, 1] 映射到 16 位有符号归一化整数
+    Int2_10_10_10,  // 3 个 [-1, 1] 的分量打包进 4 字节的 GL_INT_2_10_10_10_REV，w 为 0
+    Octahedral8,    // 单位向量的八面体编码，2 个 snorm8，着色器中以 DecodeNormal 还原
+    Octahedral16,   // 同上，2 个 snorm16
+};
+
+// location 即属性在布局中的序号
+struct VertexAttribute {
+    uint32_t components;  // 源数据中的 float 个数
+    VertexFormat format;
+};
+
+// 顶点布局只描述一次，量化 (pack)、属性设置 (attach) 与着色器的 define 都由它生成
+// 属性依次紧挨着存放，每个属性按其分量类型的大小对齐，stride 按 4 字节对齐
+class VertexLayout {
+public:
+    VertexLayout() = default;
+    VertexLayout(std::initializer_list<VertexAttribute> attributes)
+        : VertexLayout(std::vector<VertexAttribute>(attributes))
+    {}
+    explicit VertexLayout(const std::vector<VertexAttribute> &attributes);
+
+    const std::vector<VertexAttribute> &attributes() const { return attributes_; }
+    // 源数据每个顶点的 float 个数
+    uint32_t components() const { return components_; }
+    uint32_t stride() const { return stride_; }
+    uint32_t offset(uint32_t location) const { return offsets_[location]; }
+
+    // 把 vertexCount 个源顶点 (每个 components() 个 float) 量化成 vertexCount * stride() 字节
+    std::vector<uint8_t> pack(const float *vertices, size_t vertexCount) const;
+    // pack 的逆过程，用于检查量化误差
+    std::vector<float> unpack(const uint8_t *data, size_t vertexCount) const;
+    // 在 vao 上设置 location 0..n 的属性指针，数据来自 vbo；返回时 vao 仍处于绑定状态
+    void attach(uint32_t vao, uint32_t vbo) const;
+    // 着色器需要的 define：法线 (location 1) 为八面体编码时 OCTAHEDRAL_NORMALS 为 1，见 light.vs
+    ShaderDefines defines() const;
+
+private:
+    std::vector<VertexAttribute> attributes_;
+    std::vector<uint32_t> offsets_;
+    uint32_t components_ = 0;
+    uint32_t stride_ = 0;
+};
+
+// 32 字节：position/normal/texcoord 全为 float，与 CUBE_VERTICES 相同
+inline const VertexLayout VERTEX_LAYOUT_FLOAT = {
+    {3, VertexFormat::Float}, {3, VertexFormat::Float}, {2, VertexFormat::Float}};
+// 16 字节：half 位置 (补齐到 8 字节)、2_10_10_10 法线、unorm16 纹理坐标，着色器不需要改动
+inline const VertexLayout VERTEX_LAYOUT_COMPACT16 = {
+    {3, VertexFormat::Half}, {3, VertexFormat::Int2_10_10_10}, {2, VertexFormat::Unorm16}};
+// 12 字节：half 位置、8 位八面体法线、half 纹理坐标，着色器需要 defines()
+inline const VertexLayout VERTEX_LAYOUT_COMPACT12 = {
+    {3, VertexFormat::Half}, {3, VertexFormat::Octahedral8}, {2, VertexFormat::Half}};
+
+#endif
@@ -0,0 +1,31 @@
+// 延迟渲染光照 pass 共用的 G-buffer 读取，需在 lighting.glsl 之后 #include
+// G-buffer 只有两张颜色纹理加深度：
+//   gAlbedoSpec : RGBA8, rgb 为 albedo, a 为 specular 强度
+//   gNormal     : RG16F, 八面体编码的法线
+//   gDepth      : 深度，世界坐标由 invViewProjection 反推
+
+#include "octahedral.glsl"
+
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform mat4 invViewProjection;
+uniform vec2 screenSize;
+uniform float shininess;
+
+// 读取当前像素的 G-buffer，返回 false 表示该像素没有几何体
+bool ReadGBuffer(out vec3 fragPos, out vec3 normal, out Surface surface)
+{
+    vec2 uv = gl_FragCoord.xy / screenSize;
+    float depth = texture(gDepth, uv).r;
+    if (depth >= 1.0) return false;
+
+    vec4 world = invViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    fragPos = world.xyz / world.w;
+    normal = DecodeNormal(texture(gNormal, uv).xy);
+    vec4 albedoSpec = texture(gAlbedoSpec, uv);
+    surface.albedo = albedoSpec.rgb;
+    surface.specular = vec3(albedoSpec.a);
+    surface.shininess = shininess;
+    return true;
+}
@@ -0,0 +1,19 @@
+#version 330 core
+// 延迟渲染的全屏光照 pass：方向光与聚光灯，点光源由 deferred_point 的光体积负责
+out vec4 FragColor;
+
+#include "lighting.glsl"
+#include "deferred.glsl"
+
+void main()
+{
+    vec3 fragPos;
+    vec3 norm;
+    Surface surface;
+    if (!ReadGBuffer(fragPos, norm, surface)) discard;
+
+    vec3 viewDir = normalize(viewPos - fragPos);
+    vec3 result = CalcDirLight(dirLight, norm, viewDir, surface);
+    result += CalcSpotLight(spotLight, norm, fragPos, viewDir, surface);
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,8 @@
+#version 330 core
+// 不需要顶点数据的全屏三角形，glDrawArrays(GL_TRIANGLES, 0, 3) 即可覆盖整个屏幕
+
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
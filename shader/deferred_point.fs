@@ -0,0 +1,25 @@
+#version 330 core
+// 点光源光体积的光照 pass，以加法混合累加到全屏 pass 的结果上
+out vec4 FragColor;
+
+#include "lighting.glsl"
+#include "deferred.glsl"
+
+uniform samplerBuffer pointLightData;
+
+flat in int LightIndex;
+
+void main()
+{
+    vec3 fragPos;
+    vec3 norm;
+    Surface surface;
+    if (!ReadGBuffer(fragPos, norm, surface)) discard;
+
+    PointLight light = FetchPointLight(pointLightData, LightIndex);
+    // 立方体的角落在球外，这些像素不受该光源影响
+    if (distance(light.position, fragPos) > light.radius) discard;
+
+    vec3 viewDir = normalize(viewPos - fragPos);
+    FragColor = vec4(CalcPointLight(light, norm, fragPos, viewDir, surface), 1.0);
+}
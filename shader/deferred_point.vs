@@ -0,0 +1,19 @@
+#version 330 core
+// 点光源光体积：每个实例是一个按光源半径缩放的立方体，光源数据从 texture buffer 读取
+layout (location = 0) in vec3 aPos;
+
+// 每个点光源占 4 个 RGBA32F texel，布局与 PointLight 结构体一致
+uniform samplerBuffer pointLightData;
+uniform mat4 viewProjection;
+
+flat out int LightIndex;
+
+void main()
+{
+    vec4 positionRadius = vec4(texelFetch(pointLightData, gl_InstanceID * 4).xyz,
+                               texelFetch(pointLightData, gl_InstanceID * 4 + 3).w);
+    // 单位立方体边长为 1，放大到 2 * radius 才能包住整个球
+    vec3 world = positionRadius.xyz + aPos * 2.0 * positionRadius.w;
+    LightIndex = gl_InstanceID;
+    gl_Position = viewProjection * vec4(world, 1.0);
+}
@@ -0,0 +1,24 @@
+#version 330 core
+// 延迟渲染的几何 pass：只写材质与法线，不做任何光照计算
+layout (location = 0) out vec4 gAlbedoSpec;  // rgb: diffuse 贴图, a: specular 强度
+layout (location = 1) out vec2 gNormal;      // 八面体编码的世界空间法线
+
+#include "octahedral.glsl"
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+};
+
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform Material material;
+
+void main()
+{
+    gAlbedoSpec.rgb = texture(material.diffuse, TexCoords).rgb;
+    // container2_specular 是灰度图，一个通道就够了
+    gAlbedoSpec.a = texture(material.specular, TexCoords).r;
+    gNormal = EncodeNormal(normalize(Normal));
+}
@@ -1,21 +1,44 @@
 #version 330 core
+#ifndef OCTAHEDRAL_NORMALS
+#define OCTAHEDRAL_NORMALS 0
+#endif
 layout (location = 0) in vec3 aPos;
+#if OCTAHEDRAL_NORMALS
+#include "octahedral.glsl"
+layout (location = 1) in vec2 aNormal;  // 八面体编码的法线，见 include/vertex_layout.h
+#else
 layout (location = 1) in vec3 aNormal;
+#endif
 layout (location = 2) in vec2 aTexCoords;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
-uniform mat4 model;
+layout (location = 3) in mat4 aModel;  // 每实例的 model 矩阵，见 include/instancing.h
+layout (location = 7) in mat3 aNormalMatrix;  // CPU 端预先求好的法线矩阵
+#ifndef USE_TEXTURE_ARRAY
+#define USE_TEXTURE_ARRAY 0
+#endif
+#if USE_TEXTURE_ARRAY
+layout (location = 10) in vec2 aMaterialLayers;  // 每实例的 diffuse/specular 层号，见 include/texture_array.h
+flat out vec2 MaterialLayers;
+#endif
 uniform mat4 view;
 uniform mat4 projection;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    FragPos = vec3(aModel * vec4(aPos, 1.0));
+#if OCTAHEDRAL_NORMALS
+    Normal = aNormalMatrix * DecodeNormal(aNormal);
+#else
+    Normal = aNormalMatrix * aNormal;
+#endif
     TexCoords = aTexCoords;
+#if USE_TEXTURE_ARRAY
+    MaterialLayers = aMaterialLayers;
+#endif
 
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
@@ -0,0 +1,72 @@
+#version 330 core
+out vec4 FragColor;
+
+#include "lighting.glsl"
+
+// 与 include/cluster.h 中的 CLUSTER_X/Y/Z 保持一致
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+    float shininess;
+};
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform Material material;
+
+// 所有点光源，由 FetchPointLight 读取
+uniform samplerBuffer clusterLights;
+// 每个 cluster 一个 (offset, count)，指向 clusterIndices 中的一段
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterIndices;
+// z slice = log(depth) * clusterScale + clusterBias
+uniform float clusterScale;
+uniform float clusterBias;
+uniform float zNear;
+uniform float zFar;
+uniform vec2 screenSize;
+// false 时遍历所有光源，作为对比用的 O(fragments x lights) 基准
+uniform bool useClusters;
+uniform int lightCount;
+
+void main()
+{
+    vec3 norm = normalize(Normal);
+    vec3 viewDir = normalize(viewPos - FragPos);
+    Surface surface;
+    surface.albedo = vec3(texture(material.diffuse, TexCoords));
+    surface.specular = vec3(texture(material.specular, TexCoords));
+    surface.shininess = material.shininess;
+
+    vec3 result = CalcDirLight(dirLight, norm, viewDir, surface);
+
+    if (useClusters) {
+        // 从窗口坐标与线性深度算出当前片段所在的 cluster
+        float ndcZ = gl_FragCoord.z * 2.0 - 1.0;
+        float depth = 2.0 * zNear * zFar / (zFar + zNear - ndcZ * (zFar - zNear));
+        int slice = clamp(int(log(depth) * clusterScale + clusterBias), 0, CLUSTER_Z - 1);
+        ivec2 tile = clamp(ivec2(gl_FragCoord.xy / screenSize * vec2(CLUSTER_X, CLUSTER_Y)),
+                           ivec2(0), ivec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+        int cluster = (slice * CLUSTER_Y + tile.y) * CLUSTER_X + tile.x;
+        uvec2 range = texelFetch(clusterGrid, cluster).xy;
+        for (uint i = 0u; i < range.y; i++) {
+            int index = int(texelFetch(clusterIndices, int(range.x + i)).x);
+            PointLight light = FetchPointLight(clusterLights, index);
+            result += CalcPointLight(light, norm, FragPos, viewDir, surface);
+        }
+    } else {
+        for (int i = 0; i < lightCount; i++) {
+            PointLight light = FetchPointLight(clusterLights, i);
+            result += CalcPointLight(light, norm, FragPos, viewDir, surface);
+        }
+    }
+
+    result += CalcSpotLight(spotLight, norm, FragPos, viewDir, surface);
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+// light.vs 改为读取预计算法线矩阵之前的版本，每个顶点都求一次 4x4 逆矩阵，只用于 bench_normal_matrix
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+layout (location = 3) in mat4 aModel;  // 每实例的 model 矩阵，见 include/instancing.h
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    FragPos = vec3(aModel * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(aModel))) * aNormal;
+    TexCoords = aTexCoords;
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,8 @@
+// BC5 法线贴图解码：烘焙时只保留切线空间法线的 XY (无符号归一化)，Z 在这里重建
+
+vec3 DecodeNormalMap(vec2 rg)
+{
+    vec2 xy = rg * 2.0 - 1.0;
+    // 块压缩的误差可能让 x² + y² 略大于 1
+    return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
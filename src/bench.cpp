@@ -0,0 +1,2751 @@
+#include "bench.h"
+
+// clangd-format off
+#include <glad/glad.h>
+// clangd-format on
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "block_compress.h"
+#include "camera.h"
+#include "cluster.h"
+#include "deferred.h"
+#include "geometry.h"
+#include "gl_state.h"
+#include "instancing.h"
+#include "lighting.h"
+#include "mesh.h"
+#include "mesh_cache.h"
+#include "mesh_import.h"
+#include "mesh_optimizer.h"
+#include "mip_generator.h"
+#include "program_cache.h"
+#include "render_queue.h"
+#include "shader.h"
+#include "stb_image.h"
+#include "texture_array.h"
+#include "texture_bake.h"
+#include "texture_cache.h"
+#include "texture_residency.h"
+#include "texture_loader.h"
+#include "vertex_layout.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr uint32_t BENCH_WIDTH = 800;
+constexpr uint32_t BENCH_HEIGHT = 600;
+
+// 创建一个不可见的窗口，只为了拿到一个 3.3 core 的 GL context
+GLFWwindow *create_bench_window()
+{
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow *window = glfwCreateWindow(BENCH_WIDTH, BENCH_HEIGHT, "bench", NULL, NULL);
+    if (window == NULL) {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return nullptr;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        glfwTerminate();
+        return nullptr;
+    }
+    // 新的 context，之前记录的状态影子全部作废
+    gl_state().invalidate();
+    return window;
+}
+
+// 离屏渲染目标：隐藏窗口的默认 framebuffer 不保证会被真正光栅化
+struct RenderTarget {
+    uint32_t fbo;
+    uint32_t color;
+    uint32_t depth;
+};
+
+RenderTarget create_render_target(uint32_t width, uint32_t height)
+{
+    RenderTarget target;
+    glGenFramebuffers(1, &target.fbo);
+    glGenRenderbuffers(1, &target.color);
+    glGenRenderbuffers(1, &target.depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    gl_state().bind_framebuffer(GL_FRAMEBUFFER, target.fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER,
+                              target.depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::BENCH::FRAMEBUFFER_INCOMPLETE" << std::endl;
+    gl_state().viewport(0, 0, width, height);
+    return target;
+}
+
+void release_render_target(RenderTarget &target)
+{
+    gl_state().bind_framebuffer(GL_FRAMEBUFFER, 0);
+    gl_state().delete_framebuffers(1, &target.fbo);
+    glDeleteRenderbuffers(1, &target.color);
+    glDeleteRenderbuffers(1, &target.depth);
+}
+
+// 1x1 的纯色纹理，代替 benchmark 不关心的材质贴图
+uint32_t solid_texture(uint8_t r, uint8_t g, uint8_t b)
+{
+    const uint8_t pixel[4] = {r, g, b, 255};
+    uint32_t texture;
+    glGenTextures(1, &texture);
+    gl_state().edit_texture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return texture;
+}
+
+// 用 CUBE_VERTICES 建立 position/normal/texcoord 三个属性的 VAO
+uint32_t create_cube_vao(uint32_t &vbo)
+{
+    uint32_t vao;
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    gl_state().bind_vertex_array(vao);
+    gl_state().bind_buffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_VERTICES), CUBE_VERTICES, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, CUBE_STRIDE, (void *)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, CUBE_STRIDE, (void *)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, CUBE_STRIDE, (void *)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    return vao;
+}
+
+// 经纬度球面，顶点布局与 CUBE_VERTICES 相同 (position, normal, texcoord)，用于顶点吞吐测试
+// 三角形从外面看是逆时针
+void uv_sphere(uint32_t rings, uint32_t sectors, std::vector<float> &vertices,
+               std::vector<uint32_t> &indices)
+{
+    const float pi = 3.14159265358979f;
+    vertices.clear();
+    indices.clear();
+    vertices.reserve((rings + 1) * (sectors + 1) * 8);
+    for (uint32_t r = 0; r <= rings; r++) {
+        float phi = pi * r / rings;
+        for (uint32_t s = 0; s <= sectors; s++) {
+            float theta = 2.0f * pi * s / sectors;
+            glm::vec3 n(std::sin(phi) * std::cos(theta), std::cos(phi),
+                        std::sin(phi) * std::sin(theta));
+            vertices.insert(vertices.end(), {n.x * 0.5f, n.y * 0.5f, n.z * 0.5f, n.x, n.y, n.z,
+                                             (float)s / sectors, (float)r / rings});
+        }
+    }
+    indices.reserve(rings * sectors * 6);
+    for (uint32_t r = 0; r < rings; r++) {
+        for (uint32_t s = 0; s < sectors; s++) {
+            uint32_t i0 = r * (sectors + 1) + s;
+            uint32_t i1 = i0 + sectors + 1;
+            indices.insert(indices.end(), {i0, i0 + 1, i1, i0 + 1, i1 + 1, i1});
+        }
+    }
+}
+
+// 圆环，布局与卷绕同 uv_sphere：rings 为绕中心圆的分段数，sides 为绕管截面的分段数
+IndexedMesh torus(uint32_t rings, uint32_t sides, float majorRadius, float minorRadius)
+{
+    const float pi = 3.14159265358979f;
+    IndexedMesh mesh;
+    mesh.components = 8;
+    for (uint32_t r = 0; r <= rings; r++) {
+        float theta = 2.0f * pi * r / rings;
+        for (uint32_t s = 0; s <= sides; s++) {
+            float phi = 2.0f * pi * s / sides;
+            glm::vec3 n(std::cos(phi) * std::cos(theta), std::sin(phi),
+                        std::cos(phi) * std::sin(theta));
+            glm::vec3 p(majorRadius * std::cos(theta), 0.0f, majorRadius * std::sin(theta));
+            p = p + n * minorRadius;
+            mesh.vertices.insert(mesh.vertices.end(), {p.x, p.y, p.z, n.x, n.y, n.z,
+                                                       (float)r / rings, (float)s / sides});
+        }
+    }
+    for (uint32_t r = 0; r < rings; r++) {
+        for (uint32_t s = 0; s < sides; s++) {
+            uint32_t i0 = r * (sides + 1) + s;
+            uint32_t i1 = i0 + sides + 1;
+            mesh.indices.insert(mesh.indices.end(), {i0, i0 + 1, i1, i0 + 1, i1 + 1, i1});
+        }
+    }
+    return mesh;
+}
+
+// 打乱三角形与顶点的顺序，模拟导出工具或扫描重建得到的没有任何局部性的网格
+void shuffle_mesh(IndexedMesh &mesh, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    const size_t triangleCount = mesh.indices.size() / 3;
+    std::vector<uint32_t> triangles(triangleCount);
+    for (uint32_t t = 0; t < triangleCount; t++) triangles[t] = t;
+    std::shuffle(triangles.begin(), triangles.end(), random);
+    std::vector<uint32_t> remap(mesh.vertex_count());
+    for (uint32_t v = 0; v < remap.size(); v++) remap[v] = v;
+    std::shuffle(remap.begin(), remap.end(), random);
+
+    std::vector<uint32_t> indices(mesh.indices.size());
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (uint32_t c = 0; c < 3; c++)
+            indices[t * 3 + c] = remap[mesh.indices[triangles[t] * 3 + c]];
+    }
+    std::vector<float> vertices(mesh.vertices.size());
+    for (size_t v = 0; v < remap.size(); v++) {
+        std::copy_n(&mesh.vertices[v * mesh.components], mesh.components,
+                    &vertices[remap[v] * mesh.components]);
+    }
+    mesh.indices = std::move(indices);
+    mesh.vertices = std::move(vertices);
+}
+
+// 执行 fn iterations 次，返回每次的平均耗时 (ns)
+template <typename Fn>
+double time_per_iteration(uint32_t iterations, Fn &&fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) fn(i);
+    glFinish();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+// 丢弃文件在 page cache 中的页，模拟冷启动；Windows 上没有对应的接口，返回 false
+bool drop_file_cache(const std::string &path)
+{
+#ifdef _WIN32
+    (void)path;
+    return false;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    // 刚写入的文件还有脏页，DONTNEED 只会丢弃已经落盘的干净页
+    bool dropped = fdatasync(fd) == 0 && posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return dropped;
+#endif
+}
+
+// target (GL_SAMPLES_PASSED、GL_VERTEX_SHADER_INVOCATIONS 等) 在 draw() 期间的计数，等待结果返回
+template <typename Fn>
+uint64_t query_count(GLenum target, Fn &&draw)
+{
+    uint32_t query;
+    glGenQueries(1, &query);
+    glBeginQuery(target, query);
+    draw();
+    glEndQuery(target);
+    GLuint64 result = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &result);
+    glDeleteQueries(1, &query);
+    return result;
+}
+
+// 顶点着色器的调用次数只有 pipeline statistics query (4.6 核心或 ARB 扩展) 能数出来
+bool has_pipeline_statistics()
+{
+    return GLAD_GL_VERSION_4_6 || has_extension("GL_ARB_pipeline_statistics_query");
+}
+
+// light_legacy.fs 中逐个上传的光照 uniform 句柄
+struct DirLightUniforms {
+    Uniform<glm::vec3> direction;
+    Uniform<glm::vec3> ambient;
+    Uniform<glm::vec3> diffuse;
+    Uniform<glm::vec3> specular;
+
+    DirLightUniforms(const Shader &shader, const std::string &prefix)
+        : direction(shader.uniform<glm::vec3>(prefix + "direction")),
+          ambient(shader.uniform<glm::vec3>(prefix + "ambient")),
+          diffuse(shader.uniform<glm::vec3>(prefix + "diffuse")),
+          specular(shader.uniform<glm::vec3>(prefix + "specular"))
+    {}
+};
+
+struct PointLightUniforms {
+    Uniform<glm::vec3> position;
+    Uniform<float> constant;
+    Uniform<float> linear;
+    Uniform<float> quadratic;
+    Uniform<glm::vec3> ambient;
+    Uniform<glm::vec3> diffuse;
+    Uniform<glm::vec3> specular;
+
+    PointLightUniforms(const Shader &shader, const std::string &prefix)
+        : position(shader.uniform<glm::vec3>(prefix + "position")),
+          constant(shader.uniform<float>(prefix + "constant")),
+          linear(shader.uniform<float>(prefix + "linear")),
+          quadratic(shader.uniform<float>(prefix + "quadratic")),
+          ambient(shader.uniform<glm::vec3>(prefix + "ambient")),
+          diffuse(shader.uniform<glm::vec3>(prefix + "diffuse")),
+          specular(shader.uniform<glm::vec3>(prefix + "specular"))
+    {}
+};
+
+struct SpotLightUniforms : PointLightUniforms {
+    Uniform<glm::vec3> direction;
+    Uniform<float> cutOff;
+    Uniform<float> outerCutOff;
+
+    SpotLightUniforms(const Shader &shader, const std::string &prefix)
+        : PointLightUniforms(shader, prefix),
+          direction(shader.uniform<glm::vec3>(prefix + "direction")),
+          cutOff(shader.uniform<float>(prefix + "cutOff")),
+          outerCutOff(shader.uniform<float>(prefix + "outerCutOff"))
+    {}
+};
+
+struct LegacyLightingUniforms : LightingUniforms {
+    Uniform<glm::vec3> viewPos;
+    DirLightUniforms dirLight;
+    PointLightUniforms pointLights[4];
+    SpotLightUniforms spotLight;
+
+    explicit LegacyLightingUniforms(const Shader &shader)
+        : LightingUniforms(shader),
+          viewPos(shader.uniform<glm::vec3>("viewPos")),
+          dirLight(shader, "dirLight."),
+          pointLights {{shader, "pointLights[0]."},
+                       {shader, "pointLights[1]."},
+                       {shader, "pointLights[2]."},
+                       {shader, "pointLights[3]."}},
+          spotLight(shader, "spotLight.")
+    {}
+};
+
+// 把 8 分量的索引网格写成 OBJ：v/vt/vn 各一行，f 的三个角都是 a/a/a，浮点数为最短的往返表示
+bool write_obj(const std::string &path, const IndexedMesh &mesh)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::string buffer;
+    char number[32];
+    auto flush = [&](bool force) {
+        if (!force && buffer.size() < (1 << 20)) return;
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    };
+    auto append = [&](auto value) {
+        buffer.append(number, std::to_chars(number, number + sizeof(number), value).ptr);
+    };
+    const size_t vertexCount = mesh.vertex_count();
+    struct Attribute {
+        const char *tag;
+        uint32_t offset;
+        uint32_t components;
+    };
+    for (const Attribute &attribute : {Attribute {"v", 0, 3}, {"vt", 6, 2}, {"vn", 3, 3}}) {
+        for (size_t v = 0; v < vertexCount; v++) {
+            buffer += attribute.tag;
+            for (uint32_t c = 0; c < attribute.components; c++) {
+                buffer += ' ';
+                append(mesh.vertices[v * 8 + attribute.offset + c]);
+            }
+            buffer += '\n';
+            flush(false);
+        }
+    }
+    for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+        buffer += 'f';
+        for (uint32_t c = 0; c < 3; c++) {
+            for (uint32_t k = 0; k < 3; k++) {
+                buffer += k == 0 ? ' ' : '/';
+                append(mesh.indices[i + c] + 1);
+            }
+        }
+        buffer += '\n';
+        flush(false);
+    }
+    flush(true);
+    return static_cast<bool>(file);
+}
+
+// 同一网格写成 .glb：顶点交错存放在一个 byteStride 为 32 的 bufferView 中，索引为 uint32
+bool write_glb(const std::string &path, const IndexedMesh &mesh)
+{
+    const size_t vertexCount = mesh.vertex_count();
+    const size_t vertexBytes = mesh.vertices.size() * sizeof(float);
+    const size_t indexBytes = mesh.indices.size() * sizeof(uint32_t);
+    glm::vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+    for (size_t v = 0; v < vertexCount; v++) {
+        glm::vec3 p(mesh.vertices[v * 8], mesh.vertices[v * 8 + 1], mesh.vertices[v * 8 + 2]);
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    std::ostringstream json;
+    json.precision(9);
+    json << R"({"asset":{"version":"2.0"},"scene":0,"scenes":[{"nodes":[0]}],)"
+         << R"("nodes":[{"mesh":0}],"meshes":[{"primitives":[{"attributes":)"
+         << R"({"POSITION":0,"NORMAL":1,"TEXCOORD_0":2},"indices":3}]}],)"
+         << R"("buffers":[{"byteLength":)" << vertexBytes + indexBytes << "}],"
+         << R"("bufferViews":[{"buffer":0,"byteLength":)" << vertexBytes
+         << R"(,"byteStride":32},{"buffer":0,"byteOffset":)" << vertexBytes
+         << R"(,"byteLength":)" << indexBytes << "}],"
+         << R"("accessors":[{"bufferView":0,"componentType":5126,"count":)" << vertexCount
+         << R"(,"type":"VEC3","min":[)" << lo.x << "," << lo.y << "," << lo.z << "],\"max\":["
+         << hi.x << "," << hi.y << "," << hi.z << "]},"
+         << R"({"bufferView":0,"byteOffset":12,"componentType":5126,"count":)" << vertexCount
+         << R"(,"type":"VEC3"},{"bufferView":0,"byteOffset":24,"componentType":5126,"count":)"
+         << vertexCount << R"(,"type":"VEC2"},{"bufferView":1,"componentType":5125,"count":)"
+         << mesh.indices.size() << R"(,"type":"SCALAR"}]})";
+    std::string text = json.str();
+    while (text.size() % 4 != 0) text += ' ';
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    const uint32_t header[5] = {0x46546C67, 2,
+                                static_cast<uint32_t>(12 + 8 + text.size() + 8 + vertexBytes +
+                                                      indexBytes),
+                                static_cast<uint32_t>(text.size()), 0x4E4F534A};
+    const uint32_t binary[2] = {static_cast<uint32_t>(vertexBytes + indexBytes), 0x004E4942};
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    file.write(text.data(), static_cast<std::streamsize>(text.size()));
+    file.write(reinterpret_cast<const char *>(binary), sizeof(binary));
+    file.write(reinterpret_cast<const char *>(mesh.vertices.data()),
+               static_cast<std::streamsize>(vertexBytes));
+    file.write(reinterpret_cast<const char *>(mesh.indices.data()),
+               static_cast<std::streamsize>(indexBytes));
+    return static_cast<bool>(file);
+}
+
+// 对照：常见的写法，std::getline 逐行读取、std::istringstream 解析，展开成三角形列表后再焊接
+// 只处理 write_obj 写出的三角形与 a/b/c 形式的角
+bool load_obj_naive(const std::string &path, IndexedMesh &mesh)
+{
+    std::ifstream file(path);
+    if (!file) return false;
+    std::vector<glm::vec3> positions, normals;
+    std::vector<glm::vec2> texcoords;
+    std::vector<float> corners;
+    std::string line, type, corner;
+    while (std::getline(file, line)) {
+        std::istringstream in(line);
+        in >> type;
+        if (type == "v") {
+            glm::vec3 p;
+            in >> p.x >> p.y >> p.z;
+            positions.push_back(p);
+        } else if (type == "vt") {
+            glm::vec2 t;
+            in >> t.x >> t.y;
+            texcoords.push_back(t);
+        } else if (type == "vn") {
+            glm::vec3 n;
+            in >> n.x >> n.y >> n.z;
+            normals.push_back(n);
+        } else if (type == "f") {
+            while (in >> corner) {
+                size_t v = 0, vt = 0, vn = 0;
+                char slash;
+                std::istringstream(corner) >> v >> slash >> vt >> slash >> vn;
+                if (v == 0 || v > positions.size() || vt == 0 || vt > texcoords.size() ||
+                    vn == 0 || vn > normals.size())
+                    return false;
+                const glm::vec3 &p = positions[v - 1], &n = normals[vn - 1];
+                corners.insert(corners.end(), {p.x, p.y, p.z, n.x, n.y, n.z, texcoords[vt - 1].x,
+                                               texcoords[vt - 1].y});
+            }
+        }
+    }
+    mesh = weld_vertices(corners.data(), corners.size() / 8, 8);
+    return true;
+}
+
+}  // namespace
+
+void bench_uniforms()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    // 前三种写法针对逐个 uniform 上传的旧版 light.fs
+    Shader shader("./shader/light.vs", "./shader/light_legacy.fs");
+    shader.use();
+
+    const glm::vec3 pointLightPositions[] = {
+        glm::vec3(0.7f, 0.2f, 2.0f), glm::vec3(2.3f, -3.3f, -4.0f), glm::vec3(-4.0f, 2.0f, -12.0f),
+        glm::vec3(0.0f, 0.0f, -3.0f)};
+    const glm::vec3 viewPos(0.0f, 0.0f, 3.0f);
+    const glm::vec3 front(0.0f, 0.0f, -1.0f);
+    const glm::mat4 view(1.0f);
+    const glm::mat4 projection = glm::perspective(
+        glm::radians(45.0f), (float)BENCH_WIDTH / (float)BENCH_HEIGHT, 0.1f, 100.0f);
+    constexpr uint32_t ITERATIONS = 20000;
+
+    // 1. 改造前 light() 的写法：每次调用都构造 std::string 并调用 glGetUniformLocation
+    const uint32_t id = shader.id_;
+    auto vec3 = [id](const std::string &name, const glm::vec3 &v) {
+        glUniform3fv(glGetUniformLocation(id, name.c_str()), 1, &v[0]);
+    };
+    auto float1 = [id](const std::string &name, float v) {
+        glUniform1f(glGetUniformLocation(id, name.c_str()), v);
+    };
+    auto mat4 = [id](const std::string &name, const glm::mat4 &v) {
+        glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &v[0][0]);
+    };
+    double byDriver = time_per_iteration(ITERATIONS, [&](uint32_t) {
+        vec3("viewPos", viewPos);
+        float1("material.shininess", 32.0f);
+        vec3("dirLight.direction", glm::vec3(-0.2f, -1.0f, -0.3f));
+        vec3("dirLight.ambient", glm::vec3(0.05f));
+        vec3("dirLight.diffuse", glm::vec3(0.4f));
+        vec3("dirLight.specular", glm::vec3(0.5f));
+        for (uint32_t i = 0; i < 4; i++) {
+            std::string prefix = "pointLights[" + std::to_string(i) + "].";
+            vec3(prefix + "position", pointLightPositions[i]);
+            vec3(prefix + "ambient", glm::vec3(0.05f));
+            vec3(prefix + "diffuse", glm::vec3(0.8f));
+            vec3(prefix + "specular", glm::vec3(1.0f));
+            float1(prefix + "constant", 1.0f);
+            float1(prefix + "linear", 0.09f);
+            float1(prefix + "quadratic", 0.032f);
+        }
+        vec3("spotLight.position", viewPos);
+        vec3("spotLight.direction", front);
+        vec3("spotLight.ambient", glm::vec3(0.0f));
+        vec3("spotLight.diffuse", glm::vec3(1.0f));
+        vec3("spotLight.specular", glm::vec3(1.0f));
+        float1("spotLight.constant", 1.0f);
+        float1("spotLight.linear", 0.09f);
+        float1("spotLight.quadratic", 0.032f);
+        float1("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
+        float1("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
+        mat4("projection", projection);
+        mat4("view", view);
+    });
+
+    // 2. 字符串接口，查询走 Shader 内部的哈希表
+    const char *pointLightNames[4][7] = {
+        {"pointLights[0].position", "pointLights[0].ambient", "pointLights[0].diffuse",
+         "pointLights[0].specular", "pointLights[0].constant", "pointLights[0].linear",
+         "pointLights[0].quadratic"},
+        {"pointLights[1].position", "pointLights[1].ambient", "pointLights[1].diffuse",
+         "pointLights[1].specular", "pointLights[1].constant", "pointLights[1].linear",
+         "pointLights[1].quadratic"},
+        {"pointLights[2].position", "pointLights[2].ambient", "pointLights[2].diffuse",
+         "pointLights[2].specular", "pointLights[2].constant", "pointLights[2].linear",
+         "pointLights[2].quadratic"},
+        {"pointLights[3].position", "pointLights[3].ambient", "pointLights[3].diffuse",
+         "pointLights[3].specular", "pointLights[3].constant", "pointLights[3].linear",
+         "pointLights[3].quadratic"}};
+    double byName = time_per_iteration(ITERATIONS, [&](uint32_t) {
+        shader.set_vec3("viewPos", viewPos);
+        shader.set_float("material.shininess", 32.0f);
+        shader.set_vec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
+        shader.set_vec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
+        shader.set_vec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
+        shader.set_vec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
+        for (uint32_t i = 0; i < 4; i++) {
+            shader.set_vec3(pointLightNames[i][0], pointLightPositions[i]);
+            shader.set_vec3(pointLightNames[i][1], 0.05f, 0.05f, 0.05f);
+            shader.set_vec3(pointLightNames[i][2], 0.8f, 0.8f, 0.8f);
+            shader.set_vec3(pointLightNames[i][3], 1.0f, 1.0f, 1.0f);
+            shader.set_float(pointLightNames[i][4], 1.0f);
+            shader.set_float(pointLightNames[i][5], 0.09f);
+            shader.set_float(pointLightNames[i][6], 0.032f);
+        }
+        shader.set_vec3("spotLight.position", viewPos);
+        shader.set_vec3("spotLight.direction", front);
+        shader.set_vec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
+        shader.set_vec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
+        shader.set_vec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
+        shader.set_float("spotLight.constant", 1.0f);
+        shader.set_float("spotLight.linear", 0.09f);
+        shader.set_float("spotLight.quadratic", 0.032f);
+        shader.set_float("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
+        shader.set_float("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
+        shader.set_mat4("projection", projection);
+        shader.set_mat4("view", view);
+    });
+
+    // 3. 预解析句柄
+    LegacyLightingUniforms loc(shader);
+    double byHandle = time_per_iteration(ITERATIONS, [&](uint32_t) {
+        shader.set(loc.viewPos, viewPos);
+        shader.set(loc.shininess, 32.0f);
+        shader.set(loc.dirLight.direction, -0.2f, -1.0f, -0.3f);
+        shader.set(loc.dirLight.ambient, 0.05f, 0.05f, 0.05f);
+        shader.set(loc.dirLight.diffuse, 0.4f, 0.4f, 0.4f);
+        shader.set(loc.dirLight.specular, 0.5f, 0.5f, 0.5f);
+        for (uint32_t i = 0; i < 4; i++) {
+            shader.set(loc.pointLights[i].position, pointLightPositions[i]);
+            shader.set(loc.pointLights[i].ambient, 0.05f, 0.05f, 0.05f);
+            shader.set(loc.pointLights[i].diffuse, 0.8f, 0.8f, 0.8f);
+            shader.set(loc.pointLights[i].specular, 1.0f, 1.0f, 1.0f);
+            shader.set(loc.pointLights[i].constant, 1.0f);
+            shader.set(loc.pointLights[i].linear, 0.09f);
+            shader.set(loc.pointLights[i].quadratic, 0.032f);
+        }
+        shader.set(loc.spotLight.position, viewPos);
+        shader.set(loc.spotLight.direction, front);
+        shader.set(loc.spotLight.ambient, 0.0f, 0.0f, 0.0f);
+        shader.set(loc.spotLight.diffuse, 1.0f, 1.0f, 1.0f);
+        shader.set(loc.spotLight.specular, 1.0f, 1.0f, 1.0f);
+        shader.set(loc.spotLight.constant, 1.0f);
+        shader.set(loc.spotLight.linear, 0.09f);
+        shader.set(loc.spotLight.quadratic, 0.032f);
+        shader.set(loc.spotLight.cutOff, glm::cos(glm::radians(12.5f)));
+        shader.set(loc.spotLight.outerCutOff, glm::cos(glm::radians(15.0f)));
+        shader.set(loc.projection, projection);
+        shader.set(loc.view, view);
+    });
+
+    // 4. Lighting uniform block，即现在 light() 渲染循环里的写法：
+    //    剩下的 4 个 uniform 走句柄，光照参数整体一次 glBufferSubData
+    Shader blockShader("./shader/light.vs", "./shader/light.fs");
+    blockShader.use();
+    LightingBuffer lightingBuffer;
+    lightingBuffer.attach(blockShader);
+    LightingUniforms blockLoc(blockShader);
+    LightBlock lights = scene_light_block(pointLightPositions);
+    double byBlock = time_per_iteration(ITERATIONS, [&](uint32_t) {
+        blockShader.set(blockLoc.shininess, 32.0f);
+        lights.viewPos = viewPos;
+        lights.spotLight.position = viewPos;
+        lights.spotLight.direction = front;
+        lightingBuffer.upload(lights);
+        blockShader.set(blockLoc.projection, projection);
+        blockShader.set(blockLoc.view, view);
+    });
+
+    std::cout << "bench_uniforms: " << ITERATIONS << " frames of the light() uniform block\n"
+              << "  glGetUniformLocation + std::string : " << byDriver
+              << " ns/frame, 88 GL calls\n"
+              << "  Shader name lookup (hash table)    : " << byName << " ns/frame, 44 GL calls\n"
+              << "  pre-resolved Uniform<T> handles    : " << byHandle << " ns/frame, 44 GL calls\n"
+              << "  Lighting uniform block             : " << byBlock << " ns/frame, 5 GL calls"
+              << std::endl;
+
+    glDeleteProgram(shader.id_);
+    glDeleteProgram(blockShader.id_);
+    gl_state().delete_buffers(1, &lightingBuffer.id_);
+    glfwTerminate();
+}
+
+void bench_clustered()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    RenderTarget target = create_render_target(BENCH_WIDTH, BENCH_HEIGHT);
+    gl_state().enable(GL_DEPTH_TEST);
+
+    uint32_t vbo;
+    uint32_t vao = create_cube_vao(vbo);
+    uint32_t diffuse = solid_texture(200, 160, 120);
+    uint32_t specular = solid_texture(128, 128, 128);
+
+    const float zNear = 0.1f;
+    const float zFar = 100.0f;
+    const float fovy = glm::radians(45.0f);
+    const float aspect = (float)BENCH_WIDTH / (float)BENCH_HEIGHT;
+    const glm::vec3 viewPos(0.0f, 0.0f, 3.0f);
+    const glm::mat4 view = glm::lookAt(viewPos, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0, 1, 0));
+    const glm::mat4 projection = glm::perspective(fovy, aspect, zNear, zFar);
+
+    Shader shader("./shader/light.vs", "./shader/light_clustered.fs");
+    LightingBuffer lightingBuffer;
+    lightingBuffer.attach(shader);
+    glm::vec3 unusedPositions[NR_POINT_LIGHTS] = {};
+    LightBlock lights = scene_light_block(unusedPositions);
+    lights.viewPos = viewPos;
+    lights.spotLight.position = viewPos;
+    lights.spotLight.direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    lightingBuffer.upload(lights);
+    ClusterGrid clusters(zNear, zFar);
+    clusters.attach(shader, BENCH_WIDTH, BENCH_HEIGHT);
+
+    shader.use();
+    shader.set_int("material.diffuse", 0);
+    shader.set_int("material.specular", 1);
+    shader.set_float("material.shininess", 32.0f);
+    LightingUniforms loc(shader);
+    shader.set(loc.projection, projection);
+    shader.set(loc.view, view);
+    auto useClusters = shader.uniform<bool>("useClusters");
+    auto lightCount = shader.uniform<int>("lightCount");
+
+    gl_state().bind_texture(0, GL_TEXTURE_2D, diffuse);
+    gl_state().bind_texture(1, GL_TEXTURE_2D, specular);
+    gl_state().bind_vertex_array(vao);
+
+    InstanceBuffer instances;
+    instances.attach(vao);
+    std::vector<glm::mat4> models;
+    for (uint32_t i = 0; i < CUBE_POSITION_COUNT; i++) models.push_back(cube_model(i));
+    instances.upload(models, TransformKind::UniformScale);
+    gl_state().bind_vertex_array(vao);
+
+    constexpr uint32_t FRAMES = 30;
+    std::cout << "bench_clustered: " << FRAMES << " frames of the 10-cube scene at " << BENCH_WIDTH
+              << "x" << BENCH_HEIGHT << "\n"
+              << "  lights | assign (ms) | avg lights/cluster | clustered (ms) | brute force (ms)"
+              << std::endl;
+    for (uint32_t count = 4; count <= 4096; count *= 4) {
+        std::vector<PointLight> pointLights = random_point_lights(count);
+        shader.set(lightCount, (int)count);
+
+        auto drawScene = [&]() {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT, instances.count());
+        };
+
+        double assign = time_per_iteration(FRAMES, [&](uint32_t) {
+            clusters.update(pointLights, view, fovy, aspect);
+        });
+        clusters.bind();
+
+        shader.set(useClusters, true);
+        double clustered = time_per_iteration(FRAMES, [&](uint32_t) {
+            clusters.update(pointLights, view, fovy, aspect);
+            drawScene();
+        });
+
+        // 暴力遍历的耗时随灯数线性增长，灯数过多时只跑一帧避免 TDR
+        shader.set(useClusters, false);
+        double bruteForce =
+            time_per_iteration(count > 256 ? 1 : FRAMES, [&](uint32_t) { drawScene(); });
+
+        std::cout << "  " << count << " | " << assign * 1e-6 << " | "
+                  << (double)clusters.index_count() / CLUSTER_COUNT << " | " << clustered * 1e-6
+                  << " | " << bruteForce * 1e-6 << std::endl;
+    }
+
+    gl_state().delete_vertex_arrays(1, &vao);
+    gl_state().delete_buffers(1, &vbo);
+    gl_state().delete_textures(1, &diffuse);
+    gl_state().delete_textures(1, &specular);
+    gl_state().delete_buffers(1, &lightingBuffer.id_);
+    gl_state().delete_buffers(1, &instances.id_);
+    glDeleteProgram(shader.id_);
+    clusters.release();
+    release_render_target(target);
+    glfwTerminate();
+}
+
+void bench_deferred()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    RenderTarget target = create_render_target(BENCH_WIDTH, BENCH_HEIGHT);
+    gl_state().enable(GL_DEPTH_TEST);
+
+    uint32_t vbo;
+    uint32_t vao = create_cube_vao(vbo);
+    uint32_t diffuse = solid_texture(200, 160, 120);
+    uint32_t specular = solid_texture(128, 128, 128);
+
+    const glm::vec3 viewPos(0.0f, 0.0f, 3.0f);
+    const glm::mat4 view = glm::lookAt(viewPos, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0, 1, 0));
+    const glm::mat4 projection = glm::perspective(
+        glm::radians(45.0f), (float)BENCH_WIDTH / (float)BENCH_HEIGHT, 0.1f, 100.0f);
+
+    LightingBuffer lightingBuffer;
+    glm::vec3 unusedPositions[NR_POINT_LIGHTS] = {};
+    LightBlock lights = scene_light_block(unusedPositions);
+    lights.viewPos = viewPos;
+    lights.spotLight.position = viewPos;
+    lights.spotLight.direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    lightingBuffer.upload(lights);
+
+    // 前向：逐片段遍历所有点光源，被覆盖的片段也要完整计算一次光照
+    Shader forward("./shader/light.vs", "./shader/light_clustered.fs");
+    lightingBuffer.attach(forward);
+    ClusterGrid lightData(0.1f, 100.0f);
+    lightData.attach(forward, BENCH_WIDTH, BENCH_HEIGHT);
+    forward.use();
+    forward.set_int("material.diffuse", 0);
+    forward.set_int("material.specular", 1);
+    forward.set_float("material.shininess", 32.0f);
+    forward.set_bool("useClusters", false);
+    LightingUniforms forwardLoc(forward);
+    forward.set(forwardLoc.projection, projection);
+    forward.set(forwardLoc.view, view);
+    auto lightCount = forward.uniform<int>("lightCount");
+
+    // 延迟：几何 pass 只写 G-buffer，光照只对最终可见的像素计算一次
+    Shader geometry("./shader/light.vs", "./shader/gbuffer.fs");
+    geometry.use();
+    geometry.set_int("material.diffuse", 0);
+    geometry.set_int("material.specular", 1);
+    LightingUniforms geometryLoc(geometry);
+    geometry.set(geometryLoc.projection, projection);
+    geometry.set(geometryLoc.view, view);
+    DeferredRenderer deferred(BENCH_WIDTH, BENCH_HEIGHT);
+    deferred.attach(lightingBuffer);
+
+    // overdraw 层箱子按从远到近的顺序排成实例，实例按序光栅化，每一层都能通过深度测试
+    InstanceBuffer instances;
+    instances.attach(vao);
+    std::vector<glm::mat4> models;
+    auto drawScene = [&]() {
+        gl_state().bind_texture(0, GL_TEXTURE_2D, diffuse);
+        gl_state().bind_texture(1, GL_TEXTURE_2D, specular);
+        gl_state().bind_vertex_array(vao);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT, instances.count());
+    };
+
+    constexpr uint32_t FRAMES = 20;
+    std::cout << "bench_deferred: " << FRAMES << " frames at " << BENCH_WIDTH << "x"
+              << BENCH_HEIGHT << "\n"
+              << "  overdraw | lights | forward (ms) | deferred (ms)" << std::endl;
+    for (uint32_t overdraw = 1; overdraw <= 16; overdraw *= 4) {
+        models.clear();
+        for (uint32_t layer = overdraw; layer-- > 0;) {
+            glm::mat4 offset =
+                glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -0.05f * layer));
+            for (uint32_t i = 0; i < CUBE_POSITION_COUNT; i++)
+                models.push_back(offset * cube_model(i));
+        }
+        instances.upload(models, TransformKind::UniformScale);
+        for (uint32_t count = 4; count <= 256; count *= 4) {
+            std::vector<PointLight> pointLights = random_point_lights(count);
+            lightData.update(pointLights, view, glm::radians(45.0f),
+                             (float)BENCH_WIDTH / (float)BENCH_HEIGHT);
+            deferred.set_point_lights(pointLights);
+
+            double forwardTime = time_per_iteration(FRAMES, [&](uint32_t) {
+                gl_state().bind_framebuffer(GL_FRAMEBUFFER, target.fbo);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                forward.use();
+                forward.set(lightCount, (int)count);
+                lightData.bind();
+                drawScene();
+            });
+
+            double deferredTime = time_per_iteration(FRAMES, [&](uint32_t) {
+                gl_state().bind_framebuffer(GL_FRAMEBUFFER, target.fbo);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                deferred.begin_geometry();
+                geometry.use();
+                drawScene();
+                deferred.resolve(view, projection, 32.0f, target.fbo);
+            });
+
+            std::cout << "  " << overdraw << " | " << count << " | " << forwardTime * 1e-6 << " | "
+                      << deferredTime * 1e-6 << std::endl;
+        }
+    }
+
+    gl_state().delete_vertex_arrays(1, &vao);
+    gl_state().delete_buffers(1, &vbo);
+    gl_state().delete_textures(1, &diffuse);
+    gl_state().delete_textures(1, &specular);
+    gl_state().delete_buffers(1, &lightingBuffer.id_);
+    glDeleteProgram(forward.id_);
+    glDeleteProgram(geometry.id_);
+    gl_state().delete_buffers(1, &instances.id_);
+    lightData.release();
+    deferred.release();
+    release_render_target(target);
+    glfwTerminate();
+}
+
+void bench_instancing()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    RenderTarget target = create_render_target(BENCH_WIDTH, BENCH_HEIGHT);
+    gl_state().enable(GL_DEPTH_TEST);
+
+    uint32_t vbo;
+    uint32_t vao = create_cube_vao(vbo);
+
+    // light_cube 的片段着色器只输出常量颜色，耗时基本都落在 CPU 提交与顶点处理上
+    Shader shader("./shader/light_cube.vs", "./shader/light_cube.fs");
+    shader.use();
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 150.0f), glm::vec3(0.0f),
+                                       glm::vec3(0.0f, 1.0f, 0.0f));
+    shader.set_mat4("view", view);
+    shader.set_mat4("projection",
+                    glm::perspective(glm::radians(45.0f), (float)BENCH_WIDTH / (float)BENCH_HEIGHT,
+                                     0.1f, 1000.0f));
+
+    InstanceBuffer instances;
+    instances.attach(vao);
+    gl_state().bind_vertex_array(vao);
+
+    constexpr uint32_t FRAMES = 10;
+    std::cout << "bench_instancing: " << FRAMES << " frames at " << BENCH_WIDTH << "x"
+              << BENCH_HEIGHT << "\n"
+              << "  cubes | per-object draws (ms) | instanced (ms) | speedup" << std::endl;
+    for (uint32_t count = 1000; count <= 100000; count *= 10) {
+        std::vector<glm::mat4> models = cube_field(count);
+        instances.upload(models, TransformKind::UniformScale);
+
+        // 逐物体：关闭实例属性数组后 aModel 取自 glVertexAttrib4fv 设置的当前值，
+        // 等价于改造前每个箱子 set_mat4("model") + glDrawArrays 的写法
+        for (uint32_t c = 0; c < 4; c++) glDisableVertexAttribArray(INSTANCE_MODEL_LOCATION + c);
+        double perObject = time_per_iteration(FRAMES, [&](uint32_t) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            for (const glm::mat4 &model : models) {
+                for (uint32_t c = 0; c < 4; c++)
+                    glVertexAttrib4fv(INSTANCE_MODEL_LOCATION + c, &model[c][0]);
+                glDrawArrays(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT);
+            }
+        });
+
+        for (uint32_t c = 0; c < 4; c++) glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + c);
+        double instanced = time_per_iteration(FRAMES, [&](uint32_t) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT, instances.count());
+        });
+
+        std::cout << "  " << count << " | " << perObject * 1e-6 << " | " << instanced * 1e-6
+                  << " | " << perObject / instanced << "x" << std::endl;
+    }
+
+    gl_state().delete_vertex_arrays(1, &vao);
+    gl_state().delete_buffers(1, &vbo);
+    gl_state().delete_buffers(1, &instances.id_);
+    glDeleteProgram(shader.id_);
+    release_render_target(target);
+    glfwTerminate();
+}
+
+void bench_normal_matrix()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    // 1. CPU：10 万个带非等比缩放的 model 矩阵
+    constexpr uint32_t MATRIX_COUNT = 100000;
+    constexpr uint32_t CPU_ITERATIONS = 20;
+    std::vector<glm::mat4> models = cube_field(MATRIX_COUNT);
+    for (uint32_t i = 0; i < MATRIX_COUNT; i++)
+        models[i] = glm::scale(models[i], glm::vec3(1.0f + i % 3, 1.0f, 0.5f + i % 2));
+    std::vector<InstanceData> reference(MATRIX_COUNT), instances(MATRIX_COUNT);
+
+    double scalar = time_per_iteration(CPU_ITERATIONS, [&](uint32_t) {
+        build_instances_scalar(models.data(), MATRIX_COUNT, reference.data());
+    });
+    double simd = time_per_iteration(CPU_ITERATIONS, [&](uint32_t) {
+        build_instances(models.data(), MATRIX_COUNT, TransformKind::General, instances.data());
+    });
+    float maxError = 0.0f;
+    for (uint32_t i = 0; i < MATRIX_COUNT; i++) {
+        for (int c = 0; c < 3; c++) {
+            for (int r = 0; r < 3; r++)
+                maxError = std::max(maxError, std::abs(instances[i].normal[c][r] -
+                                                       reference[i].normal[c][r]));
+        }
+    }
+    double uniform = time_per_iteration(CPU_ITERATIONS, [&](uint32_t) {
+        build_instances(models.data(), MATRIX_COUNT, TransformKind::UniformScale,
+                        instances.data());
+    });
+
+    std::cout << "bench_normal_matrix: " << MATRIX_COUNT << " normal matrices on the CPU\n"
+              << "  glm::inverse (scalar)  : " << scalar * 1e-6 << " ms\n"
+              << "  SSE cofactor, 4 at once: " << simd * 1e-6 << " ms, max error " << maxError
+              << "\n"
+              << "  uniform scale fast path: " << uniform * 1e-6 << " ms" << std::endl;
+
+    // 2. GPU：高面数球体，渲染目标很小，耗时主要在顶点着色器
+    constexpr uint32_t TARGET_SIZE = 64;
+    RenderTarget target = create_render_target(TARGET_SIZE, TARGET_SIZE);
+    gl_state().enable(GL_DEPTH_TEST);
+
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    uv_sphere(1024, 1024, vertices, indices);
+    uint32_t vao, vbo, ebo;
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    gl_state().bind_vertex_array(vao);
+    gl_state().bind_buffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(),
+                 GL_STATIC_DRAW);
+    gl_state().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(),
+                 GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, CUBE_STRIDE, (void *)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, CUBE_STRIDE, (void *)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, CUBE_STRIDE, (void *)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    constexpr uint32_t SPHERES = 8;
+    InstanceBuffer sphereInstances;
+    sphereInstances.attach(vao);
+    std::vector<glm::mat4> sphereModels(models.begin(), models.begin() + SPHERES);
+    sphereInstances.upload(sphereModels);
+
+    uint32_t diffuse = solid_texture(200, 160, 120);
+    uint32_t specular = solid_texture(128, 128, 128);
+    gl_state().bind_texture(0, GL_TEXTURE_2D, diffuse);
+    gl_state().bind_texture(1, GL_TEXTURE_2D, specular);
+
+    const glm::vec3 viewPos(0.0f, 0.0f, 8.0f);
+    const glm::mat4 view = glm::lookAt(viewPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f);
+    LightingBuffer lightingBuffer;
+    glm::vec3 unusedPositions[NR_POINT_LIGHTS] = {};
+    LightBlock lights = scene_light_block(unusedPositions);
+    lights.viewPos = viewPos;
+    lightingBuffer.upload(lights);
+
+    // 两个 program 只有顶点着色器不同
+    auto drawFrames = [&](const Shader &shader) {
+        lightingBuffer.attach(shader);
+        shader.use();
+        shader.set_int("material.diffuse", 0);
+        shader.set_int("material.specular", 1);
+        LightingUniforms loc(shader);
+        shader.set(loc.shininess, 32.0f);
+        shader.set(loc.view, view);
+        shader.set(loc.projection, projection);
+        gl_state().bind_vertex_array(vao);
+        return time_per_iteration(10, [&](uint32_t) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, SPHERES);
+        });
+    };
+    Shader perVertex("./shader/light_inverse.vs", "./shader/light.fs");
+    Shader precomputed("./shader/light.vs", "./shader/light.fs");
+    double perVertexTime = drawFrames(perVertex);
+    double precomputedTime = drawFrames(precomputed);
+
+    double vertexCount = (double)vertices.size() / 8 * SPHERES;
+    std::cout << "  " << SPHERES << " spheres x " << indices.size() / 3 << " triangles at "
+              << TARGET_SIZE << "x" << TARGET_SIZE << "\n"
+              << "  transpose(inverse(model)) per vertex: " << perVertexTime * 1e-6 << " ms, "
+              << vertexCount / perVertexTime * 1e3 << " Mverts/s\n"
+              << "  precomputed aNormalMatrix           : " << precomputedTime * 1e-6 << " ms, "
+              << vertexCount / precomputedTime * 1e3 << " Mverts/s" << std::endl;
+
+    gl_state().delete_vertex_arrays(1, &vao);
+    gl_state().delete_buffers(1, &vbo);
+    gl_state().delete_buffers(1, &ebo);
+    gl_state().delete_buffers(1, &sphereInstances.id_);
+    gl_state().delete_buffers(1, &lightingBuffer.id_);
+    gl_state().delete_textures(1, &diffuse);
+    gl_state().delete_textures(1, &specular);
+    glDeleteProgram(perVertex.id_);
+    glDeleteProgram(precomputed.id_);
+    release_render_target(target);
+    glfwTerminate();
+}
+
+void bench_shader_compile()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+    bool parallel = Shader::enable_parallel_compile((GLADloadproc)glfwGetProcAddress);
+    // 测的是编译本身，program binary 缓存会让第二轮直接命中
+    program_cache().set_enabled(false);
+
+    // light.fs 的副本，每份在 #version 之后插入不同的注释，避开驱动自带的 shader 缓存
+    constexpr uint32_t PROGRAM_COUNT = 64;
+    std::ifstream sourceFile("./shader/light.fs");
+    std::stringstream sourceStream;
+    sourceStream << sourceFile.rdbuf();
+    std::string source = sourceStream.str();
+    size_t firstLine = source.find('\n') + 1;
+    auto nonce = std::chrono::steady_clock::now().time_since_epoch().count();
+    std::vector<std::string> paths;
+    for (uint32_t i = 0; i < PROGRAM_COUNT * 2; i++) {
+        paths.push_back("./shader/.compile_bench_" + std::to_string(i) + ".fs");
+        std::ofstream variant(paths.back());
+        variant << source.substr(0, firstLine) << "// compile bench " << nonce << " " << i << "\n"
+                << source.substr(firstLine);
+    }
+
+    auto since = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+            .count();
+    };
+
+    // 1. 同步：每个构造函数都在查询编译状态时等待驱动
+    std::vector<Shader> shaders;
+    shaders.reserve(PROGRAM_COUNT * 2);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < PROGRAM_COUNT; i++)
+        shaders.emplace_back("./shader/light.vs", paths[i].c_str());
+    double syncMs = since(start);
+
+    // 2. 异步：先全部提交，再轮询；提交完成时 fallback 就已经可以开始画第一帧
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = PROGRAM_COUNT; i < PROGRAM_COUNT * 2; i++)
+        shaders.emplace_back("./shader/light.vs", paths[i].c_str(), BuildMode::Async);
+    double submitMs = since(start);
+    uint32_t pending = PROGRAM_COUNT;
+    while (pending > 0) {
+        pending = 0;
+        for (uint32_t i = PROGRAM_COUNT; i < PROGRAM_COUNT * 2; i++) pending += !shaders[i].ready();
+    }
+    double asyncMs = since(start);
+
+    std::cout << "bench_shader_compile: " << PROGRAM_COUNT << " programs (light.vs + light.fs), "
+              << "GL_KHR_parallel_shader_compile " << (parallel ? "on" : "unavailable") << "\n"
+              << "  synchronous, one by one      : " << syncMs << " ms\n"
+              << "  async, all submitted         : " << submitMs << " ms (first frame possible)\n"
+              << "  async, all programs ready    : " << asyncMs << " ms" << std::endl;
+
+    for (const Shader &shader : shaders) glDeleteProgram(shader.id_);
+    std::error_code ec;
+    for (const std::string &path : paths) std::filesystem::remove(path, ec);
+    program_cache().set_enabled(true);
+    glfwTerminate();
+}
+
+void bench_shader_variants()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    RenderTarget target = create_render_target(BENCH_WIDTH, BENCH_HEIGHT);
+    gl_state().enable(GL_DEPTH_TEST);
+
+    uint32_t vbo;
+    uint32_t vao = create_cube_vao(vbo);
+    uint32_t diffuse = solid_texture(200, 160, 120);
+    uint32_t specular = solid_texture(128, 128, 128);
+    gl_state().bind_texture(0, GL_TEXTURE_2D, diffuse);
+    gl_state().bind_texture(1, GL_TEXTURE_2D, specular);
+
+    const glm::vec3 viewPos(0.0f, 0.0f, 3.0f);
+    const glm::mat4 view = glm::lookAt(viewPos, glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0, 1, 0));
+    const glm::mat4 projection = glm::perspective(
+        glm::radians(45.0f), (float)BENCH_WIDTH / (float)BENCH_HEIGHT, 0.1f, 100.0f);
+    glm::vec3 pointLightPositions[NR_POINT_LIGHTS] = {
+        glm::vec3(0.7f, 0.2f, 2.0f), glm::vec3(2.3f, -3.3f, -4.0f), glm::vec3(-4.0f, 2.0f, -12.0f),
+        glm::vec3(0.0f, 0.0f, -3.0f)};
+    LightingBuffer lightingBuffer;
+    LightBlock lights = scene_light_block(pointLightPositions);
+    lights.viewPos = viewPos;
+    lights.spotLight.position = viewPos;
+    lights.spotLight.direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    lightingBuffer.upload(lights);
+
+    // 16 层 overdraw，片段着色器占主要开销
+    InstanceBuffer instances;
+    instances.attach(vao);
+    std::vector<glm::mat4> models;
+    for (uint32_t layer = 16; layer-- > 0;) {
+        glm::mat4 offset = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -0.05f * layer));
+        for (uint32_t i = 0; i < CUBE_POSITION_COUNT; i++) models.push_back(offset * cube_model(i));
+    }
+    instances.upload(models, TransformKind::UniformScale);
+    gl_state().bind_vertex_array(vao);
+
+    struct Variant {
+        const char *label;
+        ShaderDefines defines;
+    };
+    const Variant variants[] = {
+        {"default (dir + 4 point + spot, specular map)", {}},
+        {"USE_SPOT_LIGHT=0", {{"USE_SPOT_LIGHT", "0"}}},
+        {"USE_SPOT_LIGHT=0 USE_SPECULAR_MAP=0",
+         {{"USE_SPOT_LIGHT", "0"}, {"USE_SPECULAR_MAP", "0"}}},
+        {"... + ACTIVE_POINT_LIGHTS=1",
+         {{"USE_SPOT_LIGHT", "0"}, {"USE_SPECULAR_MAP", "0"}, {"ACTIVE_POINT_LIGHTS", "1"}}},
+    };
+
+    ShaderVariants cache;
+    constexpr uint32_t FRAMES = 20;
+    std::cout << "bench_shader_variants: " << FRAMES << " frames, 16x overdraw at " << BENCH_WIDTH
+              << "x" << BENCH_HEIGHT << "\n"
+              << "  variant | first get (ms) | frame (ms)" << std::endl;
+    for (const Variant &variant : variants) {
+        auto start = std::chrono::steady_clock::now();
+        const Shader &shader = cache.get("./shader/light.vs", "./shader/light.fs", variant.defines);
+        double getMs =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                .count();
+        lightingBuffer.attach(shader);
+        shader.use();
+        shader.set_int("material.diffuse", 0);
+        shader.set_int("material.specular", 1);
+        LightingUniforms loc(shader);
+        shader.set(loc.shininess, 32.0f);
+        shader.set(loc.view, view);
+        shader.set(loc.projection, projection);
+        double frame = time_per_iteration(FRAMES, [&](uint32_t) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT, instances.count());
+        });
+        std::cout << "  " << variant.label << " | " << getMs << " | " << frame * 1e-6 << std::endl;
+    }
+
+    // 同一组 define 换个顺序再取一次，应当直接命中而不重新编译
+    auto start = std::chrono::steady_clock::now();
+    cache.get("./shader/light.vs", "./shader/light.fs",
+              {{"USE_SPECULAR_MAP", "0"}, {"USE_SPOT_LIGHT", "0"}});
+    double hitMs =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "  variant cache: " << cache.size() << " programs, " << cache.hits() << " hits, "
+              << cache.misses() << " misses, reordered define set resolved in " << hitMs << " ms"
+              << std::endl;
+
+    cache.release();
+    gl_state().delete_vertex_arrays(1, &vao);
+    gl_state().delete_buffers(1, &vbo);
+    gl_state().delete_buffers(1, &instances.id_);
+    gl_state().delete_buffers(1, &lightingBuffer.id_);
+    gl_state().delete_textures(1, &diffuse);
+    gl_state().delete_textures(1, &specular);
+    release_render_target(target);
+    glfwTerminate();
+}
+
+void bench_render_queue()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    RenderTarget target = create_render_target(BENCH_WIDTH, BENCH_HEIGHT);
+    gl_state().enable(GL_DEPTH_TEST);
+
+    // 两种网格：立方体 (glDrawArrays) 与低面数球体 (glDrawElements)
+    uint32_t cubeVbo;
+    uint32_t cubeVao = create_cube_vao(cubeVbo);
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    uv_sphere(16, 16, vertices, indices);
+    uint32_t sphereVao, sphereVbo, sphereEbo;
+    glGenVertexArrays(1, &sphereVao);
+    glGenBuffers(1, &sphereVbo);
+    glGenBuffers(1, &sphereEbo);
+    gl_state().bind_vertex_array(sphereVao);
+    gl_state().bind_buffer(GL_ARRAY_BUFFER, sphereVbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(),
+                 GL_STATIC_DRAW);
+    gl_state().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, sphereEbo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(),
+                 GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, CUBE_STRIDE, (void *)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, CUBE_STRIDE, (void *)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, CUBE_STRIDE, (void *)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    // 16 种纹理组合
+    constexpr uint32_t TEXTURE_SETS = 16;
+    std::vector<uint32_t> textures;
+    for (uint32_t i = 0; i < TEXTURE_SETS; i++) {
+        textures.push_back(solid_texture(64 + i * 12, 200 - i * 8, 96 + i * 5));
+        textures.push_back(solid_texture(32 * (i % 8), 32 * (i % 8), 32 * (i % 8)));
+    }
+
+    const glm::vec3 viewPos(0.0f, 0.0f, 40.0f);
+    const glm::mat4 view = glm::lookAt(viewPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projection = glm::perspective(
+        glm::radians(45.0f), (float)BENCH_WIDTH / (float)BENCH_HEIGHT, 0.1f, 100.0f);
+    glm::vec3 pointLightPositions[NR_POINT_LIGHTS] = {
+        glm::vec3(0.7f, 0.2f, 2.0f), glm::vec3(2.3f, -3.3f, -4.0f), glm::vec3(-4.0f, 2.0f, -12.0f),
+        glm::vec3(0.0f, 0.0f, -3.0f)};
+    LightingBuffer lightingBuffer;
+    LightBlock lights = scene_light_block(pointLightPositions);
+    lights.viewPos = viewPos;
+    lights.spotLight.position = viewPos;
+    lights.spotLight.direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    lightingBuffer.upload(lights);
+
+    // 4 个 program：light.fs 的不同特化，per-frame uniform 在循环外设置一次
+    const ShaderDefines defineSets[] = {
+        {},
+        {{"USE_SPOT_LIGHT", "0"}},
+        {{"USE_SPECULAR_MAP", "0"}},
+        {{"USE_SPOT_LIGHT", "0"}, {"ACTIVE_POINT_LIGHTS", "2"}},
+    };
+    ShaderVariants variants;
+    std::vector<const Shader *> shaders;
+    for (const ShaderDefines &defines : defineSets) {
+        const Shader &shader = variants.get("./shader/light.vs", "./shader/light.fs", defines);
+        lightingBuffer.attach(shader);
+        shader.use();
+        shader.set_int("material.diffuse", 0);
+        shader.set_int("material.specular", 1);
+        LightingUniforms loc(shader);
+        shader.set(loc.shininess, 32.0f);
+        shader.set(loc.view, view);
+        shader.set(loc.projection, projection);
+        shaders.push_back(&shader);
+    }
+
+    // 每个物体随机挑选 program、纹理组合与网格，提交顺序即场景遍历顺序
+    constexpr uint32_t OBJECTS = 4096;
+    std::vector<glm::mat4> models = cube_field(OBJECTS);
+    std::vector<DrawCommand> commands(OBJECTS);
+    std::vector<float> depths(OBJECTS);
+    std::mt19937 random(7);
+    for (uint32_t i = 0; i < OBJECTS; i++) {
+        DrawCommand &command = commands[i];
+        command.shader = shaders[random() % shaders.size()];
+        uint32_t set = random() % TEXTURE_SETS;
+        command.textures[0] = textures[set * 2];
+        command.textures[1] = textures[set * 2 + 1];
+        if (random() % 2) {
+            command.vao = cubeVao;
+            command.count = CUBE_VERTEX_COUNT;
+        } else {
+            command.vao = sphereVao;
+            command.indexType = GL_UNSIGNED_INT;
+            command.count = static_cast<int32_t>(indices.size());
+        }
+        depths[i] = glm::length(glm::vec3(models[i][3]) - viewPos);
+    }
+
+    // 改造前的写法：按提交顺序逐个设置状态并绘制，同样经过 gl_state() 过滤
+    RenderQueue::Stats immediateStats;
+    auto immediate = [&]() {
+        RenderQueue::Stats stats;
+        const DrawCommand *previous = nullptr;
+        for (uint32_t i = 0; i < OBJECTS; i++) {
+            const DrawCommand &command = commands[i];
+            if (!previous || previous->shader != command.shader) stats.programs++;
+            if (!previous || previous->vao != command.vao) stats.vertexArrays++;
+            for (uint32_t unit = 0; unit < DRAW_TEXTURE_UNITS; unit++) {
+                if (!previous || previous->textures[unit] != command.textures[unit])
+                    stats.textures++;
+            }
+            previous = &command;
+            command.shader->use();
+            gl_state().bind_vertex_array(command.vao);
+            gl_state().bind_texture(0, GL_TEXTURE_2D, command.textures[0]);
+            gl_state().bind_texture(1, GL_TEXTURE_2D, command.textures[1]);
+            InstanceData instance;
+            build_instances(&models[i], 1, TransformKind::General, &instance);
+            for (uint32_t c = 0; c < 4; c++)
+                glVertexAttrib4fv(INSTANCE_MODEL_LOCATION + c, &instance.model[c][0]);
+            for (uint32_t c = 0; c < 3; c++)
+                glVertexAttrib3fv(INSTANCE_NORMAL_LOCATION + c, &instance.normal[c][0]);
+            if (command.indexType == GL_NONE)
+                glDrawArrays(command.mode, 0, command.count);
+            else
+                glDrawElements(command.mode, command.count, command.indexType, 0);
+            stats.draws++;
+        }
+        immediateStats = stats;
+    };
+
+    RenderQueue queue;
+    RenderQueue::Stats queueStats;
+    double sortNs = 0.0;
+    auto queued = [&]() {
+        queue.clear();
+        for (uint32_t i = 0; i < OBJECTS; i++) queue.submit(commands[i], depths[i], models[i]);
+        auto start = std::chrono::steady_clock::now();
+        queue.sort();
+        sortNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+                      .count();
+        queueStats = queue.execute();
+    };
+
+    // CPU 提交耗时只计到最后一个 GL 调用返回为止，不含 glFinish
+    constexpr uint32_t FRAMES = 20;
+    auto measure = [&](auto &&frame, double &cpuNs, GLState::Counters &calls) {
+        cpuNs = 0.0;
+        double frameNs = time_per_iteration(FRAMES, [&](uint32_t) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            gl_state().end_frame();
+            auto start = std::chrono::steady_clock::now();
+            frame();
+            cpuNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() -
+                                                              start)
+                         .count();
+            calls = gl_state().frame();
+        });
+        cpuNs /= FRAMES;
+        return frameNs;
+    };
+    double immediateCpu, queueCpu;
+    GLState::Counters immediateCalls, queueCalls;
+    double immediateFrame = measure(immediate, immediateCpu, immediateCalls);
+    double queueFrame = measure(queued, queueCpu, queueCalls);
+
+    auto report = [](const char *label, const RenderQueue::Stats &stats,
+                     const GLState::Counters &calls, double cpuNs, double frameNs) {
+        std::cout << "  " << label << " | " << stats.programs << " | " << stats.textures << " | "
+                  << stats.vertexArrays << " | " << calls.issued << " | " << cpuNs * 1e-6
+                  << " | " << frameNs * 1e-6 << std::endl;
+    };
+    std::cout << "bench_render_queue: " << OBJECTS << " draws, " << shaders.size()
+              << " programs, " << TEXTURE_SETS << " texture sets, 2 meshes at " << BENCH_WIDTH
+              << "x" << BENCH_HEIGHT << "\n"
+              << "  order | program switches | texture binds | VAO switches | "
+                 "state calls issued | CPU submit (ms) | frame (ms)"
+              << std::endl;
+    report("submission order", immediateStats, immediateCalls, immediateCpu, immediateFrame);
+    report("sorted queue", queueStats, queueCalls, queueCpu, queueFrame);
+    std::cout << "  radix sort of " << OBJECTS << " keys: " << sortNs / FRAMES * 1e-6
+              << " ms, included in the queue's CPU submit time" << std::endl;
+
+    variants.release();
+    gl_state().delete_vertex_arrays(1, &cubeVao);
+    gl_state().delete_vertex_arrays(1, &sphereVao);
+    gl_state().delete_buffers(1, &cubeVbo);
+    gl_state().delete_buffers(1, &sphereVbo);
+    gl_state().delete_buffers(1, &sphereEbo);
+    gl_state().delete_buffers(1, &lightingBuffer.id_);
+    gl_state().delete_textures(static_cast<GLsizei>(textures.size()), textures.data());
+    release_render_target(target);
+    glfwTerminate();
+}
+
+void bench_texture_streaming()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    RenderTarget target = create_render_target(BENCH_WIDTH, BENCH_HEIGHT);
+    constexpr uint32_t TEXTURES = 64;
+    const char *path = "./texture/container.jpg";
+    std::vector<uint32_t> textures;
+
+    // 1. 改造前：渲染线程上逐张 stbi_load + glTexImage2D + glGenerateMipmap，全部完成后才有第一帧
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < TEXTURES; i++) {
+        int width, height, channels;
+        unsigned char *data = stbi_load(path, &width, &height, &channels, 0);
+        if (data == nullptr) {
+            std::cout << "ERROR::BENCH::TEXTURE_NOT_FOUND " << path << std::endl;
+            release_render_target(target);
+            glfwTerminate();
+            return;
+        }
+        GLenum format = channels == 4 ? GL_RGBA : GL_RGB;
+        uint32_t texture;
+        glGenTextures(1, &texture);
+        gl_state().edit_texture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        stbi_image_free(data);
+        textures.push_back(texture);
+    }
+    glClear(GL_COLOR_BUFFER_BIT);
+    glFinish();
+    double syncFirstFrame =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    gl_state().delete_textures(TEXTURES, textures.data());
+    textures.clear();
+
+    std::cout << "bench_texture_streaming: " << TEXTURES << " x " << path << "\n"
+              << "  synchronous load: first frame after " << syncFirstFrame << " ms\n"
+              << "  staging | upload budget | first frame (ms) | frames until streamed | "
+                 "worst frame (ms) | all resident (ms) | GL upload (ms) | MB/s | staging peak "
+                 "(MiB) | fence waits (ms)"
+              << std::endl;
+
+    // 2. 异步：第一帧只等 load() 创建占位纹理，之后每帧在预算内上传
+    //    staging 为 0 时从 stbi 的客户端内存直接 glTexImage2D，否则经过 PBO ring
+    const size_t stagingSizes[] = {0, TextureLoader::DEFAULT_STAGING_BYTES};
+    const size_t budgets[] = {1 << 20, TextureLoader::DEFAULT_UPLOAD_BUDGET, SIZE_MAX};
+    for (size_t stagingBytes : stagingSizes) {
+        for (size_t budget : budgets) {
+            TextureLoader loader(0, stagingBytes);
+            auto streamStart = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < TEXTURES; i++) textures.push_back(loader.load(path));
+            double firstFrame = 0.0;
+            double worstFrame = 0.0;
+            uint32_t frames = 0;
+            while (loader.pending() > 0 || frames == 0) {
+                auto frameStart = std::chrono::steady_clock::now();
+                loader.update(budget);
+                glClear(GL_COLOR_BUFFER_BIT);
+                glFinish();
+                auto frameEnd = std::chrono::steady_clock::now();
+                double frameMs =
+                    std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+                if (frames == 0)
+                    firstFrame =
+                        std::chrono::duration<double, std::milli>(frameEnd - streamStart).count();
+                worstFrame = std::max(worstFrame, frameMs);
+                frames++;
+            }
+            double resident = std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - streamStart)
+                                  .count();
+            const TextureLoader::UploadStats &upload = loader.upload_stats();
+            PixelUploadRing::Stats staging = loader.staging_stats();
+            std::cout << "  ";
+            if (stagingBytes == 0)
+                std::cout << "none";
+            else
+                std::cout << (staging.capacity >> 20) << " MiB "
+                          << (staging.persistent ? "persistent" : "orphan");
+            std::cout << " | ";
+            if (budget == SIZE_MAX)
+                std::cout << "unlimited";
+            else
+                std::cout << (budget >> 20) << " MiB";
+            std::cout << " | " << firstFrame << " | " << frames << " | " << worstFrame << " | "
+                      << resident << " | " << upload.uploadNs / 1e6 << " | "
+                      << upload.bytes / (upload.uploadNs / 1e3) << " | "
+                      << staging.peak / double(1 << 20) << " | " << staging.fenceWaitNs / 1e6
+                      << " (" << staging.fenceWaits << ")";
+            if (upload.direct > 0 && stagingBytes > 0)
+                std::cout << ", " << upload.direct << " direct";
+            std::cout << std::endl;
+            loader.release();
+            gl_state().delete_textures(TEXTURES, textures.data());
+            textures.clear();
+        }
+    }
+
+    release_render_target(target);
+    glfwTerminate();
+}
+
+void bench_texture_bake()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    // light() 使用的两张贴图
+    const std::string sources[] = {"./texture/container2.png", "./texture/container2_specular.png"};
+    auto bakeStart = std::chrono::steady_clock::now();
+    for (const std::string &source : sources) {
+        if (!bake_texture(source, baked_texture_path(source))) {
+            glfwTerminate();
+            return;
+        }
+    }
+    double bakeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                              bakeStart)
+                        .count();
+    uintmax_t sourceBytes = 0, bakedBytes = 0;
+    for (const std::string &source : sources) {
+        sourceBytes += std::filesystem::file_size(source);
+        bakedBytes += std::filesystem::file_size(baked_texture_path(source));
+    }
+    std::cout << "bench_texture_bake: light() textures, bake took " << bakeMs << " ms, "
+              << (sourceBytes >> 10) << " KiB source -> " << (bakedBytes >> 10)
+              << " KiB baked (all mip levels, uncompressed)" << std::endl;
+
+    // light() 启动时纹理部分的耗时：load() 到全部上传完成 (含 mipmap) 并 glFinish
+    auto startup = [&](bool baked) {
+        TextureLoader loader;
+        std::vector<uint32_t> textures;
+        auto start = std::chrono::steady_clock::now();
+        for (const std::string &source : sources)
+            textures.push_back(loader.load(baked ? baked_texture_path(source) : source));
+        loader.finish();
+        glFinish();
+        double ms =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                .count();
+        loader.release();
+        gl_state().delete_textures(static_cast<int32_t>(textures.size()), textures.data());
+        return ms;
+    };
+
+    constexpr uint32_t WARM_RUNS = 8;
+    std::cout << "  path | cold (ms) | warm best (ms) | warm mean (ms)" << std::endl;
+    for (bool baked : {false, true}) {
+        bool dropped = true;
+        for (const std::string &source : sources)
+            dropped = drop_file_cache(baked ? baked_texture_path(source) : source) && dropped;
+        double cold = startup(baked);
+        double best = 1e30, total = 0.0;
+        for (uint32_t i = 0; i < WARM_RUNS; i++) {
+            double ms = startup(baked);
+            best = std::min(best, ms);
+            total += ms;
+        }
+        std::cout << "  " << (baked ? "mmap .ltex" : "stb_image + glGenerateMipmap") << " | "
+                  << cold << (dropped ? "" : " (page cache not dropped)") << " | " << best
+                  << " | " << total / WARM_RUNS << std::endl;
+    }
+
+    glfwTerminate();
+}
+
+void bench_block_compression()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    const char *path = "./texture/container.jpg";
+    int width, height, channels;
+    unsigned char *pixels = stbi_load(path, &width, &height, &channels, 0);
+    if (pixels == nullptr) {
+        std::cout << "ERROR::BENCH::TEXTURE_NOT_FOUND " << path << std::endl;
+        glfwTerminate();
+        return;
+    }
+    const uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+    const double megapixels = (double)width * height / 1e6;
+    const size_t sourceBytes = (size_t)width * height * channels;
+    std::cout << "bench_block_compression: " << path << " " << width << "x" << height << ", "
+              << channels << " channels, " << threads << " threads\n"
+              << "  format | PSNR (dB) | size (KiB) | vs source | 1 thread (MPix/s) | "
+              << threads << " threads (MPix/s) | GL compressed size (KiB)" << std::endl;
+
+    constexpr uint32_t RUNS = 5;
+    for (BlockFormat format :
+         {BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC4, BlockFormat::BC5}) {
+        const BlockFormatInfo &info = block_format_info(format);
+        std::vector<uint8_t> blocks;
+        // 取多次中最快的一次，排除线程创建之外的抖动
+        auto throughput = [&](uint32_t threadCount) {
+            double best = std::numeric_limits<double>::max();
+            for (uint32_t run = 0; run < RUNS; run++) {
+                auto start = std::chrono::steady_clock::now();
+                blocks = compress_blocks(pixels, width, height, channels, format, threadCount);
+                best = std::min(best, std::chrono::duration<double>(
+                                          std::chrono::steady_clock::now() - start)
+                                          .count());
+            }
+            return megapixels / best;
+        };
+        double single = throughput(1);
+        double multi = throughput(threads);
+        std::vector<uint8_t> decoded = decompress_blocks(blocks.data(), width, height, format);
+        double quality = psnr(pixels, channels, decoded.data(), info.channels, width, height);
+
+        // 通过运行时的上传路径交给驱动，查询实际保存的压缩数据大小
+        std::cout << "  " << info.name << " | " << quality << " | " << (blocks.size() >> 10)
+                  << " | 1/" << (double)sourceBytes / blocks.size() << " | " << single << " | "
+                  << multi << " | ";
+        if (block_format_supported(format)) {
+            uint32_t texture;
+            glGenTextures(1, &texture);
+            gl_state().edit_texture(GL_TEXTURE_2D, texture);
+            glCompressedTexImage2D(GL_TEXTURE_2D, 0, info.internalFormat, width, height, 0,
+                                   static_cast<GLsizei>(blocks.size()), blocks.data());
+            GLint size = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+            gl_state().delete_textures(1, &texture);
+            std::cout << (size >> 10) << std::endl;
+        } else {
+            std::cout << "unsupported" << std::endl;
+        }
+    }
+
+    stbi_image_free(pixels);
+    glfwTerminate();
+}
+
+void bench_mip_generation()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    struct Image {
+        std::string name;
+        std::vector<uint8_t> pixels;
+        uint32_t width;
+        uint32_t height;
+        uint32_t channels;
+    };
+    std::vector<Image> images;
+    const char *path = "./texture/container.jpg";
+    int width, height, channels;
+    if (unsigned char *data = stbi_load(path, &width, &height, &channels, 0)) {
+        images.push_back({path, std::vector<uint8_t>(data, data + width * height * channels),
+                          (uint32_t)width, (uint32_t)height, (uint32_t)channels});
+        stbi_image_free(data);
+    } else {
+        std::cout << "ERROR::BENCH::TEXTURE_NOT_FOUND " << path << std::endl;
+    }
+    // 2048x2048 RGBA 的渐变加噪声，代表大尺寸贴图
+    Image synthetic = {"2048x2048 RGBA noise", {}, 2048, 2048, 4};
+    synthetic.pixels.resize((size_t)2048 * 2048 * 4);
+    std::mt19937 random(17);
+    for (size_t i = 0; i < synthetic.pixels.size(); i++)
+        synthetic.pixels[i] = static_cast<uint8_t>(((i / 4) % 2048) / 8 + random() % 8);
+    images.push_back(std::move(synthetic));
+
+    constexpr uint32_t RUNS = 5;
+    auto best_seconds = [&](auto &&fn) {
+        double best = std::numeric_limits<double>::max();
+        for (uint32_t run = 0; run < RUNS; run++) {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            best = std::min(best, std::chrono::duration<double>(
+                                      std::chrono::steady_clock::now() - start)
+                                      .count());
+        }
+        return best;
+    };
+
+    std::cout << "bench_mip_generation: whole chain from level 0, best of " << RUNS << " runs, "
+              << mip_simd_path() << " vs scalar, MPix/s counts level 0 pixels" << std::endl;
+    for (const Image &image : images) {
+        const double megapixels = (double)image.width * image.height / 1e6;
+        std::cout << "  " << image.name << "\n"
+                  << "    filter | scalar (MPix/s) | SIMD (MPix/s) | speedup | max diff"
+                  << std::endl;
+        for (MipFilter filter : {MipFilter::Box, MipFilter::Kaiser}) {
+            for (bool srgb : {false, true}) {
+                const MipOptions options = {filter, srgb};
+                MipChain scalar, simd;
+                double scalarSeconds = best_seconds([&]() {
+                    scalar = generate_mips_scalar(image.pixels.data(), image.width, image.height,
+                                                  image.channels, options);
+                });
+                double simdSeconds = best_seconds([&]() {
+                    simd = generate_mips(image.pixels.data(), image.width, image.height,
+                                         image.channels, options);
+                });
+                // FMA 与分开的乘加舍入不同，个别像素可能差 1
+                int maxDiff = 0;
+                for (size_t i = 0; i < simd.data.size(); i++)
+                    maxDiff = std::max(maxDiff, std::abs(simd.data[i] - scalar.data[i]));
+                std::cout << "    " << (filter == MipFilter::Box ? "box" : "kaiser")
+                          << (srgb ? " sRGB" : " linear") << " | " << megapixels / scalarSeconds
+                          << " | " << megapixels / simdSeconds << " | "
+                          << scalarSeconds / simdSeconds << "x | " << maxDiff << std::endl;
+            }
+        }
+
+        // 改造前的做法：GL 线程上传 level 0 后由驱动生成，计入 glFinish 等待的时间
+        const GLenum format = image.channels == 4 ? GL_RGBA : GL_RGB;
+        uint32_t texture;
+        glGenTextures(1, &texture);
+        gl_state().edit_texture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format,
+                     GL_UNSIGNED_BYTE, image.pixels.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glFinish();
+        double driverSeconds = best_seconds([&]() {
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glFinish();
+        });
+        gl_state().delete_textures(1, &texture);
+        std::cout << "    glGenerateMipmap on the GL thread: " << megapixels / driverSeconds
+                  << " MPix/s" << std::endl;
+    }
+
+    glfwTerminate();
+}
+
+void bench_texture_array()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    RenderTarget target = create_render_target(BENCH_WIDTH, BENCH_HEIGHT);
+    gl_state().enable(GL_DEPTH_TEST);
+
+    // 逐材质绑定走 RenderQueue 的单物体路径，VAO 上不能有实例属性数组，所以两条路径各用一个 VAO
+    uint32_t cubeVbo, batchVbo;
+    uint32_t cubeVao = create_cube_vao(cubeVbo);
+    uint32_t batchVao = create_cube_vao(batchVbo);
+    InstanceBuffer instances;
+    MaterialLayerBuffer layerBuffer;
+    instances.attach(batchVao);
+    layerBuffer.attach(batchVao);
+
+    const glm::vec3 viewPos(0.0f, 0.0f, 40.0f);
+    const glm::mat4 view = glm::lookAt(viewPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projection = glm::perspective(
+        glm::radians(45.0f), (float)BENCH_WIDTH / (float)BENCH_HEIGHT, 0.1f, 100.0f);
+    glm::vec3 pointLightPositions[NR_POINT_LIGHTS] = {
+        glm::vec3(0.7f, 0.2f, 2.0f), glm::vec3(2.3f, -3.3f, -4.0f), glm::vec3(-4.0f, 2.0f, -12.0f),
+        glm::vec3(0.0f, 0.0f, -3.0f)};
+    LightingBuffer lightingBuffer;
+    LightBlock lights = scene_light_block(pointLightPositions);
+    lights.viewPos = viewPos;
+    lights.spotLight.position = viewPos;
+    lights.spotLight.direction = glm::vec3(0.0f, 0.0f, -1.0f);
+    lightingBuffer.upload(lights);
+
+    ShaderVariants variants;
+    auto setup = [&](const ShaderDefines &defines) -> const Shader & {
+        const Shader &shader = variants.get("./shader/light.vs", "./shader/light.fs", defines);
+        lightingBuffer.attach(shader);
+        shader.use();
+        shader.set_int("material.diffuse", 0);
+        shader.set_int("material.specular", 1);
+        LightingUniforms loc(shader);
+        shader.set(loc.shininess, 32.0f);
+        shader.set(loc.view, view);
+        shader.set(loc.projection, projection);
+        return shader;
+    };
+    const Shader &separateShader = setup({});
+    const Shader &arrayShader = setup({{"USE_TEXTURE_ARRAY", "1"}});
+
+    // 每个材质一张 64x64 的棋盘格 diffuse 与一张 32x32 的灰度 specular，颜色各不相同
+    auto material_image = [](uint32_t material, uint32_t size, bool specular) {
+        std::vector<uint8_t> pixels((size_t)size * size * 4);
+        std::mt19937 random(material * 2 + specular);
+        uint8_t colors[2][3];
+        for (auto &color : colors) {
+            for (uint8_t &c : color) c = static_cast<uint8_t>(random());
+        }
+        for (uint32_t y = 0; y < size; y++) {
+            for (uint32_t x = 0; x < size; x++) {
+                const uint8_t *color = colors[((x / 8) ^ (y / 8)) & 1];
+                uint8_t *pixel = &pixels[((size_t)y * size + x) * 4];
+                for (uint32_t c = 0; c < 3; c++) pixel[c] = specular ? color[0] : color[c];
+                pixel[3] = 255;
+            }
+        }
+        return pixels;
+    };
+
+    constexpr uint32_t OBJECTS = 4096;
+    constexpr uint32_t FRAMES = 20;
+    std::vector<glm::mat4> models = cube_field(OBJECTS);
+    instances.upload(models);
+    std::vector<float> depths(OBJECTS);
+    for (uint32_t i = 0; i < OBJECTS; i++)
+        depths[i] = glm::length(glm::vec3(models[i][3]) - viewPos);
+
+    // CPU 提交耗时只计到最后一个 GL 调用返回为止，不含 glFinish
+    auto measure = [&](auto &&frame, double &cpuNs) {
+        cpuNs = 0.0;
+        double frameNs = time_per_iteration(FRAMES, [&](uint32_t) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            gl_state().end_frame();
+            auto start = std::chrono::steady_clock::now();
+            frame();
+            cpuNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() -
+                                                              start)
+                         .count();
+        });
+        cpuNs /= FRAMES;
+        return frameNs;
+    };
+
+    std::cout << "bench_texture_array: " << OBJECTS << " cubes at " << BENCH_WIDTH << "x"
+              << BENCH_HEIGHT << ", material of cube i is i % materials\n"
+              << "  materials | path | draws | texture binds | CPU submit (ms) | frame (ms) | "
+                 "texture setup (ms)"
+              << std::endl;
+    for (uint32_t materials : {64u, 256u, 1024u}) {
+        std::vector<std::vector<uint8_t>> diffuseImages, specularImages;
+        for (uint32_t m = 0; m < materials; m++) {
+            diffuseImages.push_back(material_image(m, 64, false));
+            specularImages.push_back(material_image(m, 32, true));
+        }
+
+        // 改造前：每个材质两张独立的 2D 纹理，队列按纹理排序后每换一个材质绑定一次
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint32_t> textures;
+        for (uint32_t m = 0; m < materials; m++) {
+            for (const auto *images : {&diffuseImages, &specularImages}) {
+                uint32_t size = images == &diffuseImages ? 64 : 32;
+                uint32_t texture;
+                glGenTextures(1, &texture);
+                gl_state().edit_texture(GL_TEXTURE_2D, texture);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA,
+                             GL_UNSIGNED_BYTE, (*images)[m].data());
+                glGenerateMipmap(GL_TEXTURE_2D);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+                textures.push_back(texture);
+            }
+        }
+        glFinish();
+        double separateSetup = std::chrono::duration<double, std::milli>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count();
+
+        // 改造后：diffuse 与 specular 各自按尺寸落进一个 array，逐层追加 (含扩容时的 GPU 拷贝)
+        start = std::chrono::steady_clock::now();
+        TextureArrays arrays;
+        std::vector<MaterialLayers> materialLayers(materials);
+        TextureLayer diffuse, specular;
+        for (uint32_t m = 0; m < materials; m++) {
+            MipChain diffuseMips = generate_mips(diffuseImages[m].data(), 64, 64, 4);
+            MipChain specularMips = generate_mips(specularImages[m].data(), 32, 32, 4);
+            diffuse = arrays.add(diffuseImages[m].data(), 64, 64, 4, diffuseMips);
+            specular = arrays.add(specularImages[m].data(), 32, 32, 4, specularMips);
+            materialLayers[m] = {static_cast<uint16_t>(diffuse.layer),
+                                 static_cast<uint16_t>(specular.layer)};
+        }
+        glFinish();
+        double arraySetup = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+        TextureArrays::Stats arrayStats = arrays.stats();
+        if (arrayStats.arrays != 2) {
+            std::cout << "  " << materials << " | skipped: exceeds GL_MAX_ARRAY_TEXTURE_LAYERS"
+                      << std::endl;
+            arrays.release();
+            gl_state().delete_textures(static_cast<int32_t>(textures.size()), textures.data());
+            continue;
+        }
+
+        std::vector<MaterialLayers> instanceLayers(OBJECTS);
+        for (uint32_t i = 0; i < OBJECTS; i++) instanceLayers[i] = materialLayers[i % materials];
+        layerBuffer.upload(instanceLayers);
+
+        RenderQueue queue;
+        RenderQueue::Stats queueStats;
+        DrawCommand command;
+        command.shader = &separateShader;
+        command.vao = cubeVao;
+        command.count = CUBE_VERTEX_COUNT;
+        auto separate = [&]() {
+            queue.clear();
+            for (uint32_t i = 0; i < OBJECTS; i++) {
+                command.textures[0] = textures[(i % materials) * 2];
+                command.textures[1] = textures[(i % materials) * 2 + 1];
+                queue.submit(command, depths[i], models[i]);
+            }
+            queue.sort();
+            queueStats = queue.execute();
+        };
+        auto batched = [&]() {
+            arrayShader.use();
+            arrays.bind(0, diffuse.array);
+            arrays.bind(1, specular.array);
+            gl_state().bind_vertex_array(batchVao);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT, OBJECTS);
+        };
+
+        double separateCpu, batchedCpu;
+        double separateFrame = measure(separate, separateCpu);
+        double batchedFrame = measure(batched, batchedCpu);
+        std::cout << "  " << materials << " | 2D textures, sorted queue | " << queueStats.draws
+                  << " | " << queueStats.textures << " | " << separateCpu * 1e-6 << " | "
+                  << separateFrame * 1e-6 << " | " << separateSetup << "\n"
+                  << "  " << materials << " | texture arrays, 1 instanced draw | 1 | 2 | "
+                  << batchedCpu * 1e-6 << " | " << batchedFrame * 1e-6 << " | " << arraySetup
+                  << " (" << arrayStats.grows << " grows, " << arrayStats.bytes / 1024
+                  << " KiB)" << std::endl;
+
+        arrays.release();
+        gl_state().delete_textures(static_cast<int32_t>(textures.size()), textures.data());
+    }
+
+    variants.release();
+    gl_state().delete_vertex_arrays(1, &cubeVao);
+    gl_state().delete_vertex_arrays(1, &batchVao);
+    gl_state().delete_buffers(1, &cubeVbo);
+    gl_state().delete_buffers(1, &batchVbo);
+    gl_state().delete_buffers(1, &instances.id_);
+    gl_state().delete_buffers(1, &layerBuffer.id_);
+    gl_state().delete_buffers(1, &lightingBuffer.id_);
+    release_render_target(target);
+    glfwTerminate();
+}
+
+void bench_texture_cache()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    // 三个场景函数各自加载 container.jpg；这里模拟一个 256 个材质槽的关卡：
+    // 同一文件有不同的路径写法，另外还有内容相同、文件名不同的拷贝 (例如美术导出时复制出来的)
+    const std::string source = "./texture/container.jpg";
+    if (!std::filesystem::exists(source)) {
+        std::cout << "ERROR::BENCH::TEXTURE_NOT_FOUND " << source << std::endl;
+        glfwTerminate();
+        return;
+    }
+    const std::filesystem::path copies = std::filesystem::temp_directory_path() / "texture_cache";
+    std::filesystem::create_directories(copies);
+    std::vector<std::string> files = {source, "./texture/../texture/container.jpg"};
+    for (const char *name : {"crate_a.jpg", "crate_b.jpg", "crate_c.jpg"}) {
+        std::filesystem::copy_file(source, copies / name,
+                                   std::filesystem::copy_options::overwrite_existing);
+        files.push_back((copies / name).string());
+    }
+    // 两个材质用不同的采样方式，即使内容相同也必须是不同的纹理
+    TextureOptions nearest;
+    nearest.minFilter = GL_NEAREST_MIPMAP_NEAREST;
+    nearest.magFilter = GL_NEAREST;
+
+    constexpr uint32_t SLOTS = 256;
+    struct Slot {
+        std::string path;
+        TextureOptions options;
+    };
+    std::vector<Slot> slots;
+    std::mt19937 random(19);
+    for (uint32_t i = 0; i < SLOTS; i++) {
+        const std::string &path = files[random() % files.size()];
+        slots.push_back({path, random() % 2 ? nearest : TextureOptions()});
+    }
+
+    // 加载全部材质直到上传完成，统计创建的纹理数与显存
+    enum class Mode { NoCache, Path, Content };
+    auto load_all = [&](Mode mode) {
+        const bool cached = mode != Mode::NoCache;
+        TextureLoader loader;
+        TextureCache cache(loader, mode == Mode::Content);
+        std::vector<uint32_t> textures;
+        auto start = std::chrono::steady_clock::now();
+        for (const Slot &slot : slots) {
+            textures.push_back(cached ? cache.acquire(slot.path, slot.options)
+                                      : loader.load(slot.path, slot.options));
+        }
+        loader.finish();
+        glFinish();
+        double ms =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                .count();
+        std::vector<uint32_t> names = textures;
+        std::sort(names.begin(), names.end());
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+        size_t bytes = 0;
+        for (uint32_t texture : names) bytes += loader.texture_bytes(texture);
+
+        if (!cached) {
+            std::cout << "  no cache | " << ms << " | " << names.size() << " | " << (bytes >> 10)
+                      << " | -" << std::endl;
+            gl_state().delete_textures(static_cast<int32_t>(names.size()), names.data());
+            loader.release();
+            return;
+        }
+        TextureCache::Stats stats = cache.stats();
+        std::cout << (mode == Mode::Content ? "  path + content cache | " : "  path cache | ")
+                  << ms << " | " << stats.textures << " | "
+                  << (stats.residentBytes >> 10) << " | " << stats.hit_rate() * 100.0 << "% ("
+                  << stats.pathHits << " path, " << stats.contentHits << " content)" << std::endl;
+        // 卸载前一半材质槽：只有不再被后一半引用的纹理被删除
+        for (uint32_t i = 0; i < SLOTS / 2; i++) cache.release(textures[i]);
+        stats = cache.stats();
+        std::cout << "  after releasing " << SLOTS / 2 << " slots: " << stats.textures
+                  << " textures, " << (stats.residentBytes >> 10) << " KiB resident, "
+                  << stats.evictions << " evicted" << std::endl;
+        for (uint32_t i = SLOTS / 2; i < SLOTS; i++) cache.release(textures[i]);
+        stats = cache.stats();
+        std::cout << "  after releasing all slots: " << stats.textures << " textures, "
+                  << (stats.residentBytes >> 10) << " KiB resident, " << stats.evictions
+                  << " evicted" << std::endl;
+        cache.clear();
+        loader.release();
+    };
+
+    std::cout << "bench_texture_cache: " << SLOTS << " material slots over " << files.size()
+              << " spellings/copies of " << source << " x 2 sampler settings\n"
+              << "  mode | load until uploaded (ms) | textures | resident (KiB) | hit rate"
+              << std::endl;
+    load_all(Mode::NoCache);
+    load_all(Mode::Path);
+    load_all(Mode::Content);
+
+    std::filesystem::remove_all(copies);
+    glfwTerminate();
+}
+
+void bench_texture_residency()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    // 合成场景：走廊两侧 128 个边长 4 的箱子，各自一张 1024x1024 的 BC1 贴图 (含 mip 约 683 KiB)，
+    // 全部驻留约 85 MiB；烘焙结果留在临时目录，之后的运行直接复用
+    constexpr uint32_t TEXTURES = 128;
+    constexpr uint32_t SIZE = 1024;
+    const std::filesystem::path directory =
+        std::filesystem::temp_directory_path() / "texture_residency";
+    std::filesystem::create_directories(directory);
+    std::vector<std::string> paths;
+    std::vector<uint8_t> pixels((size_t)SIZE * SIZE * 3);
+    BakeOptions bakeOptions;
+    bakeOptions.compress = true;
+    for (uint32_t i = 0; i < TEXTURES; i++) {
+        paths.push_back((directory / ("synthetic_" + std::to_string(i) + ".ltex")).string());
+        if (std::filesystem::exists(paths.back())) continue;
+        std::mt19937 random(i);
+        const uint8_t tint[3] = {static_cast<uint8_t>(random()), static_cast<uint8_t>(random()),
+                                 static_cast<uint8_t>(random())};
+        for (uint32_t y = 0; y < SIZE; y++) {
+            for (uint32_t x = 0; x < SIZE; x++) {
+                uint8_t *pixel = &pixels[((size_t)y * SIZE + x) * 3];
+                // 细网格线只有在高分辨率的级别上才看得清
+                bool line = x % 32 == 0 || y % 32 == 0;
+                for (uint32_t c = 0; c < 3; c++)
+                    pixel[c] = line ? 255 : static_cast<uint8_t>(tint[c] * ((x + y) % 256) / 255);
+            }
+        }
+        if (!bake_pixels(pixels.data(), SIZE, SIZE, 3, paths.back(), bakeOptions)) {
+            glfwTerminate();
+            return;
+        }
+    }
+
+    RenderTarget target = create_render_target(BENCH_WIDTH, BENCH_HEIGHT);
+    gl_state().enable(GL_DEPTH_TEST);
+    uint32_t vbo;
+    uint32_t vao = create_cube_vao(vbo);
+
+    constexpr float SCALE = 4.0f;
+    const float radius = SCALE * 0.5f * std::sqrt(3.0f);
+    std::vector<glm::mat4> models;
+    for (uint32_t i = 0; i < TEXTURES; i++) {
+        glm::vec3 position((i % 2 ? 1.0f : -1.0f) * 5.0f, 0.0f, -(float)(i / 2) * 8.0f);
+        models.push_back(glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(SCALE)));
+    }
+    std::vector<InstanceData> instances(TEXTURES);
+    build_instances(models.data(), TEXTURES, TransformKind::UniformScale, instances.data());
+
+    LightingBuffer lightingBuffer;
+    glm::vec3 pointLightPositions[NR_POINT_LIGHTS] = {};
+    LightBlock lights = scene_light_block(pointLightPositions);
+    lightingBuffer.upload(lights);
+    ShaderVariants variants;
+    const Shader &shader = variants.get("./shader/light.vs", "./shader/light.fs",
+                                        {{"USE_SPECULAR_MAP", "0"}, {"USE_SPOT_LIGHT", "0"}});
+    lightingBuffer.attach(shader);
+    shader.use();
+    shader.set_int("material.diffuse", 0);
+    LightingUniforms loc(shader);
+    shader.set(loc.shininess, 32.0f);
+    shader.set(loc.projection,
+               glm::perspective(glm::radians(ZOOM), (float)BENCH_WIDTH / (float)BENCH_HEIGHT, 0.1f,
+                                200.0f));
+
+    // 相机沿走廊中线匀速飞过，每个箱子都会先远后近地经过视野
+    constexpr uint32_t FRAMES = 600;
+    const float start = 10.0f, end = -(float)(TEXTURES / 2) * 8.0f;
+    auto fly = [&](TextureResidency &residency, double &worstUpdateNs,
+                   std::vector<double> &frameMs, uint64_t &starved) {
+        worstUpdateNs = 0.0;
+        starved = 0;
+        frameMs.clear();
+        for (uint32_t frame = 0; frame < FRAMES; frame++) {
+            auto frameStart = std::chrono::steady_clock::now();
+            Camera camera(glm::vec3(0.0f, 0.0f, start + (end - start) * frame / (FRAMES - 1)));
+            residency.set_view(camera, (float)BENCH_HEIGHT);
+            for (uint32_t i = 0; i < TEXTURES; i++)
+                residency.use(i, glm::vec3(models[i][3]), radius);
+            residency.update();
+            TextureResidency::Stats stats = residency.stats();
+            worstUpdateNs = std::max(worstUpdateNs, stats.frameUploadNs);
+            starved += stats.starved;
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            shader.use();
+            shader.set(loc.view, camera.GetViewMatrix());
+            gl_state().bind_vertex_array(vao);
+            for (uint32_t i = 0; i < TEXTURES; i++) {
+                gl_state().bind_texture(0, GL_TEXTURE_2D, residency.texture(i));
+                for (uint32_t c = 0; c < 4; c++)
+                    glVertexAttrib4fv(INSTANCE_MODEL_LOCATION + c, &instances[i].model[c][0]);
+                for (uint32_t c = 0; c < 3; c++)
+                    glVertexAttrib3fv(INSTANCE_NORMAL_LOCATION + c, &instances[i].normal[c][0]);
+                glDrawArrays(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT);
+            }
+            glFinish();
+            frameMs.push_back(std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - frameStart)
+                                  .count());
+        }
+    };
+
+    std::cout << "bench_texture_residency: " << TEXTURES << " x " << SIZE << "x" << SIZE
+              << " BC1 textures, " << FRAMES << " frame fly-through at " << BENCH_WIDTH << "x"
+              << BENCH_HEIGHT << "\n"
+              << "  budget (MiB) | upload budget (KiB/frame) | peak resident (MiB) | "
+                 "worst update (ms) | p99 frame (ms) | max frame (ms) | starved per frame | "
+                 "levels streamed/dropped"
+              << std::endl;
+    struct Config {
+        size_t budget;
+        size_t uploadBudget;
+    };
+    // 第一行不限预算也不限每帧上传量，相当于改造前：所有需要的级别在它第一次被需要的那一帧全部上传
+    const Config configs[] = {{SIZE_MAX, SIZE_MAX},
+                              {32 << 20, TextureResidency::DEFAULT_UPLOAD_BUDGET},
+                              {16 << 20, TextureResidency::DEFAULT_UPLOAD_BUDGET},
+                              {8 << 20, TextureResidency::DEFAULT_UPLOAD_BUDGET},
+                              {8 << 20, 1 << 20}};
+    for (const Config &config : configs) {
+        TextureResidency residency(config.budget, config.uploadBudget);
+        for (const std::string &path : paths) {
+            if (residency.add(path) == TextureResidency::INVALID) break;
+        }
+        if (residency.stats().textures != TEXTURES) {
+            residency.release();
+            break;
+        }
+        double worstUpdateNs;
+        std::vector<double> frameMs;
+        uint64_t starved;
+        fly(residency, worstUpdateNs, frameMs, starved);
+        std::sort(frameMs.begin(), frameMs.end());
+        TextureResidency::Stats stats = residency.stats();
+        auto mib = [](size_t bytes) { return bytes / double(1 << 20); };
+        std::cout << "  " << (config.budget == SIZE_MAX ? std::string("unlimited")
+                                                         : std::to_string(config.budget >> 20))
+                  << " | "
+                  << (config.uploadBudget == SIZE_MAX ? std::string("unlimited")
+                                                      : std::to_string(config.uploadBudget >> 10))
+                  << " | " << mib(stats.peak)
+                  << (stats.peak <= config.budget ? "" : " (over budget)") << " | "
+                  << worstUpdateNs * 1e-6 << " | " << frameMs[frameMs.size() * 99 / 100] << " | "
+                  << frameMs.back() << " | " << (double)starved / FRAMES << " | "
+                  << stats.levelsStreamed << "/" << stats.levelsDropped << std::endl;
+        residency.release();
+    }
+
+    variants.release();
+    gl_state().delete_vertex_arrays(1, &vao);
+    gl_state().delete_buffers(1, &vbo);
+    gl_state().delete_buffers(1, &lightingBuffer.id_);
+    release_render_target(target);
+    glfwTerminate();
+}
+
+void bench_mesh_welding()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    // 1. CPU：展开的三角形列表焊接前后的顶点数与显存；球面先按索引展开，还原成焊接前的样子
+    std::vector<float> sphereVertices;
+    std::vector<uint32_t> sphereIndices;
+    uv_sphere(256, 256, sphereVertices, sphereIndices);
+    IndexedMesh sphere;
+    sphere.components = 8;
+    sphere.vertices = std::move(sphereVertices);
+    sphere.indices = std::move(sphereIndices);
+    const std::vector<float> soup = unweld_vertices(sphere);
+    const size_t soupCount = soup.size() / 8;
+
+    struct Source {
+        const char *name;
+        const float *vertices;
+        size_t count;
+    };
+    const Source sources[] = {{"cube", CUBE_VERTICES, CUBE_VERTEX_COUNT},
+                              {"uv sphere 256x256", soup.data(), soupCount}};
+    std::cout << "bench_mesh_welding: position/normal/texcoord, 32 bytes per vertex\n"
+              << "  mesh | vertices before -> after | reduction | index type | "
+                 "bytes before -> after | weld (ms)"
+              << std::endl;
+    IndexedMesh welded;
+    for (const Source &source : sources) {
+        double weldNs = time_per_iteration(
+            5, [&](uint32_t) { welded = weld_vertices(source.vertices, source.count, 8); });
+        GLenum indexType = index_type_for(welded.vertex_count());
+        size_t indexBytes = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        size_t after = welded.vertices.size() * sizeof(float) + welded.indices.size() * indexBytes;
+        std::cout << "  " << source.name << " | " << source.count << " -> "
+                  << welded.vertex_count() << " | "
+                  << 100.0 * (1.0 - (double)welded.vertex_count() / source.count) << "% | "
+                  << (indexType == GL_UNSIGNED_SHORT ? "uint16" : "uint32") << " | "
+                  << source.count * CUBE_STRIDE << " -> " << after << " | " << weldNs * 1e-6
+                  << std::endl;
+    }
+
+    // 2. GPU：同一个球面，展开的 glDrawArrays 对比焊接后的 glDrawElements，
+    // 渲染目标很小，耗时主要在顶点着色器
+    constexpr uint32_t TARGET_SIZE = 64;
+    constexpr uint32_t SPHERES = 8;
+    RenderTarget target = create_render_target(TARGET_SIZE, TARGET_SIZE);
+    gl_state().enable(GL_DEPTH_TEST);
+
+    uint32_t soupVao, soupVbo;
+    glGenVertexArrays(1, &soupVao);
+    glGenBuffers(1, &soupVbo);
+    gl_state().bind_vertex_array(soupVao);
+    gl_state().bind_buffer(GL_ARRAY_BUFFER, soupVbo);
+    glBufferData(GL_ARRAY_BUFFER, soup.size() * sizeof(float), soup.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, CUBE_STRIDE, (void *)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, CUBE_STRIDE, (void *)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, CUBE_STRIDE, (void *)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    Mesh mesh(welded, {3, 3, 2}, false);
+
+    InstanceBuffer sphereInstances;
+    sphereInstances.attach(soupVao);
+    sphereInstances.attach(mesh.vao_);
+    sphereInstances.upload(cube_field(SPHERES), TransformKind::UniformScale);
+
+    uint32_t diffuse = solid_texture(200, 160, 120);
+    uint32_t specular = solid_texture(128, 128, 128);
+    gl_state().bind_texture(0, GL_TEXTURE_2D, diffuse);
+    gl_state().bind_texture(1, GL_TEXTURE_2D, specular);
+
+    const glm::vec3 viewPos(0.0f, 0.0f, 8.0f);
+    LightingBuffer lightingBuffer;
+    glm::vec3 unusedPositions[NR_POINT_LIGHTS] = {};
+    LightBlock lights = scene_light_block(unusedPositions);
+    lights.viewPos = viewPos;
+    lightingBuffer.upload(lights);
+    Shader shader("./shader/light.vs", "./shader/light.fs");
+    lightingBuffer.attach(shader);
+    shader.use();
+    shader.set_int("material.diffuse", 0);
+    shader.set_int("material.specular", 1);
+    LightingUniforms loc(shader);
+    shader.set(loc.shininess, 32.0f);
+    shader.set(loc.view, glm::lookAt(viewPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+    shader.set(loc.projection, glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f));
+
+    // post-transform 缓存命中的顶点不再调用顶点着色器
+    const bool statistics = has_pipeline_statistics();
+    auto measure = [&](auto &&draw, uint64_t &invocations) {
+        invocations = statistics ? query_count(GL_VERTEX_SHADER_INVOCATIONS, draw) : 0;
+        return time_per_iteration(20, [&](uint32_t) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            draw();
+        });
+    };
+    uint64_t soupInvocations, meshInvocations;
+    double soupTime = measure(
+        [&] {
+            gl_state().bind_vertex_array(soupVao);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, soupCount, SPHERES);
+        },
+        soupInvocations);
+    double meshTime = measure([&] { mesh.draw(SPHERES); }, meshInvocations);
+
+    auto invocations = [&](uint64_t count) {
+        return statistics ? std::to_string(count) : std::string("n/a");
+    };
+    std::cout << "  " << SPHERES << " spheres x " << soupCount / 3 << " triangles at "
+              << TARGET_SIZE << "x" << TARGET_SIZE << "\n"
+              << "  glDrawArrays   (" << soupCount << " vertices): " << soupTime * 1e-6
+              << " ms, " << invocations(soupInvocations) << " VS invocations\n"
+              << "  glDrawElements (" << mesh.vertex_count() << " vertices): " << meshTime * 1e-6
+              << " ms, " << invocations(meshInvocations) << " VS invocations" << std::endl;
+
+    mesh.release();
+    gl_state().bind_vertex_array(0);
+    gl_state().delete_vertex_arrays(1, &soupVao);
+    gl_state().delete_buffers(1, &soupVbo);
+    gl_state().delete_buffers(1, &sphereInstances.id_);
+    gl_state().delete_buffers(1, &lightingBuffer.id_);
+    gl_state().delete_textures(1, &diffuse);
+    gl_state().delete_textures(1, &specular);
+    glDeleteProgram(shader.id_);
+    release_render_target(target);
+    glfwTerminate();
+}
+
+void bench_mesh_optimization()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    // 测试网格：按生成顺序 (已经有不错的局部性) 与打乱后的球面、圆环，
+    // 以及 3x3x3 个互相重叠的球合并成的一个网格，从任何方向看都有大量自遮挡
+    struct TestMesh {
+        std::string name;
+        IndexedMesh mesh;
+    };
+    std::vector<TestMesh> meshes;
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    uv_sphere(128, 128, vertices, indices);
+    meshes.push_back({"uv sphere 128x128", {8, vertices, indices}});
+    meshes.push_back({"torus 256x64", torus(256, 64, 0.6f, 0.25f)});
+    meshes.push_back({"uv sphere, shuffled", meshes[0].mesh});
+    shuffle_mesh(meshes.back().mesh, 1);
+    meshes.push_back({"torus, shuffled", meshes[1].mesh});
+    shuffle_mesh(meshes.back().mesh, 2);
+    IndexedMesh cluster;
+    cluster.components = 8;
+    uv_sphere(32, 32, vertices, indices);
+    for (uint32_t i = 0; i < 27; i++) {
+        glm::vec3 offset(i % 3, i / 3 % 3, i / 9);
+        offset = (offset - glm::vec3(1.0f)) * 0.8f;
+        const uint32_t base = static_cast<uint32_t>(cluster.vertex_count());
+        for (size_t v = 0; v < vertices.size(); v += 8) {
+            cluster.vertices.insert(cluster.vertices.end(), vertices.begin() + v,
+                                    vertices.begin() + v + 8);
+            for (uint32_t c = 0; c < 3; c++) cluster.vertices[base * 8 + v + c] += offset[c];
+        }
+        for (uint32_t index : indices) cluster.indices.push_back(base + index);
+    }
+    shuffle_mesh(cluster, 3);
+    meshes.push_back({"27 spheres, shuffled", cluster});
+
+    // 1. CPU：逐步优化后的 ACMR/ATVR 与顶点读取量
+    std::cout << "bench_mesh_optimization: FIFO post-transform cache, 64-byte fetch lines\n"
+              << "  mesh | step | ACMR (16) | ACMR (32) | ATVR (16) | overfetch | time (ms)"
+              << std::endl;
+    auto report = [](const std::string &name, const char *step, const IndexedMesh &mesh,
+                     double ns) {
+        VertexCacheStats fifo16 = analyze_vertex_cache(mesh, 16);
+        VertexCacheStats fifo32 = analyze_vertex_cache(mesh, 32);
+        std::cout << "  " << name << " | " << step << " | " << fifo16.acmr << " | " << fifo32.acmr
+                  << " | " << fifo16.atvr << " | " << fifo16.overfetch << " | " << ns * 1e-6
+                  << std::endl;
+    };
+    for (const TestMesh &test : meshes) {
+        IndexedMesh mesh;
+        report(test.name, "input", test.mesh, 0.0);
+        double ns = time_per_iteration(1, [&](uint32_t) {
+            mesh = test.mesh;
+            optimize_vertex_cache(mesh);
+        });
+        report(test.name, "vertex cache", mesh, ns);
+        ns = time_per_iteration(1, [&](uint32_t) { optimize_overdraw(mesh); });
+        report(test.name, "+ overdraw", mesh, ns);
+        ns = time_per_iteration(1, [&](uint32_t) { optimize_vertex_fetch(mesh); });
+        report(test.name, "+ vertex fetch", mesh, ns);
+    }
+
+    // 2. GPU：打乱的网格直接上传 vs 经过 Mesh 默认的优化后上传，从 6 个轴向各看一次，开启背面剔除；
+    // overdraw = 通过深度测试的片段数 / 最终覆盖的像素数 (第二遍以 GL_EQUAL 数出)
+    constexpr uint32_t TARGET_SIZE = 512;
+    RenderTarget target = create_render_target(TARGET_SIZE, TARGET_SIZE);
+    gl_state().enable(GL_DEPTH_TEST);
+    gl_state().enable(GL_CULL_FACE);
+    Shader shader("./shader/light_cube.vs", "./shader/light_cube.fs");
+    shader.use();
+    auto viewLoc = shader.uniform<glm::mat4>("view");
+    shader.set(shader.uniform<glm::mat4>("projection"),
+               glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f));
+    InstanceBuffer identity;
+    identity.upload(std::vector<glm::mat4>(1, glm::mat4(1.0f)));
+    const glm::vec3 axes[] = {{1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f},
+                              {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}};
+    const bool statistics = has_pipeline_statistics();
+
+    std::cout << "  " << TARGET_SIZE << "x" << TARGET_SIZE << ", 6 axis-aligned views\n"
+              << "  mesh | upload | VS invocations | overdraw | frame (ms)" << std::endl;
+    for (size_t i = 2; i < meshes.size(); i++) {
+        for (bool optimize : {false, true}) {
+            Mesh mesh(meshes[i].mesh, {3, 3, 2}, optimize);
+            identity.attach(mesh.vao_);
+            uint64_t invocations = 0, shaded = 0, covered = 0;
+            double ns = 0.0;
+            for (const glm::vec3 &axis : axes) {
+                glm::vec3 up(0.0f, axis.y == 0.0f, axis.y != 0.0f);
+                shader.set(viewLoc, glm::lookAt(axis * 4.0f, glm::vec3(0.0f), up));
+                auto draw = [&] { mesh.draw(1); };
+                if (statistics) invocations += query_count(GL_VERTEX_SHADER_INVOCATIONS, draw);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                shaded += query_count(GL_SAMPLES_PASSED, draw);
+                glDepthFunc(GL_EQUAL);
+                gl_state().depth_mask(false);
+                covered += query_count(GL_SAMPLES_PASSED, draw);
+                glDepthFunc(GL_LESS);
+                gl_state().depth_mask(true);
+                ns += time_per_iteration(10, [&](uint32_t) {
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    draw();
+                });
+            }
+            std::cout << "  " << meshes[i].name << " | " << (optimize ? "optimized" : "as is")
+                      << " | " << (statistics ? std::to_string(invocations) : std::string("n/a"))
+                      << " | " << (double)shaded / std::max<uint64_t>(covered, 1) << " | "
+                      << ns / 6 * 1e-6 << std::endl;
+            mesh.release();
+        }
+    }
+
+    gl_state().disable(GL_CULL_FACE);
+    gl_state().delete_buffers(1, &identity.id_);
+    glDeleteProgram(shader.id_);
+    release_render_target(target);
+    glfwTerminate();
+}
+
+void bench_vertex_formats()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    // 高面数球面 (约 105 万顶点、210 万三角形)，先做一次顶点缓存优化，各布局共用同一个索引缓冲顺序
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    uv_sphere(1024, 1024, vertices, indices);
+    IndexedMesh sphere;
+    sphere.components = 8;
+    sphere.vertices = std::move(vertices);
+    sphere.indices = std::move(indices);
+    optimize_mesh(sphere);
+    const size_t vertexCount = sphere.vertex_count();
+
+    // 渲染目标很小，耗时主要在顶点读取与顶点着色器
+    constexpr uint32_t TARGET_SIZE = 64;
+    constexpr uint32_t SPHERES = 8;
+    RenderTarget target = create_render_target(TARGET_SIZE, TARGET_SIZE);
+    gl_state().enable(GL_DEPTH_TEST);
+    uint32_t diffuse = solid_texture(200, 160, 120);
+    uint32_t specular = solid_texture(128, 128, 128);
+    gl_state().bind_texture(0, GL_TEXTURE_2D, diffuse);
+    gl_state().bind_texture(1, GL_TEXTURE_2D, specular);
+    const glm::vec3 viewPos(0.0f, 0.0f, 8.0f);
+    LightingBuffer lightingBuffer;
+    glm::vec3 unusedPositions[NR_POINT_LIGHTS] = {};
+    LightBlock lights = scene_light_block(unusedPositions);
+    lights.viewPos = viewPos;
+    lightingBuffer.upload(lights);
+    InstanceBuffer sphereInstances;
+    sphereInstances.upload(cube_field(SPHERES), TransformKind::UniformScale);
+
+    struct Format {
+        const char *name;
+        const VertexLayout &layout;
+    };
+    const Format formats[] = {{"float", VERTEX_LAYOUT_FLOAT},
+                              {"half/2_10_10_10/unorm16", VERTEX_LAYOUT_COMPACT16},
+                              {"half/octahedral8/half", VERTEX_LAYOUT_COMPACT12}};
+    std::cout << "bench_vertex_formats: " << vertexCount << " vertices, "
+              << sphere.indices.size() / 3 << " triangles, " << SPHERES << " instances at "
+              << TARGET_SIZE << "x" << TARGET_SIZE << "\n"
+              << "  layout | bytes/vertex | vertex buffer (MiB) | pack (ms) | max position error | "
+                 "max normal error (deg) | max uv error | frame (ms) | Mverts/s | fetch (GB/s)"
+              << std::endl;
+    for (const Format &format : formats) {
+        const VertexLayout &layout = format.layout;
+        std::vector<uint8_t> packed;
+        double packNs = time_per_iteration(
+            1, [&](uint32_t) { packed = layout.pack(sphere.vertices.data(), vertexCount); });
+        std::vector<float> decoded = layout.unpack(packed.data(), vertexCount);
+        float positionError = 0.0f, normalError = 0.0f, uvError = 0.0f;
+        for (size_t v = 0; v < vertexCount; v++) {
+            const float *a = &sphere.vertices[v * 8], *b = &decoded[v * 8];
+            for (uint32_t c = 0; c < 3; c++)
+                positionError = std::max(positionError, std::abs(a[c] - b[c]));
+            float dot = glm::dot(glm::normalize(glm::vec3(b[3], b[4], b[5])),
+                                 glm::vec3(a[3], a[4], a[5]));
+            normalError = std::max(normalError, std::acos(std::min(dot, 1.0f)));
+            for (uint32_t c = 6; c < 8; c++) uvError = std::max(uvError, std::abs(a[c] - b[c]));
+        }
+
+        Mesh mesh(sphere, layout, false);
+        sphereInstances.attach(mesh.vao_);
+        Shader shader("./shader/light.vs", "./shader/light.fs", layout.defines());
+        lightingBuffer.attach(shader);
+        shader.use();
+        shader.set_int("material.diffuse", 0);
+        shader.set_int("material.specular", 1);
+        LightingUniforms loc(shader);
+        shader.set(loc.shininess, 32.0f);
+        shader.set(loc.view, glm::lookAt(viewPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+        shader.set(loc.projection, glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 100.0f));
+        // 先画一帧，驱动的首次使用开销不计入
+        mesh.draw(SPHERES);
+        double ns = time_per_iteration(20, [&](uint32_t) {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            mesh.draw(SPHERES);
+        });
+
+        const double vertexBytes = (double)vertexCount * layout.stride();
+        std::cout << "  " << format.name << " | " << layout.stride() << " | "
+                  << vertexBytes / (1 << 20) << " | " << packNs * 1e-6 << " | " << positionError
+                  << " | " << glm::degrees(normalError) << " | " << uvError << " | " << ns * 1e-6
+                  << " | " << (double)vertexCount * SPHERES / ns * 1e3 << " | "
+                  << vertexBytes * SPHERES / ns << std::endl;
+        mesh.release();
+        glDeleteProgram(shader.id_);
+    }
+
+    gl_state().delete_buffers(1, &sphereInstances.id_);
+    gl_state().delete_buffers(1, &lightingBuffer.id_);
+    gl_state().delete_textures(1, &diffuse);
+    gl_state().delete_textures(1, &specular);
+    release_render_target(target);
+    glfwTerminate();
+}
+
+void bench_mesh_import()
+{
+    // 约 157 万顶点、315 万三角形的球面，写成约 380 MB 的 OBJ 与同一网格的 .glb
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    uv_sphere(1024, 1536, vertices, indices);
+    IndexedMesh sphere;
+    sphere.components = 8;
+    sphere.vertices = std::move(vertices);
+    sphere.indices = std::move(indices);
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::string objPath = (directory / "bench_mesh_import.obj").string();
+    const std::string glbPath = (directory / "bench_mesh_import.glb").string();
+    if (!write_obj(objPath, sphere) || !write_glb(glbPath, sphere)) {
+        std::cout << "ERROR::BENCH::WRITE_FAILED " << directory << std::endl;
+        return;
+    }
+    std::cout << "bench_mesh_import: " << sphere.vertex_count() << " vertices, "
+              << sphere.indices.size() / 3 << " triangles, OBJ "
+              << std::filesystem::file_size(objPath) / 1e6 << " MB, glb "
+              << std::filesystem::file_size(glbPath) / 1e6 << " MB\n"
+              << "  loader | threads | cold (MB/s) | warm best (ms) | parse (ms) | build (ms) | "
+                 "warm (MB/s) | vertices"
+              << std::endl;
+
+    // 冷：先丢弃 page cache 再读一次；热：随后 runs 次中最快的一次
+    auto measure = [&](const char *name, uint32_t threads, const std::string &path,
+                       uint32_t runs, auto &&load) {
+        IndexedMesh mesh;
+        MeshImportStats stats;
+        bool dropped = drop_file_cache(path);
+        double cold = 0.0, best = 1e30, parseMs = 0.0, buildMs = 0.0;
+        for (uint32_t run = 0; run <= runs; run++) {
+            mesh = IndexedMesh();
+            auto start = std::chrono::steady_clock::now();
+            if (!load(mesh, stats)) return;
+            double ms =
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                    .count();
+            if (run == 0) {
+                cold = ms;
+            } else if (ms < best) {
+                best = ms;
+                parseMs = stats.parseNs * 1e-6;
+                buildMs = stats.buildNs * 1e-6;
+            }
+        }
+        const double mb = std::filesystem::file_size(path) / 1e6;
+        std::cout << "  " << name << " | " << threads << " | " << mb / cold * 1e3
+                  << (dropped ? "" : " (page cache not dropped)") << " | " << best << " | "
+                  << parseMs << " | " << buildMs << " | " << mb / best * 1e3 << " | "
+                  << mesh.vertex_count() << std::endl;
+    };
+
+    // 对照组很慢，只热跑一次，解析与建立索引没有分开计时
+    measure("getline + istringstream", 1, objPath, 1,
+            [&](IndexedMesh &mesh, MeshImportStats &) { return load_obj_naive(objPath, mesh); });
+    const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (uint32_t threads = 1;; threads = std::min(threads * 2, hardwareThreads)) {
+        measure("mmap + from_chars", threads, objPath, 3,
+                [&](IndexedMesh &mesh, MeshImportStats &stats) {
+                    return load_obj(objPath, mesh, threads, &stats);
+                });
+        if (threads == hardwareThreads) break;
+    }
+    measure("glb", 1, glbPath, 3, [&](IndexedMesh &mesh, MeshImportStats &stats) {
+        return load_gltf(glbPath, mesh, &stats);
+    });
+
+    std::error_code ec;
+    std::filesystem::remove(objPath, ec);
+    std::filesystem::remove(glbPath, ec);
+}
+
+void bench_mesh_cache()
+{
+    GLFWwindow *window = create_bench_window();
+    if (window == nullptr) return;
+
+    // 与 bench_mesh_import 相同的约 380 MB OBJ，按 16 字节的顶点布局上传
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    uv_sphere(1024, 1536, vertices, indices);
+    IndexedMesh sphere;
+    sphere.components = 8;
+    sphere.vertices = std::move(vertices);
+    sphere.indices = std::move(indices);
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::string objPath = (directory / "bench_mesh_cache.obj").string();
+    const std::string cachePath = mesh_cache_path(objPath);
+    if (!write_obj(objPath, sphere)) {
+        std::cout << "ERROR::BENCH::WRITE_FAILED " << directory << std::endl;
+        glfwTerminate();
+        return;
+    }
+    sphere = IndexedMesh();
+    const VertexLayout &layout = VERTEX_LAYOUT_COMPACT16;
+
+    auto since = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+            .count();
+    };
+    auto writeStart = std::chrono::steady_clock::now();
+    IndexedMesh imported;
+    if (!load_obj(objPath, imported) || !write_mesh_cache(imported, layout, cachePath)) {
+        glfwTerminate();
+        return;
+    }
+    const double writeMs = since(writeStart);
+    imported = IndexedMesh();
+
+    MeshCache cache;
+    if (!cache.open(cachePath)) {
+        glfwTerminate();
+        return;
+    }
+    const MeshCacheHeader &header = cache.header();
+    std::cout << "bench_mesh_cache: " << header.vertexCount << " vertices, " << header.stride
+              << " bytes each; OBJ " << std::filesystem::file_size(objPath) / 1e6 << " MB -> "
+              << cache.file_bytes() / 1e6 << " MB .lmesh, first import + write took " << writeMs
+              << " ms\n  LOD | triangles | error" << std::endl;
+    for (uint32_t i = 0; i < header.lodCount; i++) {
+        std::cout << "  " << i << " | " << cache.lod(i).indexCount / 3 << " | "
+                  << cache.lod(i).error << std::endl;
+    }
+    cache.close();
+
+    // 每条路径都从文件开始，到网格上传完成 (glFinish) 为止；冷为丢弃 page cache 后的第一次
+    // 只读文件的一行是同一个 .lmesh 用 std::ifstream 读入内存的耗时，即 I/O 的下限
+    auto measure = [&](const char *name, const std::string &path, uint32_t runs, auto &&load) {
+        bool dropped = drop_file_cache(path);
+        double cold = 0.0, best = 1e30;
+        for (uint32_t run = 0; run <= runs; run++) {
+            auto start = std::chrono::steady_clock::now();
+            if (!load()) return;
+            glFinish();
+            double ms = since(start);
+            if (run == 0)
+                cold = ms;
+            else
+                best = std::min(best, ms);
+        }
+        const double mb = std::filesystem::file_size(path) / 1e6;
+        std::cout << "  " << name << " | " << cold << (dropped ? "" : " (page cache not dropped)")
+                  << " | " << best << " | " << mb / best * 1e3 << std::endl;
+    };
+    std::cout << "  path | cold (ms) | warm best (ms) | warm (MB/s of its file)" << std::endl;
+    measure("parse OBJ + optimise + pack", objPath, 2, [&]() {
+        IndexedMesh mesh;
+        if (!load_obj(objPath, mesh)) return false;
+        Mesh uploaded(mesh, layout);
+        uploaded.release();
+        return true;
+    });
+    measure("map .lmesh + glBufferData", cachePath, 5, [&]() {
+        if (!cache.open(cachePath)) return false;
+        Mesh uploaded = cache.create_mesh();
+        uploaded.release();
+        cache.close();
+        return true;
+    });
+    measure("map .lmesh + prefetch + glBufferData", cachePath, 5, [&]() {
+        if (!cache.open(cachePath)) return false;
+        cache.prefetch();
+        Mesh uploaded = cache.create_mesh();
+        uploaded.release();
+        cache.close();
+        return true;
+    });
+    measure("read .lmesh only", cachePath, 5, [&]() {
+        std::ifstream file(cachePath, std::ios::binary);
+        std::vector<char> bytes(std::filesystem::file_size(cachePath));
+        file.read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        return static_cast<bool>(file);
+    });
+
+    std::error_code ec;
+    std::filesystem::remove(objPath, ec);
+    std::filesystem::remove(cachePath, ec);
+    glfwTerminate();
+}
@@ -0,0 +1,385 @@
+#include "block_compress.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+#include "gl_state.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLOCK_COMPRESS_SSE2 1
+#endif
+
+namespace {
+const BlockFormatInfo FORMAT_INFO[] = {
+    {GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_RGB, 8, 3, "BC1"},
+    {GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_RGBA, 16, 4, "BC3"},
+    {GL_COMPRESSED_RED_RGTC1, GL_RED, 8, 1, "BC4"},
+    {GL_COMPRESSED_RG_RGTC2, GL_RG, 16, 2, "BC5"},
+};
+
+// 取出 (bx, by) 处的 4x4 块，统一展开为 RGBA，越界的像素重复最后一行/列
+void fetch_block(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels,
+                 uint32_t bx, uint32_t by, uint8_t block[64])
+{
+    for (uint32_t y = 0; y < 4; y++) {
+        const uint8_t *row = pixels + (size_t)std::min(by * 4 + y, height - 1) * width * channels;
+        for (uint32_t x = 0; x < 4; x++) {
+            const uint8_t *p = row + (size_t)std::min(bx * 4 + x, width - 1) * channels;
+            uint8_t *out = block + (y * 4 + x) * 4;
+            out[0] = p[0];
+            out[1] = channels == 1 ? p[0] : p[1];
+            out[2] = channels == 1 ? p[0] : channels == 2 ? 0 : p[2];
+            out[3] = channels == 4 ? p[3] : 255;
+        }
+    }
+}
+
+// 16 个像素每个通道的最小值与最大值
+void block_bounds(const uint8_t block[64], uint8_t minColor[4], uint8_t maxColor[4])
+{
+#ifdef BLOCK_COMPRESS_SSE2
+    const __m128i *rows = reinterpret_cast<const __m128i *>(block);
+    __m128i r0 = _mm_loadu_si128(rows), r1 = _mm_loadu_si128(rows + 1);
+    __m128i r2 = _mm_loadu_si128(rows + 2), r3 = _mm_loadu_si128(rows + 3);
+    __m128i low = _mm_min_epu8(_mm_min_epu8(r0, r1), _mm_min_epu8(r2, r3));
+    __m128i high = _mm_max_epu8(_mm_max_epu8(r0, r1), _mm_max_epu8(r2, r3));
+    // 寄存器内的 4 个像素两两折叠
+    low = _mm_min_epu8(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(1, 0, 3, 2)));
+    low = _mm_min_epu8(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(2, 3, 0, 1)));
+    high = _mm_max_epu8(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(1, 0, 3, 2)));
+    high = _mm_max_epu8(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(2, 3, 0, 1)));
+    int32_t lowBits = _mm_cvtsi128_si32(low), highBits = _mm_cvtsi128_si32(high);
+    std::memcpy(minColor, &lowBits, 4);
+    std::memcpy(maxColor, &highBits, 4);
+#else
+    for (uint32_t c = 0; c < 4; c++) {
+        minColor[c] = 255;
+        maxColor[c] = 0;
+    }
+    for (uint32_t i = 0; i < 16; i++) {
+        for (uint32_t c = 0; c < 4; c++) {
+            minColor[c] = std::min(minColor[c], block[i * 4 + c]);
+            maxColor[c] = std::max(maxColor[c], block[i * 4 + c]);
+        }
+    }
+#endif
+}
+
+uint16_t pack_565(const uint8_t color[4])
+{
+    return static_cast<uint16_t>(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) |
+                                 (color[2] >> 3));
+}
+
+// 与硬件一致，低位用高位复制填充
+void unpack_565(uint16_t packed, uint8_t color[4])
+{
+    uint32_t r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+    color[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+    color[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+    color[3] = 255;
+}
+
+void bc1_palette(uint16_t color0, uint16_t color1, uint8_t palette[4][4])
+{
+    unpack_565(color0, palette[0]);
+    unpack_565(color1, palette[1]);
+    for (uint32_t c = 0; c < 4; c++) {
+        if (color0 > color1) {
+            palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c]) / 3);
+            palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c]) / 3);
+        } else {
+            // 三色模式，索引 3 为透明黑；编码器不会生成，只有解码时用到
+            palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c]) / 2);
+            palette[3][c] = 0;
+        }
+    }
+}
+
+// 每个像素选择 RGB 距离最近的调色板颜色，返回 16 个 2 bit 索引
+uint32_t bc1_indices(const uint8_t block[64], const uint8_t palette[4][4])
+{
+    uint32_t indices = 0;
+#ifdef BLOCK_COMPRESS_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+    __m128i colors[4];
+    for (uint32_t k = 0; k < 4; k++) {
+        const uint8_t *p = palette[k];
+        colors[k] = _mm_set_epi16(0, p[2], p[1], p[0], 0, p[2], p[1], p[0]);
+    }
+    for (uint32_t row = 0; row < 4; row++) {
+        __m128i pixels = _mm_and_si128(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + row * 16)), rgbMask);
+        __m128i low = _mm_unpacklo_epi8(pixels, zero);
+        __m128i high = _mm_unpackhi_epi8(pixels, zero);
+        __m128i best = zero, index = zero;
+        for (uint32_t k = 0; k < 4; k++) {
+            // madd 得到 (dr² + dg², db²) 两两一组，再加上相邻的一半就是每个像素的距离
+            __m128i dl = _mm_sub_epi16(low, colors[k]);
+            __m128i dh = _mm_sub_epi16(high, colors[k]);
+            dl = _mm_madd_epi16(dl, dl);
+            dh = _mm_madd_epi16(dh, dh);
+            dl = _mm_add_epi32(dl, _mm_shuffle_epi32(dl, _MM_SHUFFLE(2, 3, 0, 1)));
+            dh = _mm_add_epi32(dh, _mm_shuffle_epi32(dh, _MM_SHUFFLE(2, 3, 0, 1)));
+            __m128i distance = _mm_castps_si128(_mm_shuffle_ps(
+                _mm_castsi128_ps(dl), _mm_castsi128_ps(dh), _MM_SHUFFLE(2, 0, 2, 0)));
+            if (k == 0) {
+                best = distance;
+                continue;
+            }
+            __m128i closer = _mm_cmplt_epi32(distance, best);
+            best = _mm_or_si128(_mm_and_si128(closer, distance), _mm_andnot_si128(closer, best));
+            index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)),
+                                 _mm_andnot_si128(closer, index));
+        }
+        alignas(16) uint32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanes), index);
+        for (uint32_t i = 0; i < 4; i++) indices |= lanes[i] << (2 * (row * 4 + i));
+    }
+#else
+    for (uint32_t i = 0; i < 16; i++) {
+        const uint8_t *pixel = block + i * 4;
+        uint32_t bestIndex = 0;
+        int32_t bestDistance = std::numeric_limits<int32_t>::max();
+        for (uint32_t k = 0; k < 4; k++) {
+            int32_t distance = 0;
+            for (uint32_t c = 0; c < 3; c++) {
+                int32_t d = pixel[c] - palette[k][c];
+                distance += d * d;
+            }
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                bestIndex = k;
+            }
+        }
+        indices |= bestIndex << (2 * i);
+    }
+#endif
+    return indices;
+}
+
+void encode_bc1(const uint8_t block[64], const uint8_t minColor[4], const uint8_t maxColor[4],
+                uint8_t *out)
+{
+    // 包围盒向内收缩 1/16，端点不再落在极值上，多数像素离插值点更近
+    uint8_t low[4], high[4];
+    for (uint32_t c = 0; c < 4; c++) {
+        uint32_t inset = (maxColor[c] - minColor[c]) >> 4;
+        low[c] = static_cast<uint8_t>(minColor[c] + inset);
+        high[c] = static_cast<uint8_t>(maxColor[c] - inset);
+    }
+    // 各通道都有 high >= low，所以 color0 >= color1；两者量化后相等时索引全为 0
+    uint16_t color0 = pack_565(high);
+    uint16_t color1 = pack_565(low);
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        uint8_t palette[4][4];
+        bc1_palette(color0, color1, palette);
+        indices = bc1_indices(block, palette);
+    }
+    out[0] = static_cast<uint8_t>(color0);
+    out[1] = static_cast<uint8_t>(color0 >> 8);
+    out[2] = static_cast<uint8_t>(color1);
+    out[3] = static_cast<uint8_t>(color1 >> 8);
+    std::memcpy(out + 4, &indices, 4);
+}
+
+// 块中第 channel 个通道编码为 BC4，总是使用 8 级插值模式 (端点 0 > 端点 1)
+void encode_bc4(const uint8_t block[64], uint32_t channel, uint8_t low, uint8_t high,
+                uint8_t *out)
+{
+    out[0] = high;
+    out[1] = low;
+    uint64_t indices = 0;
+    if (high > low) {
+        uint32_t range = high - low;
+        for (uint32_t i = 0; i < 16; i++) {
+            // 到 high 的距离四舍五入到 0..7 级，第 0 级为端点 0，第 7 级为端点 1，
+            // 中间第 k 级是 ((7 - k) * high + k * low) / 7，对应索引 k + 1
+            uint32_t level = ((high - block[i * 4 + channel]) * 14 + range) / (2 * range);
+            uint64_t index = level == 0 ? 0 : level == 7 ? 1 : level + 1;
+            indices |= index << (3 * i);
+        }
+    }
+    for (uint32_t i = 0; i < 6; i++) out[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+}
+
+void encode_block(const uint8_t block[64], BlockFormat format, uint8_t *out)
+{
+    uint8_t minColor[4], maxColor[4];
+    block_bounds(block, minColor, maxColor);
+    switch (format) {
+        case BlockFormat::BC1: encode_bc1(block, minColor, maxColor, out); break;
+        case BlockFormat::BC3:
+            encode_bc4(block, 3, minColor[3], maxColor[3], out);
+            encode_bc1(block, minColor, maxColor, out + 8);
+            break;
+        case BlockFormat::BC4: encode_bc4(block, 0, minColor[0], maxColor[0], out); break;
+        case BlockFormat::BC5:
+            encode_bc4(block, 0, minColor[0], maxColor[0], out);
+            encode_bc4(block, 1, minColor[1], maxColor[1], out + 8);
+            break;
+    }
+}
+
+// 解码到 16 个像素的第 channel 个字节，像素间隔 stride 字节
+void decode_bc4(const uint8_t *in, uint8_t *out, uint32_t stride)
+{
+    uint32_t a0 = in[0], a1 = in[1];
+    uint8_t palette[8] = {static_cast<uint8_t>(a0), static_cast<uint8_t>(a1)};
+    if (a0 > a1) {
+        for (uint32_t k = 1; k < 7; k++)
+            palette[k + 1] = static_cast<uint8_t>(((7 - k) * a0 + k * a1) / 7);
+    } else {
+        for (uint32_t k = 1; k < 5; k++)
+            palette[k + 1] = static_cast<uint8_t>(((5 - k) * a0 + k * a1) / 5);
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    uint64_t indices = 0;
+    for (uint32_t i = 0; i < 6; i++) indices |= (uint64_t)in[2 + i] << (8 * i);
+    for (uint32_t i = 0; i < 16; i++) out[i * stride] = palette[(indices >> (3 * i)) & 7];
+}
+
+void decode_bc1(const uint8_t *in, uint8_t *out, uint32_t stride)
+{
+    uint16_t color0 = static_cast<uint16_t>(in[0] | (in[1] << 8));
+    uint16_t color1 = static_cast<uint16_t>(in[2] | (in[3] << 8));
+    uint8_t palette[4][4];
+    bc1_palette(color0, color1, palette);
+    uint32_t indices;
+    std::memcpy(&indices, in + 4, 4);
+    for (uint32_t i = 0; i < 16; i++) {
+        const uint8_t *color = palette[(indices >> (2 * i)) & 3];
+        for (uint32_t c = 0; c < 3; c++) out[i * stride + c] = color[c];
+    }
+}
+
+// 解码一个块为 16 个像素，每像素 block_format_info(format).channels 字节
+void decode_block(const uint8_t *in, BlockFormat format, uint8_t *out)
+{
+    switch (format) {
+        case BlockFormat::BC1: decode_bc1(in, out, 3); break;
+        case BlockFormat::BC3:
+            decode_bc4(in, out + 3, 4);
+            decode_bc1(in + 8, out, 4);
+            break;
+        case BlockFormat::BC4: decode_bc4(in, out, 1); break;
+        case BlockFormat::BC5:
+            decode_bc4(in, out, 2);
+            decode_bc4(in + 8, out + 1, 2);
+            break;
+    }
+}
+}  // namespace
+
+const BlockFormatInfo &block_format_info(BlockFormat format)
+{
+    return FORMAT_INFO[static_cast<uint32_t>(format)];
+}
+
+std::optional<BlockFormat> block_format_from_gl(GLenum internalFormat)
+{
+    for (BlockFormat format :
+         {BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC4, BlockFormat::BC5}) {
+        if (block_format_info(format).internalFormat == internalFormat) return format;
+    }
+    return std::nullopt;
+}
+
+BlockFormat block_format_for(uint32_t channels)
+{
+    switch (channels) {
+        case 1: return BlockFormat::BC4;
+        case 2: return BlockFormat::BC5;
+        case 3: return BlockFormat::BC1;
+        default: return BlockFormat::BC3;
+    }
+}
+
+size_t compressed_size(BlockFormat format, uint32_t width, uint32_t height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * block_format_info(format).blockBytes;
+}
+
+bool block_format_supported(BlockFormat format)
+{
+    if (format == BlockFormat::BC4 || format == BlockFormat::BC5) return true;
+    static const bool s3tc = has_extension("GL_EXT_texture_compression_s3tc");
+    return s3tc;
+}
+
+std::vector<uint8_t> compress_blocks(const uint8_t *pixels, uint32_t width, uint32_t height,
+                                     uint32_t channels, BlockFormat format, uint32_t threads)
+{
+    const uint32_t blockBytes = block_format_info(format).blockBytes;
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+    std::vector<uint8_t> result((size_t)blocksX * blocksY * blockBytes);
+
+    std::atomic<uint32_t> nextRow {0};
+    auto work = [&]() {
+        uint8_t block[64];
+        for (uint32_t by = nextRow++; by < blocksY; by = nextRow++) {
+            uint8_t *out = result.data() + (size_t)by * blocksX * blockBytes;
+            for (uint32_t bx = 0; bx < blocksX; bx++, out += blockBytes) {
+                fetch_block(pixels, width, height, channels, bx, by, block);
+                encode_block(block, format, out);
+            }
+        }
+    };
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, blocksY);
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < threads; i++) workers.emplace_back(work);
+    work();
+    for (std::thread &worker : workers) worker.join();
+    return result;
+}
+
+std::vector<uint8_t> decompress_blocks(const uint8_t *blocks, uint32_t width, uint32_t height,
+                                       BlockFormat format)
+{
+    const BlockFormatInfo &info = block_format_info(format);
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+    std::vector<uint8_t> result((size_t)width * height * info.channels);
+    uint8_t decoded[16 * 4];
+    for (uint32_t by = 0; by < blocksY; by++) {
+        for (uint32_t bx = 0; bx < blocksX; bx++, blocks += info.blockBytes) {
+            decode_block(blocks, format, decoded);
+            uint32_t rows = std::min(4u, height - by * 4);
+            uint32_t columns = std::min(4u, width - bx * 4);
+            for (uint32_t y = 0; y < rows; y++) {
+                std::memcpy(
+                    result.data() + ((size_t)(by * 4 + y) * width + bx * 4) * info.channels,
+                    decoded + y * 4 * info.channels, columns * info.channels);
+            }
+        }
+    }
+    return result;
+}
+
+double psnr(const uint8_t *a, uint32_t aChannels, const uint8_t *b, uint32_t bChannels,
+            uint32_t width, uint32_t height)
+{
+    const uint32_t channels = std::min(aChannels, bChannels);
+    const size_t pixels = (size_t)width * height;
+    double squared = 0.0;
+    for (size_t i = 0; i < pixels; i++) {
+        for (uint32_t c = 0; c < channels; c++) {
+            double d = (double)a[i * aChannels + c] - b[i * bChannels + c];
+            squared += d * d;
+        }
+    }
+    double mse = squared / (pixels * channels);
+    if (mse == 0.0) return std::numeric_limits<double>::infinity();
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
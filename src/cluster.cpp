@@ -0,0 +1,147 @@
+#include "cluster.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "gl_state.h"
+
+namespace {
+// ndc 坐标 [-1, 1] 映射到 [0, n) 的 tile 下标
+uint16_t ndc_to_tile(float ndc, uint32_t n)
+{
+    int tile = static_cast<int>((ndc * 0.5f + 0.5f) * n);
+    return static_cast<uint16_t>(std::clamp(tile, 0, static_cast<int>(n) - 1));
+}
+}  // namespace
+
+ClusterGrid::ClusterGrid(float zNear, float zFar) : zNear_(zNear), zFar_(zFar)
+{
+    const GLenum formats[3] = {GL_RGBA32F, GL_RG32UI, GL_R32UI};
+    glGenBuffers(3, buffers_);
+    glGenTextures(3, textures_);
+    for (uint32_t i = 0; i < 3; i++) {
+        // texture buffer 引用的是 buffer object，之后 glBufferData 重新分配存储也无需再次关联
+        gl_state().bind_buffer(GL_TEXTURE_BUFFER, buffers_[i]);
+        glBufferData(GL_TEXTURE_BUFFER, sizeof(PointLight), NULL, GL_STREAM_DRAW);
+        gl_state().edit_texture(GL_TEXTURE_BUFFER, textures_[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers_[i]);
+    }
+    gl_state().bind_buffer(GL_TEXTURE_BUFFER, 0);
+    gl_state().edit_texture(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusterGrid::attach(const Shader &shader, uint32_t screenWidth, uint32_t screenHeight) const
+{
+    float logRatio = std::log(zFar_ / zNear_);
+    shader.use();
+    shader.set_int("clusterLights", CLUSTER_LIGHTS_UNIT);
+    shader.set_int("clusterGrid", CLUSTER_GRID_UNIT);
+    shader.set_int("clusterIndices", CLUSTER_INDICES_UNIT);
+    shader.set_float("clusterScale", CLUSTER_Z / logRatio);
+    shader.set_float("clusterBias", -(CLUSTER_Z * std::log(zNear_)) / logRatio);
+    shader.set_float("zNear", zNear_);
+    shader.set_float("zFar", zFar_);
+    resize(shader, screenWidth, screenHeight);
+}
+
+void ClusterGrid::resize(const Shader &shader, uint32_t screenWidth, uint32_t screenHeight) const
+{
+    shader.use();
+    glUniform2f(shader.location("screenSize"), (float)screenWidth, (float)screenHeight);
+}
+
+void ClusterGrid::update(const std::vector<PointLight> &lights, const glm::mat4 &view, float fovy,
+                         float aspect)
+{
+    float tanY = std::tan(fovy * 0.5f);
+    float tanX = tanY * aspect;
+    float logRatio = std::log(zFar_ / zNear_);
+    auto slice = [&](float depth) {
+        int z = static_cast<int>(std::log(depth / zNear_) / logRatio * CLUSTER_Z);
+        return static_cast<uint16_t>(std::clamp(z, 0, static_cast<int>(CLUSTER_Z) - 1));
+    };
+
+    // 1. 求每个光源包围球覆盖的 cluster 范围（保守的 AABB），并统计每个 cluster 的光源数
+    //    grid_[2 * c] 为 offset，grid_[2 * c + 1] 为 count
+    grid_.assign(CLUSTER_COUNT * 2, 0);
+    ranges_.resize(lights.size());
+    for (size_t i = 0; i < lights.size(); i++) {
+        glm::vec3 center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+        float radius = lights[i].radius;
+        float depth = -center.z;
+        float nearDepth = std::max(depth - radius, zNear_);
+        float farDepth = std::min(depth + radius, zFar_);
+        ClusterRange &range = ranges_[i];
+        if (nearDepth > farDepth) {
+            // 完全在视锥体前后之外，x0 > x1 表示空范围
+            range = {1, 0, 0, 0, 0, 0};
+            continue;
+        }
+        // 包围盒的每条边在深度范围内投影到最靠外的位置
+        float left = center.x - radius;
+        float right = center.x + radius;
+        float bottom = center.y - radius;
+        float top = center.y + radius;
+        range.x0 = ndc_to_tile(left / ((left < 0.0f ? nearDepth : farDepth) * tanX), CLUSTER_X);
+        range.x1 = ndc_to_tile(right / ((right > 0.0f ? nearDepth : farDepth) * tanX), CLUSTER_X);
+        range.y0 = ndc_to_tile(bottom / ((bottom < 0.0f ? nearDepth : farDepth) * tanY), CLUSTER_Y);
+        range.y1 = ndc_to_tile(top / ((top > 0.0f ? nearDepth : farDepth) * tanY), CLUSTER_Y);
+        range.z0 = slice(nearDepth);
+        range.z1 = slice(farDepth);
+        for (uint32_t z = range.z0; z <= range.z1; z++) {
+            for (uint32_t y = range.y0; y <= range.y1; y++) {
+                for (uint32_t x = range.x0; x <= range.x1; x++) {
+                    grid_[((z * CLUSTER_Y + y) * CLUSTER_X + x) * 2 + 1]++;
+                }
+            }
+        }
+    }
+
+    // 2. 前缀和得到每个 cluster 在下标列表中的起始位置，count 清零后作为写入游标
+    uint32_t total = 0;
+    for (uint32_t c = 0; c < CLUSTER_COUNT; c++) {
+        grid_[c * 2] = total;
+        total += grid_[c * 2 + 1];
+        grid_[c * 2 + 1] = 0;
+    }
+
+    // 3. 按 cluster 把光源下标写入列表
+    indices_.resize(total);
+    for (size_t i = 0; i < lights.size(); i++) {
+        const ClusterRange &range = ranges_[i];
+        if (range.x0 > range.x1) continue;
+        for (uint32_t z = range.z0; z <= range.z1; z++) {
+            for (uint32_t y = range.y0; y <= range.y1; y++) {
+                for (uint32_t x = range.x0; x <= range.x1; x++) {
+                    uint32_t c = (z * CLUSTER_Y + y) * CLUSTER_X + x;
+                    indices_[grid_[c * 2] + grid_[c * 2 + 1]++] = static_cast<uint32_t>(i);
+                }
+            }
+        }
+    }
+
+    // 4. 上传，glBufferData 每次都重新分配，驱动不必等待上一帧对旧数据的读取
+    auto upload = [](uint32_t buffer, size_t size, const void *data) {
+        gl_state().bind_buffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(size, sizeof(PointLight)),
+                     size ? data : NULL, GL_STREAM_DRAW);
+    };
+    upload(buffers_[0], lights.size() * sizeof(PointLight), lights.data());
+    upload(buffers_[1], grid_.size() * sizeof(uint32_t), grid_.data());
+    upload(buffers_[2], indices_.size() * sizeof(uint32_t), indices_.data());
+    gl_state().bind_buffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusterGrid::bind() const
+{
+    const uint32_t units[3] = {CLUSTER_LIGHTS_UNIT, CLUSTER_GRID_UNIT, CLUSTER_INDICES_UNIT};
+    for (uint32_t i = 0; i < 3; i++) {
+        gl_state().bind_texture(units[i], GL_TEXTURE_BUFFER, textures_[i]);
+    }
+}
+
+void ClusterGrid::release()
+{
+    gl_state().delete_textures(3, textures_);
+    gl_state().delete_buffers(3, buffers_);
+}
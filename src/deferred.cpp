@@ -0,0 +1,219 @@
+#include "deferred.h"
+
+#include <iostream>
+
+#include "geometry.h"
+#include "gl_state.h"
+
+namespace {
+struct GBufferFormat {
+    GLenum internalFormat;
+    GLenum format;
+    GLenum type;
+};
+constexpr GBufferFormat ALBEDO_SPEC_FORMAT = {GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE};
+constexpr GBufferFormat NORMAL_FORMAT = {GL_RG16F, GL_RG, GL_FLOAT};
+constexpr GBufferFormat DEPTH_FORMAT = {GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL,
+                                        GL_UNSIGNED_INT_24_8};
+
+// 重新定义纹理的存储，名字不变，framebuffer 的附件无需重新关联
+void allocate_gbuffer_texture(uint32_t texture, const GBufferFormat &format, uint32_t width,
+                              uint32_t height)
+{
+    gl_state().edit_texture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, format.internalFormat, width, height, 0, format.format,
+                 format.type, NULL);
+}
+
+uint32_t create_gbuffer_texture(const GBufferFormat &format, uint32_t width, uint32_t height)
+{
+    uint32_t texture;
+    glGenTextures(1, &texture);
+    allocate_gbuffer_texture(texture, format, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+void set_screen_size(const Shader &shader, uint32_t width, uint32_t height)
+{
+    shader.use();
+    glUniform2f(shader.location("screenSize"), (float)width, (float)height);
+}
+
+// 两个光照 pass 共用的 sampler 与屏幕尺寸
+void setup_lighting_pass(const Shader &shader, uint32_t width, uint32_t height)
+{
+    shader.use();
+    shader.set_int("gAlbedoSpec", GBUFFER_ALBEDO_SPEC_UNIT);
+    shader.set_int("gNormal", GBUFFER_NORMAL_UNIT);
+    shader.set_int("gDepth", GBUFFER_DEPTH_UNIT);
+    set_screen_size(shader, width, height);
+}
+}  // namespace
+
+DeferredRenderer::DeferredRenderer(uint32_t width, uint32_t height)
+    : width_(width),
+      height_(height),
+      lightCount_(0),
+      ambientPass_("./shader/deferred_ambient.vs", "./shader/deferred_ambient.fs"),
+      pointPass_("./shader/deferred_point.vs", "./shader/deferred_point.fs")
+{
+    // G-buffer：两张颜色纹理 + 可采样的深度纹理，位置由深度反推而不单独存储
+    albedoSpec_ = create_gbuffer_texture(ALBEDO_SPEC_FORMAT, width, height);
+    normal_ = create_gbuffer_texture(NORMAL_FORMAT, width, height);
+    depth_ = create_gbuffer_texture(DEPTH_FORMAT, width, height);
+    glGenFramebuffers(1, &fbo_);
+    gl_state().bind_framebuffer(GL_FRAMEBUFFER, fbo_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoSpec_, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normal_, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depth_, 0);
+    const GLenum attachments[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, attachments);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::DEFERRED::GBUFFER_INCOMPLETE" << std::endl;
+    gl_state().bind_framebuffer(GL_FRAMEBUFFER, 0);
+
+    // 全屏三角形的顶点由 gl_VertexID 生成，但 core profile 要求绑定一个 VAO
+    glGenVertexArrays(1, &emptyVao_);
+
+    // 光体积用只有位置的索引单位立方体，卷绕一致，剔除正面后每个像素恰好覆盖一次
+    glGenVertexArrays(1, &volumeVao_);
+    glGenBuffers(1, &volumeVbo_);
+    glGenBuffers(1, &volumeEbo_);
+    gl_state().bind_vertex_array(volumeVao_);
+    gl_state().bind_buffer(GL_ARRAY_BUFFER, volumeVbo_);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(VOLUME_CUBE_VERTICES), VOLUME_CUBE_VERTICES,
+                 GL_STATIC_DRAW);
+    gl_state().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, volumeEbo_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(VOLUME_CUBE_INDICES), VOLUME_CUBE_INDICES,
+                 GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+    glEnableVertexAttribArray(0);
+    gl_state().bind_vertex_array(0);
+
+    glGenBuffers(1, &lightBuffer_);
+    glGenTextures(1, &lightTexture_);
+    gl_state().bind_buffer(GL_TEXTURE_BUFFER, lightBuffer_);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(PointLight), NULL, GL_STATIC_DRAW);
+    gl_state().edit_texture(GL_TEXTURE_BUFFER, lightTexture_);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, lightBuffer_);
+    gl_state().bind_buffer(GL_TEXTURE_BUFFER, 0);
+
+    setup_lighting_pass(ambientPass_, width, height);
+    ambientInvViewProjection_ = ambientPass_.uniform<glm::mat4>("invViewProjection");
+    ambientShininess_ = ambientPass_.uniform<float>("shininess");
+    setup_lighting_pass(pointPass_, width, height);
+    pointPass_.set_int("pointLightData", DEFERRED_LIGHTS_UNIT);
+    pointInvViewProjection_ = pointPass_.uniform<glm::mat4>("invViewProjection");
+    pointViewProjection_ = pointPass_.uniform<glm::mat4>("viewProjection");
+    pointShininess_ = pointPass_.uniform<float>("shininess");
+}
+
+void DeferredRenderer::attach(const LightingBuffer &lighting) const
+{
+    lighting.attach(ambientPass_);
+    lighting.attach(pointPass_);
+}
+
+void DeferredRenderer::set_point_lights(const std::vector<PointLight> &lights)
+{
+    lightCount_ = static_cast<uint32_t>(lights.size());
+    if (lights.empty()) return;
+    gl_state().bind_buffer(GL_TEXTURE_BUFFER, lightBuffer_);
+    glBufferData(GL_TEXTURE_BUFFER, lights.size() * sizeof(PointLight), lights.data(),
+                 GL_STATIC_DRAW);
+    gl_state().bind_buffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void DeferredRenderer::resize(uint32_t width, uint32_t height)
+{
+    if (width == width_ && height == height_) return;
+    width_ = width;
+    height_ = height;
+    allocate_gbuffer_texture(albedoSpec_, ALBEDO_SPEC_FORMAT, width, height);
+    allocate_gbuffer_texture(normal_, NORMAL_FORMAT, width, height);
+    allocate_gbuffer_texture(depth_, DEPTH_FORMAT, width, height);
+    set_screen_size(ambientPass_, width, height);
+    set_screen_size(pointPass_, width, height);
+}
+
+void DeferredRenderer::begin_geometry() const
+{
+    gl_state().bind_framebuffer(GL_FRAMEBUFFER, fbo_);
+    gl_state().viewport(0, 0, width_, height_);
+    gl_state().enable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void DeferredRenderer::resolve(const glm::mat4 &view, const glm::mat4 &projection,
+                               float shininess, uint32_t targetFbo) const
+{
+    glm::mat4 viewProjection = projection * view;
+    glm::mat4 invViewProjection = glm::inverse(viewProjection);
+
+    // 目标与 G-buffer 同样大小，begin_geometry() 改过的视口在这里恢复给目标
+    gl_state().bind_framebuffer(GL_FRAMEBUFFER, targetFbo);
+    gl_state().viewport(0, 0, width_, height_);
+    gl_state().bind_texture(GBUFFER_ALBEDO_SPEC_UNIT, GL_TEXTURE_2D, albedoSpec_);
+    gl_state().bind_texture(GBUFFER_NORMAL_UNIT, GL_TEXTURE_2D, normal_);
+    gl_state().bind_texture(GBUFFER_DEPTH_UNIT, GL_TEXTURE_2D, depth_);
+    gl_state().bind_texture(DEFERRED_LIGHTS_UNIT, GL_TEXTURE_BUFFER, lightTexture_);
+
+    // 光照 pass 不读写深度，每个像素的几何信息都来自 G-buffer
+    gl_state().disable(GL_DEPTH_TEST);
+    gl_state().depth_mask(false);
+
+    // 1. 全屏三角形：方向光 + 聚光灯
+    ambientPass_.use();
+    ambientPass_.set(ambientInvViewProjection_, invViewProjection);
+    ambientPass_.set(ambientShininess_, shininess);
+    gl_state().bind_vertex_array(emptyVao_);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // 2. 点光源光体积，加法混合；剔除正面使摄像机位于光体积内部时也能覆盖到像素
+    if (lightCount_ > 0) {
+        gl_state().enable(GL_BLEND);
+        gl_state().blend_func(GL_ONE, GL_ONE);
+        gl_state().enable(GL_CULL_FACE);
+        gl_state().cull_face(GL_FRONT);
+        pointPass_.use();
+        pointPass_.set(pointInvViewProjection_, invViewProjection);
+        pointPass_.set(pointViewProjection_, viewProjection);
+        pointPass_.set(pointShininess_, shininess);
+        gl_state().bind_vertex_array(volumeVao_);
+        glDrawElementsInstanced(GL_TRIANGLES, VOLUME_CUBE_INDEX_COUNT, GL_UNSIGNED_BYTE, 0,
+                                lightCount_);
+        gl_state().cull_face(GL_BACK);
+        gl_state().disable(GL_CULL_FACE);
+        gl_state().disable(GL_BLEND);
+    }
+
+    gl_state().depth_mask(true);
+    gl_state().enable(GL_DEPTH_TEST);
+
+    // 3. 深度拷贝到目标 framebuffer，之后前向绘制的灯泡等物体能与场景正确遮挡
+    gl_state().bind_framebuffer(GL_READ_FRAMEBUFFER, fbo_);
+    gl_state().bind_framebuffer(GL_DRAW_FRAMEBUFFER, targetFbo);
+    glBlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_, GL_DEPTH_BUFFER_BIT,
+                      GL_NEAREST);
+    gl_state().bind_framebuffer(GL_FRAMEBUFFER, targetFbo);
+}
+
+void DeferredRenderer::release()
+{
+    gl_state().delete_framebuffers(1, &fbo_);
+    gl_state().delete_textures(1, &albedoSpec_);
+    gl_state().delete_textures(1, &normal_);
+    gl_state().delete_textures(1, &depth_);
+    gl_state().delete_vertex_arrays(1, &emptyVao_);
+    gl_state().delete_vertex_arrays(1, &volumeVao_);
+    gl_state().delete_buffers(1, &volumeVbo_);
+    gl_state().delete_buffers(1, &volumeEbo_);
+    gl_state().delete_buffers(1, &lightBuffer_);
+    gl_state().delete_textures(1, &lightTexture_);
+    glDeleteProgram(ambientPass_.id_);
+    glDeleteProgram(pointPass_.id_);
+}
@@ -0,0 +1,286 @@
+#include "gl_state.h"
+
+namespace {
+// 需要影子的 target 映射到数组下标，-1 表示不跟踪，直接交给驱动
+int texture_index(GLenum target)
+{
+    switch (target) {
+        case GL_TEXTURE_2D: return 0;
+        case GL_TEXTURE_2D_ARRAY: return 1;
+        case GL_TEXTURE_BUFFER: return 2;
+        case GL_TEXTURE_CUBE_MAP: return 3;
+        default: return -1;
+    }
+}
+
+int buffer_index(GLenum target)
+{
+    switch (target) {
+        case GL_ARRAY_BUFFER: return 0;
+        case GL_ELEMENT_ARRAY_BUFFER: return 1;
+        case GL_UNIFORM_BUFFER: return 2;
+        case GL_TEXTURE_BUFFER: return 3;
+        case GL_PIXEL_UNPACK_BUFFER: return 4;
+        case GL_COPY_WRITE_BUFFER: return 5;
+        default: return -1;
+    }
+}
+
+int capability_index(GLenum capability)
+{
+    switch (capability) {
+        case GL_DEPTH_TEST: return 0;
+        case GL_BLEND: return 1;
+        case GL_CULL_FACE: return 2;
+        case GL_STENCIL_TEST: return 3;
+        case GL_SCISSOR_TEST: return 4;
+        default: return -1;
+    }
+}
+}  // namespace
+
+GLState::GLState()
+{
+    invalidate();
+}
+
+bool GLState::update(uint32_t &shadow, uint32_t value)
+{
+    if (shadow == value) {
+        frame_.filtered++;
+        return false;
+    }
+    shadow = value;
+    frame_.issued++;
+    return true;
+}
+
+void GLState::use_program(uint32_t program)
+{
+    if (update(program_, program)) glUseProgram(program);
+}
+
+void GLState::bind_vertex_array(uint32_t vao)
+{
+    if (!update(vertexArray_, vao)) return;
+    glBindVertexArray(vao);
+    buffers_[buffer_index(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+}
+
+void GLState::bind_buffer(GLenum target, uint32_t buffer)
+{
+    int index = buffer_index(target);
+    if (index < 0) {
+        frame_.issued++;
+        glBindBuffer(target, buffer);
+        return;
+    }
+    if (update(buffers_[index], buffer)) glBindBuffer(target, buffer);
+}
+
+void GLState::bind_buffer_base(GLenum target, uint32_t index, uint32_t buffer)
+{
+    int generic = buffer_index(target);
+    if (target != GL_UNIFORM_BUFFER || index >= UNIFORM_BINDINGS) {
+        frame_.issued++;
+        glBindBufferBase(target, index, buffer);
+        if (generic >= 0) buffers_[generic] = buffer;
+        return;
+    }
+    if (!update(uniformBindings_[index], buffer)) return;
+    glBindBufferBase(target, index, buffer);
+    buffers_[generic] = buffer;
+}
+
+void GLState::bind_texture(uint32_t unit, GLenum target, uint32_t texture)
+{
+    int index = texture_index(target);
+    if (index < 0 || unit >= MAX_UNITS) {
+        frame_.issued += 2;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        // 超出范围的 unit 不跟踪，之后的 edit_texture 也不能依赖影子
+        activeUnit_ = unit < MAX_UNITS ? unit : UNKNOWN;
+        return;
+    }
+    if (textures_[unit][index] == texture) {
+        frame_.filtered++;
+        return;
+    }
+    if (update(activeUnit_, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+    update(textures_[unit][index], texture);
+    glBindTexture(target, texture);
+}
+
+void GLState::edit_texture(GLenum target, uint32_t texture)
+{
+    int index = texture_index(target);
+    if (index < 0 || activeUnit_ >= MAX_UNITS) {
+        frame_.issued++;
+        glBindTexture(target, texture);
+        return;
+    }
+    if (update(textures_[activeUnit_][index], texture)) glBindTexture(target, texture);
+}
+
+void GLState::bind_framebuffer(GLenum target, uint32_t framebuffer)
+{
+    bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    if ((!draw || drawFramebuffer_ == framebuffer) && (!read || readFramebuffer_ == framebuffer)) {
+        frame_.filtered++;
+        return;
+    }
+    if (draw) drawFramebuffer_ = framebuffer;
+    if (read) readFramebuffer_ = framebuffer;
+    frame_.issued++;
+    glBindFramebuffer(target, framebuffer);
+}
+
+void GLState::set_capability(GLenum capability, bool enabled)
+{
+    int index = capability_index(capability);
+    if (index >= 0 && !update(capabilities_[index], enabled ? 1 : 0)) return;
+    if (index < 0) frame_.issued++;
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void GLState::enable(GLenum capability)
+{
+    set_capability(capability, true);
+}
+
+void GLState::disable(GLenum capability)
+{
+    set_capability(capability, false);
+}
+
+void GLState::blend_func(GLenum source, GLenum destination)
+{
+    if (blendSource_ == source && blendDestination_ == destination) {
+        frame_.filtered++;
+        return;
+    }
+    blendSource_ = source;
+    blendDestination_ = destination;
+    frame_.issued++;
+    glBlendFunc(source, destination);
+}
+
+void GLState::cull_face(GLenum mode)
+{
+    if (update(cullFace_, mode)) glCullFace(mode);
+}
+
+void GLState::depth_mask(bool enabled)
+{
+    if (update(depthMask_, enabled ? 1 : 0)) glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void GLState::viewport(int32_t x, int32_t y, int32_t width, int32_t height)
+{
+    if (viewportKnown_ && viewport_[0] == x && viewport_[1] == y && viewport_[2] == width &&
+        viewport_[3] == height) {
+        frame_.filtered++;
+        return;
+    }
+    viewport_[0] = x;
+    viewport_[1] = y;
+    viewport_[2] = width;
+    viewport_[3] = height;
+    viewportKnown_ = true;
+    frame_.issued++;
+    glViewport(x, y, width, height);
+}
+
+void GLState::delete_textures(int32_t count, const uint32_t *textures)
+{
+    for (int32_t i = 0; i < count; i++) {
+        for (auto &unit : textures_) {
+            for (uint32_t &bound : unit) {
+                if (bound == textures[i]) bound = 0;
+            }
+        }
+    }
+    glDeleteTextures(count, textures);
+}
+
+void GLState::delete_buffers(int32_t count, const uint32_t *buffers)
+{
+    for (int32_t i = 0; i < count; i++) {
+        for (uint32_t &bound : buffers_) {
+            if (bound == buffers[i]) bound = 0;
+        }
+        for (uint32_t &bound : uniformBindings_) {
+            if (bound == buffers[i]) bound = 0;
+        }
+    }
+    glDeleteBuffers(count, buffers);
+}
+
+void GLState::delete_vertex_arrays(int32_t count, const uint32_t *vertexArrays)
+{
+    for (int32_t i = 0; i < count; i++) {
+        if (vertexArrays[i] == 0 || vertexArray_ != vertexArrays[i]) continue;
+        vertexArray_ = 0;
+        // 回到 VAO 0，它的 ELEMENT_ARRAY_BUFFER 绑定不知道
+        buffers_[buffer_index(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+    }
+    glDeleteVertexArrays(count, vertexArrays);
+}
+
+void GLState::delete_framebuffers(int32_t count, const uint32_t *framebuffers)
+{
+    for (int32_t i = 0; i < count; i++) {
+        if (framebuffers[i] == 0) continue;
+        if (drawFramebuffer_ == framebuffers[i]) drawFramebuffer_ = 0;
+        if (readFramebuffer_ == framebuffers[i]) readFramebuffer_ = 0;
+    }
+    glDeleteFramebuffers(count, framebuffers);
+}
+
+void GLState::invalidate()
+{
+    program_ = UNKNOWN;
+    vertexArray_ = UNKNOWN;
+    for (uint32_t &buffer : buffers_) buffer = UNKNOWN;
+    for (uint32_t &buffer : uniformBindings_) buffer = UNKNOWN;
+    activeUnit_ = UNKNOWN;
+    for (auto &unit : textures_) {
+        for (uint32_t &texture : unit) texture = UNKNOWN;
+    }
+    drawFramebuffer_ = UNKNOWN;
+    readFramebuffer_ = UNKNOWN;
+    for (uint32_t &capability : capabilities_) capability = UNKNOWN;
+    blendSource_ = UNKNOWN;
+    blendDestination_ = UNKNOWN;
+    cullFace_ = UNKNOWN;
+    depthMask_ = UNKNOWN;
+    viewportKnown_ = false;
+}
+
+void GLState::end_frame()
+{
+    lastFrame_ = frame_;
+    frame_ = {};
+}
+
+GLState &gl_state()
+{
+    static GLState state;
+    return state;
+}
+
+bool has_extension(std::string_view name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension != nullptr && name == extension) return true;
+    }
+    return false;
+}
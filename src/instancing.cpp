@@ -0,0 +1,179 @@
+#include "instancing.h"
+
+#include <cmath>
+#include <random>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define INSTANCING_SSE 1
+#endif
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "geometry.h"
+#include "gl_state.h"
+
+namespace {
+// 左上 3x3 的逆转置等于伴随矩阵的转置除以行列式：
+// 记 model 前三列为 a, b, c，则法线矩阵的三列依次为 b×c, c×a, a×b，再除以 det = a·(b×c)
+void normal_matrix(const glm::mat4 &model, glm::vec4 *normal)
+{
+    glm::vec3 a(model[0]), b(model[1]), c(model[2]);
+    glm::vec3 bc = glm::cross(b, c), ca = glm::cross(c, a), ab = glm::cross(a, b);
+    float invDet = 1.0f / glm::dot(a, bc);
+    normal[0] = glm::vec4(bc * invDet, 0.0f);
+    normal[1] = glm::vec4(ca * invDet, 0.0f);
+    normal[2] = glm::vec4(ab * invDet, 0.0f);
+}
+
+#ifdef INSTANCING_SSE
+// 4 个矩阵同一列的 x/y/z 分量，转置成 SoA 后叉积与点积都只需逐分量乘加
+struct Column4 {
+    __m128 x, y, z;
+};
+
+Column4 load_column(const glm::mat4 *models, int column)
+{
+    __m128 m0 = _mm_loadu_ps(&models[0][column][0]);
+    __m128 m1 = _mm_loadu_ps(&models[1][column][0]);
+    __m128 m2 = _mm_loadu_ps(&models[2][column][0]);
+    __m128 m3 = _mm_loadu_ps(&models[3][column][0]);
+    _MM_TRANSPOSE4_PS(m0, m1, m2, m3);
+    return {m0, m1, m2};
+}
+
+Column4 cross4(const Column4 &u, const Column4 &v)
+{
+    return {_mm_sub_ps(_mm_mul_ps(u.y, v.z), _mm_mul_ps(u.z, v.y)),
+            _mm_sub_ps(_mm_mul_ps(u.z, v.x), _mm_mul_ps(u.x, v.z)),
+            _mm_sub_ps(_mm_mul_ps(u.x, v.y), _mm_mul_ps(u.y, v.x))};
+}
+
+// 乘上 1/det 后转置回 AoS，写入 4 个实例的同一列
+void store_column(const Column4 &n, __m128 invDet, InstanceData *instances, int column)
+{
+    __m128 x = _mm_mul_ps(n.x, invDet);
+    __m128 y = _mm_mul_ps(n.y, invDet);
+    __m128 z = _mm_mul_ps(n.z, invDet);
+    __m128 w = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_store_ps(&instances[0].normal[column][0], x);
+    _mm_store_ps(&instances[1].normal[column][0], y);
+    _mm_store_ps(&instances[2].normal[column][0], z);
+    _mm_store_ps(&instances[3].normal[column][0], w);
+}
+#endif
+}  // namespace
+
+void build_instances(const glm::mat4 *models, size_t count, TransformKind kind,
+                     InstanceData *instances)
+{
+    for (size_t i = 0; i < count; i++) instances[i].model = models[i];
+
+    if (kind == TransformKind::UniformScale) {
+        // 着色器会对插值后的法线 normalize，等比缩放带来的常数倍不影响结果，省掉求逆
+        for (size_t i = 0; i < count; i++) {
+            for (int c = 0; c < 3; c++) instances[i].normal[c] = models[i][c];
+        }
+        return;
+    }
+
+    size_t i = 0;
+#ifdef INSTANCING_SSE
+    for (; i + 4 <= count; i += 4) {
+        Column4 a = load_column(models + i, 0);
+        Column4 b = load_column(models + i, 1);
+        Column4 c = load_column(models + i, 2);
+        Column4 bc = cross4(b, c);
+        Column4 ca = cross4(c, a);
+        Column4 ab = cross4(a, b);
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, bc.x), _mm_mul_ps(a.y, bc.y)),
+                                _mm_mul_ps(a.z, bc.z));
+        __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+        store_column(bc, invDet, instances + i, 0);
+        store_column(ca, invDet, instances + i, 1);
+        store_column(ab, invDet, instances + i, 2);
+    }
+#endif
+    for (; i < count; i++) normal_matrix(models[i], instances[i].normal);
+}
+
+void build_instances_scalar(const glm::mat4 *models, size_t count, InstanceData *instances)
+{
+    for (size_t i = 0; i < count; i++) {
+        instances[i].model = models[i];
+        glm::mat3 normal = glm::transpose(glm::inverse(glm::mat3(models[i])));
+        for (int c = 0; c < 3; c++) instances[i].normal[c] = glm::vec4(normal[c], 0.0f);
+    }
+}
+
+InstanceBuffer::InstanceBuffer()
+{
+    glGenBuffers(1, &id_);
+}
+
+void InstanceBuffer::attach(uint32_t vao) const
+{
+    gl_state().bind_vertex_array(vao);
+    gl_state().bind_buffer(GL_ARRAY_BUFFER, id_);
+    // mat4 属性按列拆成 4 个 vec4
+    for (uint32_t i = 0; i < 4; i++) {
+        glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + i);
+        glVertexAttribPointer(INSTANCE_MODEL_LOCATION + i, 4, GL_FLOAT, GL_FALSE,
+                              sizeof(InstanceData), (void *)(i * sizeof(glm::vec4)));
+        glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + i, 1);
+    }
+    // mat3 属性同样按列拆开，每列只取补齐后 vec4 的前 3 个分量
+    for (uint32_t i = 0; i < 3; i++) {
+        glEnableVertexAttribArray(INSTANCE_NORMAL_LOCATION + i);
+        glVertexAttribPointer(INSTANCE_NORMAL_LOCATION + i, 3, GL_FLOAT, GL_FALSE,
+                              sizeof(InstanceData),
+                              (void *)(offsetof(InstanceData, normal) + i * sizeof(glm::vec4)));
+        glVertexAttribDivisor(INSTANCE_NORMAL_LOCATION + i, 1);
+    }
+    gl_state().bind_vertex_array(0);
+}
+
+void InstanceBuffer::upload(const glm::mat4 *models, size_t count, TransformKind kind)
+{
+    staging_.resize(count);
+    build_instances(models, count, kind, staging_.data());
+
+    gl_state().bind_buffer(GL_ARRAY_BUFFER, id_);
+    if (count > capacity_) {
+        capacity_ = count;
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(InstanceData), staging_.data(),
+                     GL_DYNAMIC_DRAW);
+    } else if (count > 0) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), staging_.data());
+    }
+    count_ = count;
+}
+
+glm::mat4 cube_model(uint32_t i)
+{
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), CUBE_POSITIONS[i % CUBE_POSITION_COUNT]);
+    return glm::rotate(model, glm::radians(20.0f * i), glm::vec3(1.0f, 0.3f, 0.5f));
+}
+
+std::vector<glm::mat4> cube_field(uint32_t count, float spacing, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+    std::uniform_real_distribution<float> axis(-1.0f, 1.0f);
+
+    // 尽量接近立方体的网格，side^3 >= count
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(count))));
+    float half = (side - 1) * spacing * 0.5f;
+    std::vector<glm::mat4> models;
+    models.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        glm::vec3 position(i % side, (i / side) % side, i / (side * side));
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), position * spacing - glm::vec3(half));
+        glm::vec3 rotationAxis(axis(rng), axis(rng), axis(rng));
+        if (glm::dot(rotationAxis, rotationAxis) < 1e-4f) rotationAxis = glm::vec3(0, 1, 0);
+        models.push_back(
+            glm::rotate(model, glm::radians(angle(rng)), glm::normalize(rotationAxis)));
+    }
+    return models;
+}
@@ -0,0 +1,102 @@
+#include "lighting.h"
+
+#include <algorithm>
+#include <random>
+
+#include "gl_state.h"
+
+float point_light_radius(const PointLight &light, float threshold)
+{
+    // 解 brightest / (constant + linear * d + quadratic * d^2) = threshold
+    float brightest = std::max({light.diffuse.x, light.diffuse.y, light.diffuse.z,
+                                light.specular.x, light.specular.y, light.specular.z});
+    float c = light.constant - brightest / threshold;
+    if (light.quadratic <= 0.0f) return light.linear > 0.0f ? -c / light.linear : 1e30f;
+    return (-light.linear + std::sqrt(light.linear * light.linear - 4.0f * light.quadratic * c)) /
+           (2.0f * light.quadratic);
+}
+
+std::vector<PointLight> random_point_lights(uint32_t count, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> x(-6.0f, 6.0f);
+    std::uniform_real_distribution<float> y(-4.0f, 6.0f);
+    std::uniform_real_distribution<float> z(-16.0f, 3.0f);
+    std::uniform_real_distribution<float> color(0.2f, 1.0f);
+
+    // 灯越多单个灯的影响范围越小，使场景中任一点平均被差不多数量的灯照到
+    float radius = std::clamp(2.5f * std::cbrt(64.0f / std::max(count, 1u)), 0.5f, 2.5f);
+
+    std::vector<PointLight> lights(count);
+    for (PointLight &light : lights) {
+        light.position = glm::vec3(x(rng), y(rng), z(rng));
+        light.diffuse = glm::vec3(color(rng), color(rng), color(rng));
+        light.ambient = light.diffuse * 0.02f;
+        light.specular = light.diffuse;
+        // 反推衰减系数，使 point_light_radius() 恰好等于 radius
+        float brightest = std::max({light.diffuse.x, light.diffuse.y, light.diffuse.z});
+        light.constant = 1.0f;
+        light.linear = 0.0f;
+        light.quadratic = (brightest / LIGHT_CUTOFF - 1.0f) / (radius * radius);
+        light.radius = point_light_radius(light);
+    }
+    return lights;
+}
+
+LightBlock scene_light_block(const glm::vec3 *pointLightPositions)
+{
+    LightBlock block {};
+    // directional light
+    block.dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+    block.dirLight.ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+    block.dirLight.diffuse = glm::vec3(0.4f, 0.4f, 0.4f);
+    block.dirLight.specular = glm::vec3(0.5f, 0.5f, 0.5f);
+    // point lights
+    for (uint32_t i = 0; i < NR_POINT_LIGHTS; i++) {
+        PointLight &light = block.pointLights[i];
+        light.position = pointLightPositions[i];
+        light.ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+        light.diffuse = glm::vec3(0.8f, 0.8f, 0.8f);
+        light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+        light.constant = 1.0f;
+        light.linear = 0.09f;
+        light.quadratic = 0.032f;
+        light.radius = point_light_radius(light);
+    }
+    // spotLight, position/direction follow the camera
+    block.spotLight.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
+    block.spotLight.diffuse = glm::vec3(1.0f, 1.0f, 1.0f);
+    block.spotLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+    block.spotLight.constant = 1.0f;
+    block.spotLight.linear = 0.09f;
+    block.spotLight.quadratic = 0.032f;
+    block.spotLight.cutOff = glm::cos(glm::radians(12.5f));
+    block.spotLight.outerCutOff = glm::cos(glm::radians(15.0f));
+    return block;
+}
+
+LightingBuffer::LightingBuffer()
+{
+    glGenBuffers(1, &id_);
+    gl_state().bind_buffer(GL_UNIFORM_BUFFER, id_);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(LightBlock), NULL, GL_DYNAMIC_DRAW);
+    gl_state().bind_buffer(GL_UNIFORM_BUFFER, 0);
+    // 绑定一次即可，之后每个 program 只需把自己的 block index 指向这个绑定点
+    gl_state().bind_buffer_base(GL_UNIFORM_BUFFER, LIGHTING_BINDING, id_);
+}
+
+void LightingBuffer::attach(const Shader &shader) const
+{
+    uint32_t blockIndex = glGetUniformBlockIndex(shader.id_, "Lighting");
+    if (blockIndex == GL_INVALID_INDEX) {
+        std::cout << "ERROR::LIGHTING::BLOCK_NOT_FOUND in program " << shader.id_ << std::endl;
+        return;
+    }
+    glUniformBlockBinding(shader.id_, blockIndex, LIGHTING_BINDING);
+}
+
+void LightingBuffer::upload(const LightBlock &block) const
+{
+    gl_state().bind_buffer(GL_UNIFORM_BUFFER, id_);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LightBlock), &block);
+}
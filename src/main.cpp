@@ -4,8 +4,13 @@
 
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "shader.h"
 #define STB_IMAGE_IMPLEMENTATION
@@ -13,8 +18,23 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "bench.h"
 #include "camera.h"
+#include "cluster.h"
+#include "deferred.h"
+#include "geometry.h"
+#include "gl_state.h"
+#include "instancing.h"
+#include "lighting.h"
+#include "mesh.h"
+#include "mesh_cache.h"
+#include "program_cache.h"
+#include "render_queue.h"
+#include "shader_watcher.h"
 #include "stb_image.h"
+#include "texture_bake.h"
+#include "texture_cache.h"
+#include "texture_loader.h"
 
 // settings
 constexpr uint32_t SCR_WIDTH = 800;
@@ -83,38 +103,7 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 {
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
-}
-
-uint32_t loadTexture(char const *path)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data) {
-        GLenum format;
-        if (nrComponents == 1) format = GL_RED;
-        else if (nrComponents == 3) format = GL_RGB;
-        else if (nrComponents == 4) format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    } else {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    gl_state().viewport(0, 0, width, height);
 }
 
 void triagnle()
@@ -391,6 +380,7 @@ void shader()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return;
     }
+    gl_state().invalidate();
 
     // const char *fragmentShaderSourceUniform =
     //     "#version 330 core\n"
@@ -418,8 +408,8 @@ void shader()
     glGenVertexArrays(1, &Vao);
     glGenBuffers(1, &Vbo);
     glGenBuffers(1, &Ebo);
-    glBindVertexArray(Vao);
-    glBindBuffer(GL_ARRAY_BUFFER, Vbo);
+    gl_state().bind_vertex_array(Vao);
+    gl_state().bind_buffer(GL_ARRAY_BUFFER, Vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
@@ -427,11 +417,11 @@ void shader()
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Ebo);
+    gl_state().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, Ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    gl_state().bind_buffer(GL_ARRAY_BUFFER, 0);
+    gl_state().bind_vertex_array(0);
 
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
@@ -448,16 +438,16 @@ void shader()
         // int vertexColorLocation = glGetUniformLocation(shaderProgram, "ourColor");
         // 但更新 uniform 的值时，要求先 调用 glUseProgram 使用 shader program
         // glUniform4f(vertexColorLocation, 0.0f, greenValue, 0.0f, 1.0f);
-        glBindVertexArray(Vao);
+        gl_state().bind_vertex_array(Vao);
         glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0);
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
-    glDeleteVertexArrays(1, &Vao);
-    glDeleteBuffers(1, &Vbo);
-    glDeleteBuffers(1, &Ebo);
+    gl_state().delete_vertex_arrays(1, &Vao);
+    gl_state().delete_buffers(1, &Vbo);
+    gl_state().delete_buffers(1, &Ebo);
     // glDeleteProgram(shaderProgram);
 
     glfwTerminate();
@@ -483,53 +473,21 @@ void texture()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return;
     }
-
-    // 生成纹理 id
-    uint32_t texture1;
-    glGenTextures(1, &texture1);
-    // 在绑定纹理之前先激活纹理单元，
-    glActiveTexture(GL_TEXTURE0);  // 纹理单元 0 是默认激活的
-    // 绑定纹理
-    glBindTexture(GL_TEXTURE_2D, texture1);
-    // 为当前绑定的纹理对象设置环绕、过滤方式
-    // S 是竖直的 y 轴，T 是横向的 x 轴
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // 加载并生成纹理
-    int width, height, nrChannels;
-    unsigned char *data = stbi_load("./texture/container.jpg", &width, &height, &nrChannels, 0);
-    if (data == nullptr) {
-        std::cout << "load texture1 fail" << std::endl;
-        return;
-    }
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    // 生成 mipmap
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
-
-    uint32_t texture2;
-    glGenTextures(1, &texture2);
-    // 在绑定纹理之前先激活纹理单元，
-    glActiveTexture(GL_TEXTURE1);
-    // 绑定纹理
-    glBindTexture(GL_TEXTURE_2D, texture2);
-    // 为当前绑定的纹理对象设置环绕、过滤方式
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // 加载并生成纹理
-    stbi_set_flip_vertically_on_load(true);  // 设置加载图片时翻转一下 y 轴
-    data = stbi_load("./texture/awesomeface.png", &width, &height, &nrChannels, 0);
-    if (data == nullptr) {
-        std::cout << "load texture2 fail" << std::endl;
-        return;
-    }
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
+    gl_state().invalidate();
+
+    // 纹理的解码在工作线程上进行，load 立即返回纹理 id，图像就绪前先显示占位像素
+    // 环绕、过滤方式由 TextureOptions 设置；S 是竖直的 y 轴，T 是横向的 x 轴
+    TextureLoader textureLoader;
+    // 同一文件 (按路径或按内容) 只解码上传一次，之后的请求共享同一个纹理名
+    TextureCache textureCache(textureLoader);
+    TextureOptions options;
+    options.minFilter = GL_LINEAR;
+    uint32_t texture1 = textureCache.acquire("./texture/container.jpg", options);
+    options.flipVertically = true;  // 加载图片时翻转一下 y 轴
+    uint32_t texture2 = textureCache.acquire("./texture/awesomeface.png", options);
+    // 在绑定纹理之前先激活纹理单元 (纹理单元 0 是默认激活的)，bind_texture 会按需切换
+    gl_state().bind_texture(0, GL_TEXTURE_2D, texture1);
+    gl_state().bind_texture(1, GL_TEXTURE_2D, texture2);
 
     Shader shader("./shader/texture_shader.vs", "./shader/texture_shader.fs");
     shader.use();  // 设置 uniform 变量之前需要先激活着色器程序！
@@ -554,8 +512,8 @@ void texture()
     glGenVertexArrays(1, &Vao);
     glGenBuffers(1, &Vbo);
     glGenBuffers(1, &Ebo);
-    glBindVertexArray(Vao);
-    glBindBuffer(GL_ARRAY_BUFFER, Vbo);
+    gl_state().bind_vertex_array(Vao);
+    gl_state().bind_buffer(GL_ARRAY_BUFFER, Vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
@@ -565,11 +523,11 @@ void texture()
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Ebo);
+    gl_state().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, Ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    gl_state().bind_buffer(GL_ARRAY_BUFFER, 0);
+    gl_state().bind_vertex_array(0);
 
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
@@ -579,17 +537,22 @@ void texture()
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
+        // 上传已经解码好的纹理
+        textureLoader.update();
+
         shader.use();
-        glBindVertexArray(Vao);
+        gl_state().bind_vertex_array(Vao);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
-    glDeleteVertexArrays(1, &Vao);
-    glDeleteBuffers(1, &Vbo);
-    glDeleteBuffers(1, &Ebo);
+    gl_state().delete_vertex_arrays(1, &Vao);
+    gl_state().delete_buffers(1, &Vbo);
+    gl_state().delete_buffers(1, &Ebo);
+    textureCache.clear();
+    textureLoader.release();
 
     glfwTerminate();
 }
@@ -623,12 +586,13 @@ void coordinate()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return;
     }
+    gl_state().invalidate();
 
     /*
      * 设置开启深度测试
      */
     // configure global opengl state
-    glEnable(GL_DEPTH_TEST);
+    gl_state().enable(GL_DEPTH_TEST);
 
     /*
      * vertex data: x,y,z,u,v;
@@ -663,73 +627,22 @@ void coordinate()
                                  glm::vec3(1.3f, -2.0f, -2.5f),  glm::vec3(1.5f, 2.0f, -2.5f),
                                  glm::vec3(1.5f, 0.2f, -1.5f),   glm::vec3(-1.3f, 1.0f, -1.5f)};
     /*
-     * 绑定 VBO VAO
+     * 焊接重复的顶点后建立 VBO/EBO/VAO：36 个展开的顶点只剩 16 个，glDrawElements 绘制
+     * location 0 为 position，location 1 为 texture coord
      */
-    unsigned int VBO, Vao;
-    glGenVertexArrays(1, &Vao);
-    glGenBuffers(1, &VBO);
-
-    glBindVertexArray(Vao);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    /*
-     * 指定 location 以及 vertex 解读方式
-     */
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
-    // texture coord attribute
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    glBindVertexArray(0);
+    Mesh cube(weld_vertices(vertices, 36, 5), {3, 2});
     /*
      * 加载 texture
      */
-    unsigned int texture1, texture2;
-    // texture 1
-    glGenTextures(1, &texture1);
-    glBindTexture(GL_TEXTURE_2D, texture1);
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // load image, create texture and generate mipmaps
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(
-        true);  // tell stb_image.h to flip loaded texture's on the y-axis.
-    unsigned char *data = stbi_load("./texture/container.jpg", &width, &height, &nrChannels, 0);
-    if (data == nullptr) {
-        std::cout << "Failed to load texture1" << std::endl;
-        return;
-    }
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
-    // texture 2
-    glGenTextures(1, &texture2);
-    glBindTexture(GL_TEXTURE_2D, texture2);
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // load image, create texture and generate mipmaps
-    data = stbi_load("./texture/awesomeface.png", &width, &height, &nrChannels, 0);
-    if (data == nullptr) {
-        std::cout << "Failed to load texture2" << std::endl;
-        return;
-    }
-    // note that the awesomeface.png has transparency and thus an alpha channel, so make sure to
-    // tell OpenGL the data type is of GL_RGBA
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
+    // decoded on worker threads; both ids are valid right away and show a placeholder pixel
+    // until their image has been uploaded
+    TextureLoader textureLoader;
+    TextureCache textureCache(textureLoader);
+    TextureOptions options;
+    options.minFilter = GL_LINEAR;
+    options.flipVertically = true;  // tell stb_image.h to flip loaded texture's on the y-axis.
+    unsigned int texture1 = textureCache.acquire("./texture/container.jpg", options);
+    unsigned int texture2 = textureCache.acquire("./texture/awesomeface.png", options);
 
     /*
      * 设置 texture 的纹理单元 location
@@ -741,6 +654,19 @@ void coordinate()
     shader.set_int("texture1", 0);
     shader.set_int("texture2", 1);
 
+    // 每个箱子的 model 矩阵作为实例属性，只需上传一次
+    InstanceBuffer instances;
+    instances.attach(cube.vao_);
+    std::vector<glm::mat4> models;
+    for (unsigned int i = 0; i < 10; i++) {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, cubePositions[i]);
+        float angle = 20.0f * i;
+        model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+        models.push_back(model);
+    }
+    instances.upload(models, TransformKind::UniformScale);
+
     // render loop
     while (!glfwWindowShouldClose(window)) {
         // input
@@ -751,11 +677,10 @@ void coordinate()
         // 清除颜色缓冲与深度缓冲
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);  // also clear the depth buffer now!
 
+        textureLoader.update();
         // bind textures on corresponding texture units
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture2);
+        gl_state().bind_texture(0, GL_TEXTURE_2D, texture1);
+        gl_state().bind_texture(1, GL_TEXTURE_2D, texture2);
 
         // activate shader
         shader.use();
@@ -774,17 +699,8 @@ void coordinate()
         shader.set_mat4("view", view);
 
         // render boxes
-        glBindVertexArray(Vao);
-        for (unsigned int i = 0; i < 10; i++) {
-            // calculate the model matrix for each object and pass it to shader before drawing
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-            float angle = 20.0f * i;
-            model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-            shader.set_mat4("model", model);
-
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-        }
+        // 10 个箱子的 model 矩阵不随帧变化，已在循环外上传，一次实例化绘制即可
+        cube.draw(instances.count());
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         glfwSwapBuffers(window);
@@ -793,8 +709,10 @@ void coordinate()
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
-    glDeleteVertexArrays(1, &Vao);
-    glDeleteBuffers(1, &VBO);
+    cube.release();
+    gl_state().delete_buffers(1, &instances.id_);
+    textureCache.clear();
+    textureLoader.release();
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -827,8 +745,9 @@ void camera_move()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return;
     }
+    gl_state().invalidate();
 
-    glEnable(GL_DEPTH_TEST);
+    gl_state().enable(GL_DEPTH_TEST);
 
     float vertices[] = {-0.5f, -0.5f, -0.5f, 0.0f, 0.0f, 0.5f,  -0.5f, -0.5f, 1.0f, 0.0f,
                         0.5f,  0.5f,  -0.5f, 1.0f, 1.0f, 0.5f,  0.5f,  -0.5f, 1.0f, 1.0f,
@@ -859,54 +778,34 @@ void camera_move()
                                  glm::vec3(2.4f, -0.4f, -3.5f),  glm::vec3(-1.7f, 3.0f, -7.5f),
                                  glm::vec3(1.3f, -2.0f, -2.5f),  glm::vec3(1.5f, 2.0f, -2.5f),
                                  glm::vec3(1.5f, 0.2f, -1.5f),   glm::vec3(-1.3f, 1.0f, -1.5f)};
-    unsigned int VBO, VAO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
-    // texture coord attribute
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    // welded into 16 unique vertices + 36 uint16 indices: position (location 0), uv (location 1)
+    Mesh cube(weld_vertices(vertices, 36, 5), {3, 2});
 
-    unsigned int texture1, texture2;
-    glGenTextures(1, &texture1);
-    glBindTexture(GL_TEXTURE_2D, texture1);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true);
-    unsigned char *data = stbi_load("./texture/container.jpg", &width, &height, &nrChannels, 0);
-    if (data == nullptr) std::cout << "Failed to load texture1" << std::endl;
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
-
-    glGenTextures(1, &texture2);
-    glBindTexture(GL_TEXTURE_2D, texture2);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    data = stbi_load("./texture/awesomeface.png", &width, &height, &nrChannels, 0);
-    if (data == nullptr) std::cout << "Failed to load texture2" << std::endl;
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
+    TextureLoader textureLoader;
+    TextureCache textureCache(textureLoader);
+    TextureOptions options;
+    options.minFilter = GL_LINEAR;
+    options.flipVertically = true;
+    unsigned int texture1 = textureCache.acquire("./texture/container.jpg", options);
+    unsigned int texture2 = textureCache.acquire("./texture/awesomeface.png", options);
 
     Shader shader("./shader/coordinate.vs", "./shader/coordinate.fs");
     shader.use();
     shader.set_int("texture1", 0);
     shader.set_int("texture2", 1);
 
+    InstanceBuffer instances;
+    instances.attach(cube.vao_);
+    std::vector<glm::mat4> models;
+    for (unsigned int i = 0; i < 10; i++) {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, cubePositions[i]);
+        float angle = 20.0f * i;
+        model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+        models.push_back(model);
+    }
+    instances.upload(models, TransformKind::UniformScale);
+
     while (!glfwWindowShouldClose(window)) {
         float currentFrame = static_cast<float>(glfwGetTime());
         deltaTime = currentFrame - lastFrame;
@@ -917,10 +816,9 @@ void camera_move()
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture2);
+        textureLoader.update();
+        gl_state().bind_texture(0, GL_TEXTURE_2D, texture1);
+        gl_state().bind_texture(1, GL_TEXTURE_2D, texture2);
 
         shader.use();
 
@@ -932,28 +830,23 @@ void camera_move()
         glm::mat4 view = glm::lookAt(camera.Position, camera.Position + camera.Front, camera.Up);
         shader.set_mat4("view", view);
 
-        glBindVertexArray(VAO);
-        for (unsigned int i = 0; i < 10; i++) {
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-            float angle = 20.0f * i;
-            model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-            shader.set_mat4("model", model);
-
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-        }
+        cube.draw(instances.count());
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    cube.release();
+    gl_state().delete_buffers(1, &instances.id_);
+    textureCache.clear();
+    textureLoader.release();
     glfwTerminate();
     return;
 }
 
-void light()
+// path 为 Deferred 时，箱子先写入 G-buffer，再由全屏 pass 与点光源光体积完成光照
+// meshPath 非空时以导入的 OBJ/glTF 模型代替箱子，首次运行后改为映射旁边的 .lmesh，见 mesh_cache.h
+void light(RenderPath path = RenderPath::Forward, const std::string &meshPath = "")
 {
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -977,10 +870,19 @@ void light()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return;
     }
-
-    glEnable(GL_DEPTH_TEST);
-
-    Shader lightingShader("./shader/light.vs", "./shader/light.fs");
+    gl_state().invalidate();
+
+    gl_state().enable(GL_DEPTH_TEST);
+
+    // submit every compile up front so the driver works on them while we load textures;
+    // the lamp program is tiny and built synchronously, it doubles as the fallback that
+    // draws the containers flat until the lighting program is ready
+    Shader::enable_parallel_compile((GLADloadproc)glfwGetProcAddress);
+    // only the program the chosen path draws the containers with: forward lighting, or the
+    // G-buffer fill for the deferred path
+    Shader sceneShader("./shader/light.vs",
+                       path == RenderPath::Deferred ? "./shader/gbuffer.fs" : "./shader/light.fs",
+                       BuildMode::Async);
     Shader lightCubeShader("./shader/light_cube.vs", "./shader/light_cube.fs");
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
@@ -1026,43 +928,117 @@ void light()
     glm::vec3 pointLightPositions[] = {glm::vec3(0.7f, 0.2f, 2.0f), glm::vec3(2.3f, -3.3f, -4.0f),
                                        glm::vec3(-4.0f, 2.0f, -12.0f),
                                        glm::vec3(0.0f, 0.0f, -3.0f)};
-    // first, configure the cube's VAO (and VBO)
-    unsigned int VBO, cubeVAO;
-    glGenVertexArrays(1, &cubeVAO);
-    glGenBuffers(1, &VBO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glBindVertexArray(cubeVAO);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    // first, weld the cube into an indexed mesh: 24 unique vertices + 36 uint16 indices,
+    // 16 bytes per vertex instead of 32 (half position, 2_10_10_10 normal, unorm16 uv)
+    Mesh cube(weld_vertices(vertices, 36, 8), VERTEX_LAYOUT_COMPACT16);
+    // an imported model takes the containers' place. the first run parses and optimises it and
+    // writes a .lmesh cache next to it, later runs map that and upload it as is. it stays in
+    // float: imported texture coordinates often tile outside the [0, 1] that unorm16 can hold
+    std::optional<Mesh> imported;
+    glm::mat4 importedFit = glm::mat4(1.0f);
+    MeshCache meshCache;
+    if (!meshPath.empty() && open_mesh_cache(meshPath, VERTEX_LAYOUT_FLOAT, meshCache)) {
+        imported.emplace(meshCache.create_mesh());
+        // the cached bounds scale it into the containers' unit box, the vertices stay untouched
+        const MeshCacheHeader &header = meshCache.header();
+        glm::vec3 lower(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+        glm::vec3 upper(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+        glm::vec3 extent = upper - lower;
+        float size = std::max({extent.x, extent.y, extent.z});
+        importedFit = glm::scale(importedFit, glm::vec3(size > 0.0f ? 1.0f / size : 1.0f));
+        importedFit = glm::translate(importedFit, -(lower + upper) * 0.5f);
+        std::cout << meshPath << ": " << imported->vertex_count() << " vertices, "
+                  << imported->index_count() / 3 << " triangles, " << imported->lod_count()
+                  << " LODs" << std::endl;
+        meshCache.close();
+    }
+    const Mesh &container = imported ? *imported : cube;
 
-    // second, configure the light's VAO (VBO stays the same; the vertices are the same for the
-    // light object which is also a 3D cube)
+    // second, configure the light's VAO (the buffers stay the same; the vertices are the same for
+    // the light object which is also a 3D cube, light_cube.vs only reads the position)
     unsigned int lightCubeVAO;
     glGenVertexArrays(1, &lightCubeVAO);
-    glBindVertexArray(lightCubeVAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    // note that we update the lamp's position attribute's stride to reflect the updated buffer data
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
-    glEnableVertexAttribArray(0);
+    cube.attach(lightCubeVAO);
 
     // load textures (we now use a utility function to keep the code more organized)
     // -----------------------------------------------------------------------------
-    unsigned int diffuseMap = loadTexture("./texture/container2.png");
-    unsigned int specularMap = loadTexture("./texture/container2_specular.png");
+    // textures stream in on worker threads, the first frame doesn't wait for them
+    TextureLoader textureLoader;
+    // Shared, reference-counted handles: the same file (by path or by content) is decoded once
+    TextureCache textureCache(textureLoader);
+    unsigned int diffuseMap = textureCache.acquire(prefer_baked("./texture/container2.png"));
+    unsigned int specularMap =
+        textureCache.acquire(prefer_baked("./texture/container2_specular.png"));
+
+    // light data is shared through a uniform buffer bound once for every program that uses it
+    LightingBuffer lightingBuffer;
+    LightBlock lights = scene_light_block(pointLightPositions);
+
+    // deferred path: the containers go through the G-buffer instead, the lamps stay forward.
+    // the G-buffer follows the framebuffer, which is larger than the window on HiDPI displays
+    int fbWidth = 0, fbHeight = 0;
+    glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+    std::optional<DeferredRenderer> deferred;
+    if (path == RenderPath::Deferred) {
+        deferred.emplace(fbWidth, fbHeight);
+        deferred->attach(lightingBuffer);
+        deferred->set_point_lights(std::vector<PointLight>(
+            std::begin(lights.pointLights), std::end(lights.pointLights)));
+    }
 
-    // shader configuration
-    // --------------------
-    lightingShader.use();
-    lightingShader.set_int("material.diffuse", 0);
-    lightingShader.set_int("material.specular", 1);
+    // shader configuration, done on the first frame the scene program has finished building.
+    // the per-frame uniforms are resolved once there, the render loop never looks a name up again
+    std::optional<LightingUniforms> loc;
+    uint32_t sceneGeneration = 0;
+    auto configureScene = [&]() {
+        sceneGeneration = sceneShader.generation();
+        sceneShader.use();
+        sceneShader.set_int("material.diffuse", 0);
+        sceneShader.set_int("material.specular", 1);
+        if (path == RenderPath::Forward) lightingBuffer.attach(sceneShader);
+        if (loc) {
+            loc.emplace(sceneShader);
+            return;
+        }
+        loc.emplace(sceneShader);
+        std::cout << "scene program ready after " << glfwGetTime() << " s" << std::endl;
+        program_cache().report();
+    };
+    auto cubeViewLoc = lightCubeShader.uniform<glm::mat4>("view");
+    auto cubeProjectionLoc = lightCubeShader.uniform<glm::mat4>("projection");
+    uint32_t cubeGeneration = lightCubeShader.generation();
+
+    // edits under shader/ are picked up while the scene runs: the affected programs rebuild in
+    // the background and replace the old ones only if they link
+    ShaderWatcher watcher("./shader");
+    watcher.watch(sceneShader);
+    watcher.watch(lightCubeShader);
+
+    // containers and lamps never move: their model matrices go up once as instance attributes
+    InstanceBuffer containerInstances;
+    containerInstances.attach(container.vao_);
+    std::vector<glm::mat4> models;
+    for (uint32_t i = 0; i < 10; i++) {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, cubePositions[i]);
+        float angle = 20.0f * i;
+        model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+        models.push_back(model * importedFit);
+    }
+    containerInstances.upload(models, TransformKind::UniformScale);
+
+    InstanceBuffer lampInstances;
+    lampInstances.attach(lightCubeVAO);
+    models.clear();
+    for (uint32_t i = 0; i < 4; i++) {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, pointLightPositions[i]);
+        model = glm::scale(model, glm::vec3(0.2f));  // Make it a smaller cube
+        models.push_back(model);
+    }
+    lampInstances.upload(models, TransformKind::UniformScale);
+
+    float lastStateReport = 0.0f;
 
     // render loop
     // -----------
@@ -1074,136 +1050,457 @@ void light()
         lastFrame = currentFrame;
 
         processInput(window);
+        textureLoader.update();
+
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(window, &width, &height);
+        // a minimized window reports 0x0, keep the last size until it comes back
+        if (width > 0 && height > 0 && (width != fbWidth || height != fbHeight)) {
+            fbWidth = width;
+            fbHeight = height;
+            if (deferred) deferred->resize(fbWidth, fbHeight);
+        }
 
         // render
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // be sure to activate shader when setting uniforms/drawing objects
-        lightingShader.use();
-        lightingShader.set_vec3("viewPos", camera.Position);
-        lightingShader.set_float("material.shininess", 32.0f);
-
-        /*
-           Here we set all the uniforms for the 5/6 types of lights we have. We have to set them
-           manually and index the proper PointLight struct in the array to set each uniform
-           variable. This can be done more code-friendly by defining light types as classes and set
-           their values in there, or by using a more efficient uniform approach by using 'Uniform
-           buffer objects', but that is something we'll discuss in the 'Advanced GLSL' tutorial.
-        */
-        // directional light
-        lightingShader.set_vec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-        lightingShader.set_vec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-        lightingShader.set_vec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-        lightingShader.set_vec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-        // point light 1
-        lightingShader.set_vec3("pointLights[0].position", pointLightPositions[0]);
-        lightingShader.set_vec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-        lightingShader.set_vec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-        lightingShader.set_vec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-        lightingShader.set_float("pointLights[0].constant", 1.0f);
-        lightingShader.set_float("pointLights[0].linear", 0.09f);
-        lightingShader.set_float("pointLights[0].quadratic", 0.032f);
-        // point light 2
-        lightingShader.set_vec3("pointLights[1].position", pointLightPositions[1]);
-        lightingShader.set_vec3("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-        lightingShader.set_vec3("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
-        lightingShader.set_vec3("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
-        lightingShader.set_float("pointLights[1].constant", 1.0f);
-        lightingShader.set_float("pointLights[1].linear", 0.09f);
-        lightingShader.set_float("pointLights[1].quadratic", 0.032f);
-        // point light 3
-        lightingShader.set_vec3("pointLights[2].position", pointLightPositions[2]);
-        lightingShader.set_vec3("pointLights[2].ambient", 0.05f, 0.05f, 0.05f);
-        lightingShader.set_vec3("pointLights[2].diffuse", 0.8f, 0.8f, 0.8f);
-        lightingShader.set_vec3("pointLights[2].specular", 1.0f, 1.0f, 1.0f);
-        lightingShader.set_float("pointLights[2].constant", 1.0f);
-        lightingShader.set_float("pointLights[2].linear", 0.09f);
-        lightingShader.set_float("pointLights[2].quadratic", 0.032f);
-        // point light 4
-        lightingShader.set_vec3("pointLights[3].position", pointLightPositions[3]);
-        lightingShader.set_vec3("pointLights[3].ambient", 0.05f, 0.05f, 0.05f);
-        lightingShader.set_vec3("pointLights[3].diffuse", 0.8f, 0.8f, 0.8f);
-        lightingShader.set_vec3("pointLights[3].specular", 1.0f, 1.0f, 1.0f);
-        lightingShader.set_float("pointLights[3].constant", 1.0f);
-        lightingShader.set_float("pointLights[3].linear", 0.09f);
-        lightingShader.set_float("pointLights[3].quadratic", 0.032f);
-        // spotLight
-        lightingShader.set_vec3("spotLight.position", camera.Position);
-        lightingShader.set_vec3("spotLight.direction", camera.Front);
-        lightingShader.set_vec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-        lightingShader.set_vec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-        lightingShader.set_vec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-        lightingShader.set_float("spotLight.constant", 1.0f);
-        lightingShader.set_float("spotLight.linear", 0.09f);
-        lightingShader.set_float("spotLight.quadratic", 0.032f);
-        lightingShader.set_float("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-        lightingShader.set_float("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-
         // view/projection transformations
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
                                                 (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
-        lightingShader.set_mat4("projection", projection);
-        lightingShader.set_mat4("view", view);
 
-        // world transformation
-        glm::mat4 model = glm::mat4(1.0f);
-        lightingShader.set_mat4("model", model);
-
-        // bind diffuse map
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, diffuseMap);
-        // bind specular map
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, specularMap);
-
-        // render containers
-        glBindVertexArray(cubeVAO);
-        for (uint32_t i = 0; i < 10; i++) {
-            // calculate the model matrix for each object and pass it to shader before drawing
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-            float angle = 20.0f * i;
-            model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-            lightingShader.set_mat4("model", model);
-
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+        // polls GL_COMPLETION_STATUS_KHR without blocking while the program is still compiling
+        if (!loc && sceneShader.ready()) configureScene();
+        // a reloaded program starts with fresh uniform state and possibly moved locations
+        watcher.update();
+        if (loc && sceneShader.generation() != sceneGeneration) configureScene();
+        if (lightCubeShader.generation() != cubeGeneration) {
+            cubeGeneration = lightCubeShader.generation();
+            cubeViewLoc = lightCubeShader.uniform<glm::mat4>("view");
+            cubeProjectionLoc = lightCubeShader.uniform<glm::mat4>("projection");
+        }
+
+        if (loc) {
+            // be sure to activate shader when setting uniforms/drawing objects
+            if (path == RenderPath::Deferred) deferred->begin_geometry();
+            sceneShader.use();
+            sceneShader.set(loc->shininess, 32.0f);
+
+            // all light parameters live in the Lighting uniform block: only the camera-dependent
+            // fields change per frame, and the whole block goes up in one glBufferSubData
+            lights.viewPos = camera.Position;
+            lights.spotLight.position = camera.Position;
+            lights.spotLight.direction = camera.Front;
+            lightingBuffer.upload(lights);
+
+            sceneShader.set(loc->projection, projection);
+            sceneShader.set(loc->view, view);
+
+            // bind diffuse map
+            gl_state().bind_texture(0, GL_TEXTURE_2D, diffuseMap);
+            // bind specular map
+            gl_state().bind_texture(1, GL_TEXTURE_2D, specularMap);
+
+            // render containers
+            container.draw(containerInstances.count());
+
+            // shade the G-buffer into the default framebuffer, depth is copied along for the
+            // lamps
+            if (path == RenderPath::Deferred) deferred->resolve(view, projection, 32.0f);
         }
 
         // also draw the lamp object(s)
         lightCubeShader.use();
-        lightCubeShader.set_mat4("projection", projection);
-        lightCubeShader.set_mat4("view", view);
+        lightCubeShader.set(cubeProjectionLoc, projection);
+        lightCubeShader.set(cubeViewLoc, view);
+
+        // fallback: unlit containers with the lamp program until the lighting program is ready
+        if (!loc) container.draw(containerInstances.count());
 
         // we now draw as many light bulbs as we have point lights.
-        glBindVertexArray(lightCubeVAO);
-        for (uint32_t i = 0; i < 4; i++) {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, pointLightPositions[i]);
-            model = glm::scale(model, glm::vec3(0.2f));  // Make it a smaller cube
-            lightCubeShader.set_mat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+        cube.draw_on(lightCubeVAO, lampInstances.count());
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+
+        // state changes that reached the driver vs the redundant ones the tracker dropped
+        gl_state().end_frame();
+        if (currentFrame - lastStateReport >= 1.0f) {
+            lastStateReport = currentFrame;
+            const GLState::Counters &calls = gl_state().last_frame();
+            std::string title = "light: " + std::to_string(calls.issued) + " state calls issued, " +
+                                std::to_string(calls.filtered) + " filtered per frame";
+            glfwSetWindowTitle(window, title.c_str());
+        }
+    }
+
+    cube.release();
+    if (imported) imported->release();
+    gl_state().delete_vertex_arrays(1, &lightCubeVAO);
+    gl_state().delete_buffers(1, &lightingBuffer.id_);
+    gl_state().delete_buffers(1, &containerInstances.id_);
+    gl_state().delete_buffers(1, &lampInstances.id_);
+    if (deferred) deferred->release();
+    glDeleteProgram(sceneShader.id_);
+    textureCache.clear();
+    textureLoader.release();
+
+    glfwTerminate();
+    return;
+}
+
+// light() 的 clustered forward 版本：lightCount 个随机点光源，每个片段只计算所在 cluster 内的光源
+void clustered_light(uint32_t lightCount)
+{
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if (window == NULL) {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return;
+    }
+    gl_state().invalidate();
+
+    gl_state().enable(GL_DEPTH_TEST);
+
+    Shader lightingShader("./shader/light.vs", "./shader/light_clustered.fs");
+    Shader lightCubeShader("./shader/light_cube.vs", "./shader/light_cube.fs");
+
+    // one welded cube mesh, the lamps attach its buffers to a second VAO of their own
+    Mesh cube(weld_vertices(CUBE_VERTICES, CUBE_VERTEX_COUNT, CUBE_STRIDE / sizeof(float)),
+              VERTEX_LAYOUT_COMPACT16);
+    unsigned int lightCubeVAO;
+    glGenVertexArrays(1, &lightCubeVAO);
+    cube.attach(lightCubeVAO);
+
+    // textures stream in on worker threads, the first frame doesn't wait for them
+    TextureLoader textureLoader;
+    TextureCache textureCache(textureLoader);
+    unsigned int diffuseMap = textureCache.acquire(prefer_baked("./texture/container2.png"));
+    unsigned int specularMap =
+        textureCache.acquire(prefer_baked("./texture/container2_specular.png"));
+
+    // the directional and spot light still come from the Lighting uniform block,
+    // point lights come from the cluster grid
+    const float zNear = 0.1f;
+    const float zFar = 100.0f;
+    const float aspect = (float)SCR_WIDTH / (float)SCR_HEIGHT;
+    std::vector<PointLight> pointLights = random_point_lights(lightCount);
+    LightingBuffer lightingBuffer;
+    lightingBuffer.attach(lightingShader);
+    glm::vec3 unusedPositions[NR_POINT_LIGHTS] = {};
+    LightBlock lights = scene_light_block(unusedPositions);
+    ClusterGrid clusters(zNear, zFar);
+    // tiles are found from gl_FragCoord, so this has to follow the framebuffer, not the window
+    int fbWidth = 0, fbHeight = 0;
+    glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+    clusters.attach(lightingShader, fbWidth, fbHeight);
+
+    lightingShader.use();
+    lightingShader.set_int("material.diffuse", 0);
+    lightingShader.set_int("material.specular", 1);
+    lightingShader.set_float("material.shininess", 32.0f);
+    lightingShader.set_bool("useClusters", true);
+    lightingShader.set_int("lightCount", (int)pointLights.size());
+
+    LightingUniforms loc(lightingShader);
+    program_cache().report();
+    auto cubeViewLoc = lightCubeShader.uniform<glm::mat4>("view");
+    auto cubeProjectionLoc = lightCubeShader.uniform<glm::mat4>("projection");
+
+    InstanceBuffer containerInstances;
+    containerInstances.attach(cube.vao_);
+    std::vector<glm::mat4> models;
+    for (uint32_t i = 0; i < CUBE_POSITION_COUNT; i++) models.push_back(cube_model(i));
+    containerInstances.upload(models, TransformKind::UniformScale);
+
+    // one small lamp cube per point light, all drawn with a single instanced call
+    InstanceBuffer lampInstances;
+    lampInstances.attach(lightCubeVAO);
+    models.clear();
+    for (const PointLight &light : pointLights) {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, light.position);
+        model = glm::scale(model, glm::vec3(0.05f));
+        models.push_back(model);
+    }
+    lampInstances.upload(models, TransformKind::UniformScale);
+
+    // both batches go through the render queue, which orders them by program/texture/VAO
+    RenderQueue queue;
+    DrawCommand containers;
+    containers.shader = &lightingShader;
+    containers.vao = cube.vao_;
+    containers.textures[0] = diffuseMap;
+    containers.textures[1] = specularMap;
+    containers.indexType = cube.index_type();
+    containers.count = cube.index_count();
+    containers.instanceCount = static_cast<int32_t>(containerInstances.count());
+    DrawCommand lamps;
+    lamps.shader = &lightCubeShader;
+    lamps.vao = lightCubeVAO;
+    lamps.indexType = cube.index_type();
+    lamps.count = cube.index_count();
+    lamps.instanceCount = static_cast<int32_t>(lampInstances.count());
+
+    while (!glfwWindowShouldClose(window)) {
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        processInput(window);
+        textureLoader.update();
+
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(window, &width, &height);
+        // a minimized window reports 0x0, keep the last size until it comes back
+        if (width > 0 && height > 0 && (width != fbWidth || height != fbHeight)) {
+            fbWidth = width;
+            fbHeight = height;
+            clusters.resize(lightingShader, fbWidth, fbHeight);
         }
 
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), aspect, zNear, zFar);
+        glm::mat4 view = camera.GetViewMatrix();
+
+        // re-assign lights to clusters every frame, the grid lives in view space
+        clusters.update(pointLights, view, glm::radians(camera.Zoom), aspect);
+        lights.viewPos = camera.Position;
+        lights.spotLight.position = camera.Position;
+        lights.spotLight.direction = camera.Front;
+        lightingBuffer.upload(lights);
+
+        lightingShader.use();
+        lightingShader.set(loc.projection, projection);
+        lightingShader.set(loc.view, view);
+        lightCubeShader.use();
+        lightCubeShader.set(cubeProjectionLoc, projection);
+        lightCubeShader.set(cubeViewLoc, view);
+        clusters.bind();
+
+        queue.clear();
+        queue.submit(containers, 0.0f);
+        queue.submit(lamps, 0.0f);
+        queue.sort();
+        queue.execute();
+
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
-    glDeleteVertexArrays(1, &cubeVAO);
-    glDeleteVertexArrays(1, &lightCubeVAO);
-    glDeleteBuffers(1, &VBO);
+    cube.release();
+    gl_state().delete_vertex_arrays(1, &lightCubeVAO);
+    gl_state().delete_buffers(1, &lightingBuffer.id_);
+    gl_state().delete_buffers(1, &containerInstances.id_);
+    gl_state().delete_buffers(1, &lampInstances.id_);
+    clusters.release();
+    textureCache.clear();
+    textureLoader.release();
 
     glfwTerminate();
     return;
 }
-int main()
+
+// 实例化压力测试：instanceCount 个箱子（建议 100000 以上）全部由一次 glDrawElementsInstanced 绘制，
+// 每秒把帧时间与实例数写到窗口标题和 stdout
+void instancing_stress(uint32_t instanceCount)
 {
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if (window == NULL) {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    // 关闭垂直同步，否则测到的只是显示器刷新率
+    glfwSwapInterval(0);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return;
+    }
+    gl_state().invalidate();
+
+    gl_state().enable(GL_DEPTH_TEST);
+
+    Shader lightingShader("./shader/light.vs", "./shader/light.fs");
+
+    // welded: each instance runs the vertex shader for 24 vertices instead of 36
+    Mesh cube(weld_vertices(CUBE_VERTICES, CUBE_VERTEX_COUNT, CUBE_STRIDE / sizeof(float)),
+              VERTEX_LAYOUT_COMPACT16);
+
+    // textures stream in on worker threads, the first frame doesn't wait for them
+    TextureLoader textureLoader;
+    TextureCache textureCache(textureLoader);
+    unsigned int diffuseMap = textureCache.acquire(prefer_baked("./texture/container2.png"));
+    unsigned int specularMap =
+        textureCache.acquire(prefer_baked("./texture/container2_specular.png"));
+
+    lightingShader.use();
+    lightingShader.set_int("material.diffuse", 0);
+    lightingShader.set_int("material.specular", 1);
+
+    // the field is a cube of side ~cbrt(n) * 2, put the point lights around its middle
+    glm::vec3 pointLightPositions[NR_POINT_LIGHTS] = {
+        glm::vec3(0.7f, 0.2f, 2.0f), glm::vec3(2.3f, -3.3f, -4.0f), glm::vec3(-4.0f, 2.0f, -12.0f),
+        glm::vec3(0.0f, 0.0f, -3.0f)};
+    LightingBuffer lightingBuffer;
+    lightingBuffer.attach(lightingShader);
+    LightBlock lights = scene_light_block(pointLightPositions);
+    LightingUniforms loc(lightingShader);
+    program_cache().report();
+
+    InstanceBuffer instances;
+    instances.attach(cube.vao_);
+    instances.upload(cube_field(instanceCount), TransformKind::UniformScale);
+
+    const float zFar = 1000.0f;
+    double lastReport = glfwGetTime();
+    uint32_t frames = 0;
+    while (!glfwWindowShouldClose(window)) {
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        processInput(window);
+
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        lights.viewPos = camera.Position;
+        lights.spotLight.position = camera.Position;
+        lights.spotLight.direction = camera.Front;
+        lightingBuffer.upload(lights);
+
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
+                                                (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, zFar);
+        lightingShader.use();
+        lightingShader.set(loc.shininess, 32.0f);
+        lightingShader.set(loc.projection, projection);
+        lightingShader.set(loc.view, camera.GetViewMatrix());
+
+        textureLoader.update();
+        gl_state().bind_texture(0, GL_TEXTURE_2D, diffuseMap);
+        gl_state().bind_texture(1, GL_TEXTURE_2D, specularMap);
+
+        cube.draw(instances.count());
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+
+        frames++;
+        double now = glfwGetTime();
+        if (now - lastReport >= 1.0) {
+            double ms = (now - lastReport) * 1000.0 / frames;
+            std::string title = "instancing: " + std::to_string(instanceCount) + " cubes, " +
+                                std::to_string(ms) + " ms/frame";
+            glfwSetWindowTitle(window, title.c_str());
+            std::cout << title << std::endl;
+            lastReport = now;
+            frames = 0;
+        }
+    }
+
+    cube.release();
+    gl_state().delete_buffers(1, &lightingBuffer.id_);
+    gl_state().delete_buffers(1, &instances.id_);
+    textureCache.clear();
+    textureLoader.release();
+
+    glfwTerminate();
+    return;
+}
+
+int main(int argc, char **argv)
+{
+    // 启动时选择渲染路径与代替箱子的模型: ./learn_opengl --deferred --mesh ./model/bunny.obj
+    RenderPath path = RenderPath::Forward;
+    std::string meshPath;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--deferred")
+            path = RenderPath::Deferred;
+        else if (arg == "--mesh" && i + 1 < argc)
+            meshPath = argv[++i];
+    }
+    // 离线烘焙纹理，结果写到源文件旁边，选项作用于其后的文件:
+    // ./learn_opengl --bake --compress ./texture/container2.png --normal-map ./texture/normal.png
+    if (argc > 1 && std::string_view(argv[1]) == "--bake") {
+        BakeOptions options;
+        bool baked = true;
+        for (int i = 2; i < argc; i++) {
+            std::string_view arg = argv[i];
+            if (arg == "--compress")
+                options.compress = true;
+            else if (arg == "--normal-map")
+                options.normalMap = true;
+            else if (arg == "--flip")
+                options.flipVertically = true;
+            else if (arg == "--kaiser")
+                options.mipFilter = MipFilter::Kaiser;
+            else if (arg == "--srgb")
+                options.srgb = true;
+            else
+                baked = bake_texture(argv[i], baked_texture_path(argv[i]), options) && baked;
+        }
+        return baked ? 0 : 1;
+    }
+
     // triagnle();
     // shader();
     // texture();
     // coordinate();
     // camera_move();
-    light();
+    light(path, meshPath);
+    // clustered_light(1024);
+    // instancing_stress(100000);
+    // bench_uniforms();
+    // bench_clustered();
+    // bench_deferred();
+    // bench_instancing();
+    // bench_normal_matrix();
+    // bench_shader_compile();
+    // bench_shader_variants();
+    // bench_render_queue();
+    // bench_texture_streaming();
+    // bench_texture_bake();
+    // bench_block_compression();
+    // bench_mip_generation();
+    // bench_texture_array();
+    // bench_texture_cache();
+    // bench_texture_residency();
+    // bench_mesh_welding();
+    // bench_mesh_optimization();
+    // bench_vertex_formats();
+    // bench_mesh_import();
+    // bench_mesh_cache();
     return 0;
 }
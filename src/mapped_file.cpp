@@ -0,0 +1,92 @@
+#include "mapped_file.h"
+
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        std::cout << "ERROR::MAPPED_FILE::OPEN_FAILED " << path << std::endl;
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        std::cout << "ERROR::MAPPED_FILE::MAP_FAILED " << path << std::endl;
+        return false;
+    }
+    file_ = file;
+    mapping_ = mapping;
+    data_ = static_cast<const uint8_t *>(view);
+    size_ = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0) {
+        if (fd >= 0) ::close(fd);
+        std::cout << "ERROR::MAPPED_FILE::OPEN_FAILED " << path << std::endl;
+        return false;
+    }
+    void *view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // 映射建立后文件描述符就不再需要
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        std::cout << "ERROR::MAPPED_FILE::MAP_FAILED " << path << std::endl;
+        return false;
+    }
+    data_ = static_cast<const uint8_t *>(view);
+    size_ = static_cast<size_t>(info.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data_ == nullptr) return;
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+    CloseHandle(file_);
+    file_ = nullptr;
+    mapping_ = nullptr;
+#else
+    munmap(const_cast<uint8_t *>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+void MappedFile::prefetch() const
+{
+    if (data_ == nullptr) return;
+#ifndef _WIN32
+    // 先让内核发起整段预读，下面逐页访问时多数页已经在路上
+    madvise(const_cast<uint8_t *>(data_), size_, MADV_WILLNEED);
+#endif
+    constexpr size_t TOUCH_STRIDE = 4096;
+    volatile uint8_t sink = 0;
+    for (size_t offset = 0; offset < size_; offset += TOUCH_STRIDE) sink = sink + data_[offset];
+}
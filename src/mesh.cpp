@@ -0,0 +1,209 @@
+#include "mesh.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "gl_state.h"
+#include "mesh_optimizer.h"
+
+namespace {
+constexpr uint32_t EMPTY_SLOT = 0xFFFFFFFFu;
+
+// -0 的位模式与 +0 不同，先统一成 +0，焊接与哈希都只比较位模式
+uint32_t canonical_bits(float value)
+{
+    if (value == 0.0f) return 0;
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+uint64_t vertex_hash(const uint32_t *bits, uint32_t components)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (uint32_t i = 0; i < components; i++) {
+        hash = (hash ^ bits[i]) * 0x100000001B3ull;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+VertexLayout float_layout(std::initializer_list<uint32_t> attributeSizes)
+{
+    std::vector<VertexAttribute> attributes;
+    for (uint32_t size : attributeSizes) attributes.push_back({size, VertexFormat::Float});
+    return VertexLayout(attributes);
+}
+}  // namespace
+
+IndexedMesh weld_vertices(const float *vertices, size_t vertexCount, uint32_t components)
+{
+    IndexedMesh mesh;
+    mesh.components = components;
+    mesh.indices.resize(vertexCount);
+    if (components == 0) return mesh;
+
+    // 负载因子不超过 1/2，线性探测
+    size_t capacity = 16;
+    while (capacity < vertexCount * 2) capacity <<= 1;
+    std::vector<uint32_t> slots(capacity, EMPTY_SLOT);
+    // 已保留顶点的规范化位模式，比较时不必再处理 ±0
+    std::vector<uint32_t> keys;
+    keys.reserve(vertexCount * components);
+    std::vector<uint32_t> bits(components);
+    uint32_t unique = 0;
+    for (size_t i = 0; i < vertexCount; i++) {
+        const float *vertex = vertices + i * components;
+        for (uint32_t c = 0; c < components; c++) bits[c] = canonical_bits(vertex[c]);
+        size_t slot = vertex_hash(bits.data(), components) & (capacity - 1);
+        while (true) {
+            uint32_t index = slots[slot];
+            if (index == EMPTY_SLOT) {
+                slots[slot] = index = unique++;
+                keys.insert(keys.end(), bits.begin(), bits.end());
+                mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + components);
+            } else if (std::memcmp(&keys[(size_t)index * components], bits.data(),
+                                   components * sizeof(uint32_t)) != 0) {
+                slot = (slot + 1) & (capacity - 1);
+                continue;
+            }
+            mesh.indices[i] = index;
+            break;
+        }
+    }
+    return mesh;
+}
+
+std::vector<float> unweld_vertices(const IndexedMesh &mesh)
+{
+    std::vector<float> vertices;
+    vertices.reserve(mesh.indices.size() * mesh.components);
+    for (uint32_t index : mesh.indices) {
+        const float *vertex = &mesh.vertices[(size_t)index * mesh.components];
+        vertices.insert(vertices.end(), vertex, vertex + mesh.components);
+    }
+    return vertices;
+}
+
+void generate_normals(IndexedMesh &mesh, bool onlyMissing)
+{
+    const size_t vertexCount = mesh.vertex_count();
+    if (mesh.components < 6) return;
+    std::vector<float> normals(vertexCount * 3, 0.0f);
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        const float *p0 = &mesh.vertices[(size_t)mesh.indices[i] * mesh.components];
+        const float *p1 = &mesh.vertices[(size_t)mesh.indices[i + 1] * mesh.components];
+        const float *p2 = &mesh.vertices[(size_t)mesh.indices[i + 2] * mesh.components];
+        const float a[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        const float b[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        // 叉积的长度是面积的两倍，不归一化即为面积加权
+        const float n[3] = {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2],
+                            a[0] * b[1] - a[1] * b[0]};
+        for (uint32_t c = 0; c < 3; c++) {
+            for (uint32_t k = 0; k < 3; k++) normals[(size_t)mesh.indices[i + c] * 3 + k] += n[k];
+        }
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        float *normal = &mesh.vertices[v * mesh.components + 3];
+        if (onlyMissing && (normal[0] != 0.0f || normal[1] != 0.0f || normal[2] != 0.0f))
+            continue;
+        const float *sum = &normals[v * 3];
+        float length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+        for (uint32_t k = 0; k < 3; k++) normal[k] = length > 0.0f ? sum[k] / length : 0.0f;
+    }
+}
+
+GLenum index_type_for(size_t vertexCount)
+{
+    return vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+Mesh::Mesh(const IndexedMesh &source, const VertexLayout &layout, bool optimize) : layout_(layout)
+{
+    IndexedMesh optimized;
+    if (optimize) {
+        optimized = source;
+        optimize_mesh(optimized);
+    }
+    const IndexedMesh &mesh = optimize ? optimized : source;
+    vertexCount_ = static_cast<uint32_t>(mesh.vertex_count());
+    indexType_ = index_type_for(mesh.vertex_count());
+    lods_ = {{0, static_cast<uint32_t>(mesh.indices.size()), 0.0f}};
+
+    std::vector<uint8_t> vertices = layout_.pack(mesh.vertices.data(), vertexCount_);
+    if (indexType_ == GL_UNSIGNED_SHORT) {
+        std::vector<uint16_t> indices(mesh.indices.begin(), mesh.indices.end());
+        upload(vertices.data(), indices.data());
+    } else {
+        upload(vertices.data(), mesh.indices.data());
+    }
+}
+
+Mesh::Mesh(const IndexedMesh &mesh, std::initializer_list<uint32_t> attributeSizes,
+           bool optimize)
+    : Mesh(mesh, float_layout(attributeSizes), optimize)
+{
+}
+
+Mesh::Mesh(const VertexLayout &layout, const void *vertices, uint32_t vertexCount,
+           const void *indices, GLenum indexType, const std::vector<MeshLod> &lods)
+    : layout_(layout), vertexCount_(vertexCount), indexType_(indexType), lods_(lods)
+{
+    upload(vertices, indices);
+}
+
+void Mesh::upload(const void *vertices, const void *indices)
+{
+    glGenBuffers(1, &vbo_);
+    glGenBuffers(1, &ebo_);
+    gl_state().bind_buffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER, (size_t)vertexCount_ * layout_.stride(), vertices,
+                 GL_STATIC_DRAW);
+
+    glGenVertexArrays(1, &vao_);
+    attach(vao_);
+    // ELEMENT_ARRAY_BUFFER 的绑定属于 VAO，attach() 之后 vao_ 上绑定的就是 ebo_
+    gl_state().bind_vertex_array(vao_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_bytes(), indices, GL_STATIC_DRAW);
+    gl_state().bind_vertex_array(0);
+}
+
+size_t Mesh::index_bytes() const
+{
+    size_t indexCount = 0;
+    for (const MeshLod &lod : lods_) indexCount += lod.indexCount;
+    return indexCount * (indexType_ == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t));
+}
+
+void Mesh::attach(uint32_t vao) const
+{
+    layout_.attach(vao, vbo_);
+    gl_state().bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    gl_state().bind_vertex_array(0);
+}
+
+void Mesh::draw_on(uint32_t vao, int32_t instances, uint32_t lod) const
+{
+    const MeshLod &range = lods_[lod];
+    const size_t indexSize = indexType_ == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    const void *offset = reinterpret_cast<const void *>(range.firstIndex * indexSize);
+    const GLsizei count = static_cast<GLsizei>(range.indexCount);
+    gl_state().bind_vertex_array(vao);
+    if (instances > 0)
+        glDrawElementsInstanced(GL_TRIANGLES, count, indexType_, offset, instances);
+    else
+        glDrawElements(GL_TRIANGLES, count, indexType_, offset);
+}
+
+size_t Mesh::bytes() const
+{
+    return (size_t)vertexCount_ * layout_.stride() + index_bytes();
+}
+
+void Mesh::release()
+{
+    gl_state().delete_vertex_arrays(1, &vao_);
+    gl_state().delete_buffers(1, &vbo_);
+    gl_state().delete_buffers(1, &ebo_);
+    vao_ = vbo_ = ebo_ = 0;
+}
@@ -0,0 +1,221 @@
+#include "mesh_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "mesh_import.h"
+#include "mesh_optimizer.h"
+
+namespace {
+size_t align_up(size_t size)
+{
+    return (size + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+}
+
+bool same_layout(const VertexLayout &a, const VertexLayout &b)
+{
+    const std::vector<VertexAttribute> &x = a.attributes(), &y = b.attributes();
+    if (x.size() != y.size()) return false;
+    for (size_t i = 0; i < x.size(); i++) {
+        if (x[i].components != y[i].components || x[i].format != y[i].format) return false;
+    }
+    return true;
+}
+}  // namespace
+
+bool write_mesh_cache(const IndexedMesh &mesh, const VertexLayout &layout,
+                      const std::string &destination, uint32_t lodCount)
+{
+    MeshCacheHeader header = {};
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.attributeCount = static_cast<uint32_t>(layout.attributes().size());
+    header.stride = layout.stride();
+
+    // 第 0 级完整优化；之后各级都从上一级简化，只重排三角形，共用第 0 级排好的顶点
+    IndexedMesh working = mesh;
+    optimize_mesh(working);
+    header.vertexCount = static_cast<uint32_t>(working.vertex_count());
+    header.indexType = index_type_for(working.vertex_count());
+    std::vector<uint32_t> indices = working.indices;
+    std::vector<MeshLod> lods = {{0, static_cast<uint32_t>(indices.size()), 0.0f}};
+    lodCount = std::clamp(lodCount, 1u, MESH_CACHE_MAX_LODS);
+    float error = 0.0f;
+    for (uint32_t grid = 256; grid >= 2 && lods.size() < lodCount; grid /= 2) {
+        // 误差逐级累加，是相对第 0 级的上限
+        error += simplify_clustered(working, grid);
+        if (working.indices.empty()) break;
+        if (working.indices.size() * 10 > (size_t)lods.back().indexCount * 7) continue;
+        optimize_vertex_cache(working);
+        lods.push_back({static_cast<uint32_t>(indices.size()),
+                        static_cast<uint32_t>(working.indices.size()), error});
+        indices.insert(indices.end(), working.indices.begin(), working.indices.end());
+    }
+    header.lodCount = static_cast<uint32_t>(lods.size());
+    header.indexCount = static_cast<uint32_t>(indices.size());
+
+    // 包围体按量化前的位置计算
+    const size_t vertexCount = working.vertex_count();
+    for (uint32_t k = 0; k < 3; k++)
+        header.boundsMin[k] = header.boundsMax[k] = vertexCount > 0 ? working.vertices[k] : 0.0f;
+    for (size_t v = 0; v < vertexCount; v++) {
+        const float *position = &working.vertices[v * working.components];
+        for (uint32_t k = 0; k < 3; k++) {
+            header.boundsMin[k] = std::min(header.boundsMin[k], position[k]);
+            header.boundsMax[k] = std::max(header.boundsMax[k], position[k]);
+        }
+    }
+    for (uint32_t k = 0; k < 3; k++)
+        header.sphereCenter[k] = (header.boundsMin[k] + header.boundsMax[k]) * 0.5f;
+    float radius2 = 0.0f;
+    for (size_t v = 0; v < vertexCount; v++) {
+        const float *position = &working.vertices[v * working.components];
+        float d2 = 0.0f;
+        for (uint32_t k = 0; k < 3; k++) {
+            float d = position[k] - header.sphereCenter[k];
+            d2 += d * d;
+        }
+        radius2 = std::max(radius2, d2);
+    }
+    header.sphereRadius = std::sqrt(radius2);
+
+    std::vector<MeshCacheAttribute> attributes;
+    for (const VertexAttribute &attribute : layout.attributes())
+        attributes.push_back({attribute.components, static_cast<uint32_t>(attribute.format)});
+    std::vector<uint8_t> vertices = layout.pack(working.vertices.data(), vertexCount);
+    std::vector<uint16_t> shortIndices;
+    const uint8_t *indexData = reinterpret_cast<const uint8_t *>(indices.data());
+    size_t indexBytes = indices.size() * sizeof(uint32_t);
+    if (header.indexType == GL_UNSIGNED_SHORT) {
+        shortIndices.assign(indices.begin(), indices.end());
+        indexData = reinterpret_cast<const uint8_t *>(shortIndices.data());
+        indexBytes = shortIndices.size() * sizeof(uint16_t);
+    }
+    const size_t tableEnd = sizeof(header) + attributes.size() * sizeof(MeshCacheAttribute) +
+                            lods.size() * sizeof(MeshLod);
+    header.vertexOffset = align_up(tableEnd);
+    header.indexOffset = align_up(header.vertexOffset + vertices.size());
+
+    std::ofstream file(destination, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(attributes.data()),
+               attributes.size() * sizeof(MeshCacheAttribute));
+    file.write(reinterpret_cast<const char *>(lods.data()), lods.size() * sizeof(MeshLod));
+    const char padding[MESH_CACHE_ALIGNMENT] = {};
+    file.write(padding, header.vertexOffset - tableEnd);
+    file.write(reinterpret_cast<const char *>(vertices.data()), vertices.size());
+    file.write(padding, header.indexOffset - header.vertexOffset - vertices.size());
+    file.write(reinterpret_cast<const char *>(indexData), indexBytes);
+    file.write(padding, align_up(indexBytes) - indexBytes);
+    if (!file) {
+        std::cout << "ERROR::MESH_CACHE::WRITE_FAILED " << destination << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string mesh_cache_path(const std::string &source)
+{
+    return std::filesystem::path(source).replace_extension(MESH_CACHE_EXTENSION).string();
+}
+
+bool MeshCache::open(const std::string &path)
+{
+    if (!file_.open(path)) return false;
+    const size_t size = file_.size();
+    header_ = reinterpret_cast<const MeshCacheHeader *>(file_.data());
+    bool valid = size >= sizeof(MeshCacheHeader) &&
+                 std::memcmp(header_->magic, MESH_CACHE_MAGIC, sizeof(header_->magic)) == 0 &&
+                 header_->version == MESH_CACHE_VERSION && header_->attributeCount > 0 &&
+                 header_->attributeCount <= 16 && header_->lodCount > 0 &&
+                 header_->lodCount <= MESH_CACHE_MAX_LODS &&
+                 (header_->indexType == GL_UNSIGNED_SHORT ||
+                  header_->indexType == GL_UNSIGNED_INT);
+    if (valid) {
+        const size_t tableEnd = sizeof(MeshCacheHeader) +
+                                header_->attributeCount * sizeof(MeshCacheAttribute) +
+                                header_->lodCount * sizeof(MeshLod);
+        attributes_ = reinterpret_cast<const MeshCacheAttribute *>(file_.data() +
+                                                                   sizeof(MeshCacheHeader));
+        lods_ = reinterpret_cast<const MeshLod *>(attributes_ + header_->attributeCount);
+        const uint64_t vertexBytes = (uint64_t)header_->vertexCount * header_->stride;
+        const uint64_t indexBytes = (uint64_t)header_->indexCount *
+                                    (header_->indexType == GL_UNSIGNED_SHORT ? 2 : 4);
+        valid = size >= tableEnd && header_->vertexOffset >= tableEnd &&
+                header_->vertexOffset % MESH_CACHE_ALIGNMENT == 0 &&
+                header_->indexOffset % MESH_CACHE_ALIGNMENT == 0 &&
+                header_->vertexOffset <= size && vertexBytes <= size - header_->vertexOffset &&
+                header_->indexOffset >= header_->vertexOffset + vertexBytes &&
+                header_->indexOffset <= size && indexBytes <= size - header_->indexOffset;
+        for (uint32_t i = 0; i < header_->attributeCount && valid; i++) {
+            valid = attributes_[i].components >= 1 && attributes_[i].components <= 4 &&
+                    attributes_[i].format <= static_cast<uint32_t>(VertexFormat::Octahedral16);
+        }
+        // 属性表重建出的布局必须与写入时的 stride 一致，VertexLayout 的对齐规则变化后旧缓存作废
+        valid = valid && layout().stride() == header_->stride;
+        // 各级依次排列，覆盖全部索引，索引不超出顶点范围留给写入方保证
+        uint64_t next = 0;
+        for (uint32_t i = 0; i < header_->lodCount && valid; i++) {
+            valid = lods_[i].firstIndex == next && lods_[i].indexCount % 3 == 0;
+            next += lods_[i].indexCount;
+        }
+        valid = valid && next == header_->indexCount;
+    }
+    if (!valid) {
+        std::cout << "ERROR::MESH_CACHE::INVALID_FILE " << path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MeshCache::close()
+{
+    file_.close();
+    header_ = nullptr;
+    attributes_ = nullptr;
+    lods_ = nullptr;
+}
+
+VertexLayout MeshCache::layout() const
+{
+    std::vector<VertexAttribute> attributes;
+    for (uint32_t i = 0; i < header_->attributeCount; i++) {
+        attributes.push_back(
+            {attributes_[i].components, static_cast<VertexFormat>(attributes_[i].format)});
+    }
+    return VertexLayout(attributes);
+}
+
+Mesh MeshCache::create_mesh() const
+{
+    return Mesh(layout(), vertex_data(), header_->vertexCount, index_data(), header_->indexType,
+                std::vector<MeshLod>(lods_, lods_ + header_->lodCount));
+}
+
+bool open_mesh_cache(const std::string &source, const VertexLayout &layout, MeshCache &cache,
+                     uint32_t threads)
+{
+    const std::string path = mesh_cache_path(source);
+    std::error_code error;
+    auto cacheTime = std::filesystem::last_write_time(path, error);
+    if (!error) {
+        auto sourceTime = std::filesystem::last_write_time(source, error);
+        // 与 prefer_baked 相同，源文件不存在时同样使用缓存
+        bool fresh = error || sourceTime <= cacheTime;
+        if (fresh && cache.open(path) && same_layout(cache.layout(), layout)) return true;
+        cache.close();
+    }
+
+    IndexedMesh mesh;
+    if (!load_mesh(source, mesh, threads)) return false;
+    if (mesh.components != layout.components()) {
+        std::cout << "ERROR::MESH_CACHE::LAYOUT_MISMATCH " << source << std::endl;
+        return false;
+    }
+    return write_mesh_cache(mesh, layout, path) && cache.open(path);
+}
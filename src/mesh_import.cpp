@@ -0,0 +1,835 @@
+#include "mesh_import.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "mapped_file.h"
+
+namespace {
+constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+double elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+// 把 [0, count) 分给 threads 个线程 (含调用线程)，按原子计数器取下一个
+template <typename Fn>
+void parallel_for(uint32_t count, uint32_t threads, Fn &&fn)
+{
+    std::atomic<uint32_t> next {0};
+    auto work = [&]() {
+        for (uint32_t i = next++; i < count; i = next++) fn(i);
+    };
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < std::min(threads, count); i++) workers.emplace_back(work);
+    work();
+    for (std::thread &worker : workers) worker.join();
+}
+
+// ---------------------------------------------------------------- OBJ
+
+// 一个块解析出的数据；角的索引已转为从 0 开始的绝对序号，缺少的分量为 NONE
+// 负数索引相对于块内当前的数量，块之前有多少个还不知道，先记在 fixups 里，合并时再加上
+struct ObjChunk {
+    const char *begin;
+    const char *end;
+    std::vector<float> positions;
+    std::vector<float> texcoords;
+    std::vector<float> normals;
+    std::vector<uint32_t> corners;  // 每个三角形 3 个角，每个角 (v, vt, vn)
+    struct Fixup {
+        uint32_t slot;  // corners 中的下标
+        int64_t local;  // 相对块起点的序号，可以为负 (引用之前的块)
+    };
+    std::vector<Fixup> fixups;
+    const char *error = nullptr;  // 第一处无法解析的位置
+};
+
+inline const char *skip_blank(const char *p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+// std::from_chars 不接受前导的 '+'
+inline bool parse_float(const char *&p, const char *end, float &value)
+{
+    p = skip_blank(p, end);
+    if (p < end && *p == '+') p++;
+    auto [ptr, ec] = std::from_chars(p, end, value);
+    if (ec != std::errc()) return false;
+    p = ptr;
+    return true;
+}
+
+inline bool parse_int(const char *&p, const char *end, int64_t &value)
+{
+    if (p < end && *p == '+') p++;
+    auto [ptr, ec] = std::from_chars(p, end, value);
+    if (ec != std::errc() || value == 0) return false;
+    p = ptr;
+    return true;
+}
+
+struct ObjCorner {
+    int64_t index[3];  // OBJ 中的原始索引，从 1 开始，负数为相对索引，0 表示缺少
+};
+
+void parse_obj_face(ObjChunk &chunk, const char *p, const char *end)
+{
+    // 多边形一般只有 3、4 个角，用栈上的小数组，超出时退回 vector
+    ObjCorner local[8];
+    std::vector<ObjCorner> many;
+    uint32_t count = 0;
+    while (true) {
+        p = skip_blank(p, end);
+        if (p >= end || *p == '\r' || *p == '#') break;
+        ObjCorner corner = {{0, 0, 0}};
+        if (!parse_int(p, end, corner.index[0])) {
+            chunk.error = p;
+            return;
+        }
+        for (uint32_t k = 1; k < 3 && p < end && *p == '/'; k++) {
+            p++;
+            // v//vn 中 vt 为空
+            if (p < end && *p == '/') continue;
+            if (!parse_int(p, end, corner.index[k])) {
+                chunk.error = p;
+                return;
+            }
+        }
+        if (count < 8)
+            local[count] = corner;
+        else {
+            if (many.empty()) many.assign(local, local + 8);
+            many.push_back(corner);
+        }
+        count++;
+    }
+    if (count < 3) {
+        chunk.error = p;
+        return;
+    }
+    const ObjCorner *corners = count <= 8 ? local : many.data();
+    const size_t counts[3] = {chunk.positions.size() / 3, chunk.texcoords.size() / 2,
+                              chunk.normals.size() / 3};
+    auto emit = [&](const ObjCorner &corner) {
+        for (uint32_t k = 0; k < 3; k++) {
+            int64_t index = corner.index[k];
+            if (index > 0) {
+                chunk.corners.push_back(static_cast<uint32_t>(index - 1));
+            } else if (index < 0) {
+                chunk.fixups.push_back({static_cast<uint32_t>(chunk.corners.size()),
+                                        static_cast<int64_t>(counts[k]) + index});
+                chunk.corners.push_back(k);  // 合并时按 fixup 改写，这里暂存分量号
+            } else {
+                chunk.corners.push_back(NONE);
+            }
+        }
+    };
+    // 按扇形切分：(0, i, i + 1)
+    for (uint32_t i = 1; i + 1 < count; i++) {
+        emit(corners[0]);
+        emit(corners[i]);
+        emit(corners[i + 1]);
+    }
+}
+
+void parse_obj_chunk(ObjChunk &chunk)
+{
+    const char *p = chunk.begin;
+    const char *end = chunk.end;
+    while (p < end && chunk.error == nullptr) {
+        const char *lineEnd = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (lineEnd == nullptr) lineEnd = end;
+        const char *q = skip_blank(p, lineEnd);
+        if (lineEnd - q >= 2 && (q[1] == ' ' || q[1] == '\t')) {
+            if (q[0] == 'v') {
+                float value[3];
+                q += 2;
+                if (parse_float(q, lineEnd, value[0]) && parse_float(q, lineEnd, value[1]) &&
+                    parse_float(q, lineEnd, value[2]))
+                    chunk.positions.insert(chunk.positions.end(), value, value + 3);
+                else
+                    chunk.error = q;
+            } else if (q[0] == 'f') {
+                parse_obj_face(chunk, q + 2, lineEnd);
+            }
+        } else if (lineEnd - q >= 3 && q[0] == 'v' && (q[2] == ' ' || q[2] == '\t')) {
+            // vt 的第三个分量 (w) 以及 vp 等其他语句忽略
+            float value[3];
+            const char *r = q + 3;
+            if (q[1] == 't') {
+                if (parse_float(r, lineEnd, value[0]) && parse_float(r, lineEnd, value[1]))
+                    chunk.texcoords.insert(chunk.texcoords.end(), value, value + 2);
+                else
+                    chunk.error = r;
+            } else if (q[1] == 'n') {
+                if (parse_float(r, lineEnd, value[0]) && parse_float(r, lineEnd, value[1]) &&
+                    parse_float(r, lineEnd, value[2]))
+                    chunk.normals.insert(chunk.normals.end(), value, value + 3);
+                else
+                    chunk.error = r;
+            }
+        }
+        p = lineEnd + 1;
+    }
+}
+
+// 每个位置挂一条 (vt, vn) 不同的顶点链表，多数位置只有 1 到 4 个顶点，比哈希整个三元组省内存
+struct CornerVertex {
+    uint32_t texcoord;
+    uint32_t normal;
+    uint32_t next;
+};
+
+// ---------------------------------------------------------------- JSON
+
+// glTF 只需要一个最小的 JSON 树，数字一律存为 double
+struct Json {
+    enum class Type : uint8_t { Null, Bool, Number, String, Array, Object };
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<Json> array;
+    std::vector<std::pair<std::string, Json>> object;
+
+    const Json &operator[](std::string_view key) const
+    {
+        static const Json null;
+        for (const auto &[name, value] : object) {
+            if (name == key) return value;
+        }
+        return null;
+    }
+    const Json &operator[](size_t i) const
+    {
+        static const Json null;
+        return i < array.size() ? array[i] : null;
+    }
+    bool is_null() const { return type == Type::Null; }
+    size_t size() const { return type == Type::Array ? array.size() : object.size(); }
+    double number_or(double fallback) const { return type == Type::Number ? number : fallback; }
+    uint32_t index_or(uint32_t fallback) const
+    {
+        return type == Type::Number ? static_cast<uint32_t>(number) : fallback;
+    }
+};
+
+class JsonParser {
+public:
+    JsonParser(const char *begin, const char *end) : p_(begin), end_(end) {}
+
+    bool parse(Json &value)
+    {
+        bool ok = parse_value(value, 0);
+        skip_whitespace();
+        return ok && p_ == end_;
+    }
+
+private:
+    const char *p_;
+    const char *end_;
+
+    void skip_whitespace()
+    {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) p_++;
+    }
+
+    bool literal(std::string_view word)
+    {
+        if ((size_t)(end_ - p_) < word.size() || std::string_view(p_, word.size()) != word)
+            return false;
+        p_ += word.size();
+        return true;
+    }
+
+    bool parse_string(std::string &out)
+    {
+        if (p_ >= end_ || *p_ != '"') return false;
+        p_++;
+        while (p_ < end_ && *p_ != '"') {
+            if (*p_ != '\\') {
+                out += *p_++;
+                continue;
+            }
+            if (++p_ >= end_) return false;
+            char escape = *p_++;
+            switch (escape) {
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t code = 0;
+                    if (end_ - p_ < 4) return false;
+                    auto [ptr, ec] = std::from_chars(p_, p_ + 4, code, 16);
+                    if (ec != std::errc() || ptr != p_ + 4) return false;
+                    p_ += 4;
+                    // 只需要保持名字可比较，代理对按两个 BMP 码点各自编码
+                    if (code < 0x80) {
+                        out += static_cast<char>(code);
+                    } else if (code < 0x800) {
+                        out += static_cast<char>(0xC0 | (code >> 6));
+                        out += static_cast<char>(0x80 | (code & 0x3F));
+                    } else {
+                        out += static_cast<char>(0xE0 | (code >> 12));
+                        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                        out += static_cast<char>(0x80 | (code & 0x3F));
+                    }
+                    break;
+                }
+                default: out += escape; break;
+            }
+        }
+        if (p_ >= end_) return false;
+        p_++;
+        return true;
+    }
+
+    bool parse_value(Json &value, uint32_t depth)
+    {
+        skip_whitespace();
+        if (p_ >= end_ || depth > 64) return false;
+        switch (*p_) {
+            case '{': {
+                value.type = Json::Type::Object;
+                p_++;
+                skip_whitespace();
+                if (p_ < end_ && *p_ == '}') {
+                    p_++;
+                    return true;
+                }
+                while (true) {
+                    std::pair<std::string, Json> member;
+                    skip_whitespace();
+                    if (!parse_string(member.first)) return false;
+                    skip_whitespace();
+                    if (p_ >= end_ || *p_++ != ':') return false;
+                    if (!parse_value(member.second, depth + 1)) return false;
+                    value.object.push_back(std::move(member));
+                    skip_whitespace();
+                    if (p_ < end_ && *p_ == ',') {
+                        p_++;
+                        continue;
+                    }
+                    return p_ < end_ && *p_++ == '}';
+                }
+            }
+            case '[': {
+                value.type = Json::Type::Array;
+                p_++;
+                skip_whitespace();
+                if (p_ < end_ && *p_ == ']') {
+                    p_++;
+                    return true;
+                }
+                while (true) {
+                    value.array.emplace_back();
+                    if (!parse_value(value.array.back(), depth + 1)) return false;
+                    skip_whitespace();
+                    if (p_ < end_ && *p_ == ',') {
+                        p_++;
+                        continue;
+                    }
+                    return p_ < end_ && *p_++ == ']';
+                }
+            }
+            case '"':
+                value.type = Json::Type::String;
+                return parse_string(value.string);
+            case 't':
+                value.type = Json::Type::Bool;
+                value.boolean = true;
+                return literal("true");
+            case 'f':
+                value.type = Json::Type::Bool;
+                return literal("false");
+            case 'n':
+                return literal("null");
+            default: {
+                value.type = Json::Type::Number;
+                auto [ptr, ec] = std::from_chars(p_, end_, value.number);
+                if (ec != std::errc()) return false;
+                p_ = ptr;
+                return true;
+            }
+        }
+    }
+};
+
+// ---------------------------------------------------------------- glTF
+
+struct GltfBuffer {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+};
+
+struct Gltf {
+    Json json;
+    std::vector<GltfBuffer> buffers;
+    std::vector<std::unique_ptr<MappedFile>> files;
+};
+
+uint32_t component_size(uint32_t componentType)
+{
+    switch (componentType) {
+        case 5120:  // BYTE
+        case 5121: return 1;  // UNSIGNED_BYTE
+        case 5122:  // SHORT
+        case 5123: return 2;  // UNSIGNED_SHORT
+        case 5125:  // UNSIGNED_INT
+        case 5126: return 4;  // FLOAT
+    }
+    return 0;
+}
+
+uint32_t type_components(const std::string &type)
+{
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    return 0;
+}
+
+// accessor 在缓冲中的位置，越界或不支持时返回 false
+struct AccessorView {
+    const uint8_t *data = nullptr;
+    size_t stride = 0;
+    size_t count = 0;
+    uint32_t componentType = 0;
+    uint32_t components = 0;
+    bool normalized = false;
+};
+
+bool accessor_view(const Gltf &gltf, uint32_t index, AccessorView &view)
+{
+    const Json &accessor = gltf.json["accessors"][index];
+    if (accessor.is_null() || !accessor["sparse"].is_null()) return false;
+    view.count = static_cast<size_t>(accessor["count"].number_or(0));
+    view.componentType = accessor["componentType"].index_or(0);
+    view.components = type_components(accessor["type"].string);
+    view.normalized = accessor["normalized"].boolean;
+    const uint32_t elementSize = component_size(view.componentType) * view.components;
+    if (elementSize == 0 || view.count == 0) return false;
+
+    const Json &bufferView = gltf.json["bufferViews"][accessor["bufferView"].index_or(NONE)];
+    if (bufferView.is_null()) return false;
+    const uint32_t buffer = bufferView["buffer"].index_or(NONE);
+    if (buffer >= gltf.buffers.size()) return false;
+    const size_t viewOffset = static_cast<size_t>(bufferView["byteOffset"].number_or(0));
+    const size_t viewLength = static_cast<size_t>(bufferView["byteLength"].number_or(0));
+    const size_t offset = static_cast<size_t>(accessor["byteOffset"].number_or(0));
+    view.stride = static_cast<size_t>(bufferView["byteStride"].number_or(elementSize));
+    if (viewOffset + viewLength > gltf.buffers[buffer].size ||
+        offset + view.stride * (view.count - 1) + elementSize > viewLength)
+        return false;
+    view.data = gltf.buffers[buffer].data + viewOffset + offset;
+    return true;
+}
+
+// 读取 components 个分量为 float，整数按 normalized 的规则转换 (纹理坐标常用 unorm8/16)
+float read_component(const uint8_t *p, uint32_t componentType)
+{
+    switch (componentType) {
+        case 5120: return std::max(static_cast<int8_t>(*p) / 127.0f, -1.0f);
+        case 5121: return *p / 255.0f;
+        case 5122: {
+            int16_t value;
+            std::memcpy(&value, p, 2);
+            return std::max(value / 32767.0f, -1.0f);
+        }
+        case 5123: {
+            uint16_t value;
+            std::memcpy(&value, p, 2);
+            return value / 65535.0f;
+        }
+        case 5126: {
+            float value;
+            std::memcpy(&value, p, 4);
+            return value;
+        }
+    }
+    return 0.0f;
+}
+
+uint32_t read_index(const uint8_t *p, uint32_t componentType)
+{
+    if (componentType == 5121) return *p;
+    if (componentType == 5123) {
+        uint16_t value;
+        std::memcpy(&value, p, 2);
+        return value;
+    }
+    uint32_t value;
+    std::memcpy(&value, p, 4);
+    return value;
+}
+
+glm::mat4 node_transform(const Json &node)
+{
+    const Json &matrix = node["matrix"];
+    if (matrix.size() == 16) {
+        glm::mat4 result(1.0f);
+        for (uint32_t c = 0; c < 4; c++) {
+            for (uint32_t r = 0; r < 4; r++)
+                result[c][r] = static_cast<float>(matrix[c * 4 + r].number);
+        }
+        return result;
+    }
+    const Json &t = node["translation"], &r = node["rotation"], &s = node["scale"];
+    glm::mat4 result(1.0f);
+    if (t.size() == 3)
+        result = glm::translate(result, glm::vec3(t[0].number, t[1].number, t[2].number));
+    // glTF 的四元数按 (x, y, z, w) 存放
+    if (r.size() == 4)
+        result = result * glm::mat4_cast(glm::quat(static_cast<float>(r[3].number),
+                                                   static_cast<float>(r[0].number),
+                                                   static_cast<float>(r[1].number),
+                                                   static_cast<float>(r[2].number)));
+    if (s.size() == 3)
+        result = glm::scale(result, glm::vec3(s[0].number, s[1].number, s[2].number));
+    return result;
+}
+
+bool append_primitive(const Gltf &gltf, const Json &primitive, const glm::mat4 &transform,
+                      IndexedMesh &mesh)
+{
+    // 只合并三角形列表 (mode 4，缺省值)
+    if (primitive["mode"].index_or(4) != 4) return true;
+    const Json &attributes = primitive["attributes"];
+    AccessorView positions, normals, texcoords, indices;
+    if (!accessor_view(gltf, attributes["POSITION"].index_or(NONE), positions) ||
+        positions.componentType != 5126 || positions.components != 3)
+        return false;
+    // 分量数不对的法线、纹理坐标按缺失处理，否则逐顶点读取会越过元素的末尾
+    const bool hasNormals = accessor_view(gltf, attributes["NORMAL"].index_or(NONE), normals) &&
+                            normals.count == positions.count && normals.components == 3;
+    const bool hasTexcoords =
+        accessor_view(gltf, attributes["TEXCOORD_0"].index_or(NONE), texcoords) &&
+        texcoords.count == positions.count && texcoords.components >= 2;
+
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+    const uint32_t base = static_cast<uint32_t>(mesh.vertex_count());
+    mesh.vertices.reserve(mesh.vertices.size() + positions.count * 8);
+    for (size_t i = 0; i < positions.count; i++) {
+        const uint8_t *p = positions.data + i * positions.stride;
+        glm::vec3 position(read_component(p, 5126), read_component(p + 4, 5126),
+                           read_component(p + 8, 5126));
+        position = glm::vec3(transform * glm::vec4(position, 1.0f));
+        glm::vec3 normal(0.0f);
+        if (hasNormals) {
+            const uint8_t *n = normals.data + i * normals.stride;
+            const uint32_t size = component_size(normals.componentType);
+            normal = glm::vec3(read_component(n, normals.componentType),
+                               read_component(n + size, normals.componentType),
+                               read_component(n + size * 2, normals.componentType));
+            normal = normalMatrix * normal;
+            float length = glm::length(normal);
+            if (length > 0.0f) normal = normal / length;
+        }
+        float u = 0.0f, v = 0.0f;
+        if (hasTexcoords) {
+            const uint8_t *t = texcoords.data + i * texcoords.stride;
+            u = read_component(t, texcoords.componentType);
+            v = read_component(t + component_size(texcoords.componentType),
+                               texcoords.componentType);
+        }
+        mesh.vertices.insert(mesh.vertices.end(), {position.x, position.y, position.z, normal.x,
+                                                   normal.y, normal.z, u, v});
+    }
+
+    const size_t first = mesh.indices.size();
+    // 声明了 indices 却解析不出来的是损坏的文件，不能当作无索引的三角形列表
+    if (!primitive["indices"].is_null()) {
+        if (!accessor_view(gltf, primitive["indices"].index_or(NONE), indices) ||
+            indices.components != 1 || indices.componentType == 5126)
+            return false;
+        for (size_t i = 0; i < indices.count; i++) {
+            uint32_t index = read_index(indices.data + i * indices.stride, indices.componentType);
+            if (index >= positions.count) return false;
+            mesh.indices.push_back(base + index);
+        }
+    } else {
+        for (size_t i = 0; i < positions.count; i++)
+            mesh.indices.push_back(base + static_cast<uint32_t>(i));
+    }
+    mesh.indices.resize(first + (mesh.indices.size() - first) / 3 * 3);
+    // 行列式为负的变换会把卷绕翻转过来，交换每个三角形的两个角恢复逆时针
+    if (glm::determinant(glm::mat3(transform)) < 0.0f) {
+        for (size_t i = first; i < mesh.indices.size(); i += 3)
+            std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+    }
+    return true;
+}
+
+bool append_node(const Gltf &gltf, uint32_t index, const glm::mat4 &parent, uint32_t depth,
+                 IndexedMesh &mesh)
+{
+    const Json &node = gltf.json["nodes"][index];
+    if (node.is_null() || depth > 64) return false;
+    const glm::mat4 transform = parent * node_transform(node);
+    const Json &primitives = gltf.json["meshes"][node["mesh"].index_or(NONE)]["primitives"];
+    for (size_t i = 0; i < primitives.size(); i++) {
+        if (!append_primitive(gltf, primitives[i], transform, mesh)) return false;
+    }
+    const Json &children = node["children"];
+    for (size_t i = 0; i < children.size(); i++) {
+        if (!append_node(gltf, children[i].index_or(NONE), transform, depth + 1, mesh))
+            return false;
+    }
+    return true;
+}
+}  // namespace
+
+bool load_obj(const std::string &path, IndexedMesh &mesh, uint32_t threads,
+              MeshImportStats *stats)
+{
+    auto start = std::chrono::steady_clock::now();
+    MappedFile file;
+    if (!file.open(path)) return false;
+    const char *data = reinterpret_cast<const char *>(file.data());
+    const size_t size = file.size();
+
+    // 每块至少 1 MiB，块数是线程数的 4 倍左右，行长不一时各线程的负载也比较均匀
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    constexpr size_t MIN_CHUNK = 1 << 20;
+    const uint32_t chunkCount =
+        static_cast<uint32_t>(std::clamp<size_t>(size / MIN_CHUNK, 1, threads * 4));
+    std::vector<ObjChunk> chunks(chunkCount);
+    const char *begin = data;
+    for (uint32_t i = 0; i < chunkCount; i++) {
+        const char *end = std::max(begin, data + size * (i + 1) / chunkCount);
+        if (i + 1 < chunkCount) {
+            auto newline = static_cast<const char *>(std::memchr(end, '\n', data + size - end));
+            end = newline == nullptr ? data + size : newline + 1;
+        }
+        chunks[i].begin = begin;
+        chunks[i].end = end;
+        begin = end;
+    }
+    parallel_for(chunkCount, threads, [&](uint32_t i) { parse_obj_chunk(chunks[i]); });
+    const double parseNs = elapsed_ns(start);
+    for (const ObjChunk &chunk : chunks) {
+        if (chunk.error == nullptr) continue;
+        std::cout << "ERROR::MESH_IMPORT::OBJ_PARSE " << path << " at byte " << chunk.error - data
+                  << std::endl;
+        return false;
+    }
+
+    // 合并：各块的属性依次拼接，块内的相对索引加上之前各块的数量
+    auto build = std::chrono::steady_clock::now();
+    std::vector<size_t> bases(chunkCount * 3 + 3, 0);
+    for (uint32_t i = 0; i < chunkCount; i++) {
+        bases[(i + 1) * 3 + 0] = bases[i * 3 + 0] + chunks[i].positions.size() / 3;
+        bases[(i + 1) * 3 + 1] = bases[i * 3 + 1] + chunks[i].texcoords.size() / 2;
+        bases[(i + 1) * 3 + 2] = bases[i * 3 + 2] + chunks[i].normals.size() / 3;
+    }
+    const size_t counts[3] = {bases[chunkCount * 3], bases[chunkCount * 3 + 1],
+                              bases[chunkCount * 3 + 2]};
+    std::vector<float> positions, texcoords, normals;
+    positions.reserve(counts[0] * 3);
+    texcoords.reserve(counts[1] * 2);
+    normals.reserve(counts[2] * 3);
+    std::atomic<bool> outOfRange {false};
+    parallel_for(chunkCount, threads, [&](uint32_t i) {
+        ObjChunk &chunk = chunks[i];
+        for (const ObjChunk::Fixup &fixup : chunk.fixups) {
+            uint32_t k = chunk.corners[fixup.slot];
+            int64_t index = static_cast<int64_t>(bases[i * 3 + k]) + fixup.local;
+            chunk.corners[fixup.slot] = index < 0 ? NONE - 1 : static_cast<uint32_t>(index);
+        }
+        // v 总是存在，NONE 只会出现在 vt、vn 上；相对索引越过文件开头时为 NONE - 1
+        for (size_t c = 0; c < chunk.corners.size(); c++) {
+            uint32_t index = chunk.corners[c];
+            if (index != NONE && index >= counts[c % 3]) outOfRange = true;
+        }
+    });
+    if (outOfRange) {
+        std::cout << "ERROR::MESH_IMPORT::OBJ_INDEX_OUT_OF_RANGE " << path << std::endl;
+        return false;
+    }
+    for (const ObjChunk &chunk : chunks) {
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+    }
+
+    // (v, vt, vn) 相同的角共用一个顶点
+    size_t cornerCount = 0;
+    for (const ObjChunk &chunk : chunks) cornerCount += chunk.corners.size() / 3;
+    std::vector<uint32_t> heads(counts[0], NONE);
+    std::vector<CornerVertex> vertices;
+    vertices.reserve(counts[0] + counts[0] / 4);
+    mesh = IndexedMesh();
+    mesh.components = 8;
+    mesh.indices.reserve(cornerCount);
+    bool missingNormals = false;
+    for (ObjChunk &chunk : chunks) {
+        for (size_t c = 0; c < chunk.corners.size(); c += 3) {
+            const uint32_t v = chunk.corners[c];
+            const uint32_t vt = chunk.corners[c + 1];
+            const uint32_t vn = chunk.corners[c + 2];
+            uint32_t vertex = heads[v];
+            while (vertex != NONE &&
+                   (vertices[vertex].texcoord != vt || vertices[vertex].normal != vn))
+                vertex = vertices[vertex].next;
+            if (vertex == NONE) {
+                vertex = static_cast<uint32_t>(vertices.size());
+                vertices.push_back({vt, vn, heads[v]});
+                heads[v] = vertex;
+                const float *position = &positions[(size_t)v * 3];
+                mesh.vertices.insert(mesh.vertices.end(), position, position + 3);
+                if (vn != NONE)
+                    mesh.vertices.insert(mesh.vertices.end(), &normals[(size_t)vn * 3],
+                                         &normals[(size_t)vn * 3] + 3);
+                else
+                    mesh.vertices.insert(mesh.vertices.end(), {0.0f, 0.0f, 0.0f});
+                missingNormals = missingNormals || vn == NONE;
+                if (vt != NONE)
+                    mesh.vertices.insert(mesh.vertices.end(), &texcoords[(size_t)vt * 2],
+                                         &texcoords[(size_t)vt * 2] + 2);
+                else
+                    mesh.vertices.insert(mesh.vertices.end(), {0.0f, 0.0f});
+            }
+            mesh.indices.push_back(vertex);
+        }
+        // 已经用完的块立即释放，峰值内存不必同时容纳所有块与结果
+        chunk = ObjChunk();
+    }
+    if (missingNormals) generate_normals(mesh, true);
+
+    if (stats != nullptr) {
+        stats->fileBytes = size;
+        stats->parseNs = parseNs;
+        stats->buildNs = elapsed_ns(build);
+        stats->threads = std::min(threads, chunkCount);
+        stats->chunks = chunkCount;
+    }
+    return true;
+}
+
+bool load_gltf(const std::string &path, IndexedMesh &mesh, MeshImportStats *stats)
+{
+    auto start = std::chrono::steady_clock::now();
+    Gltf gltf;
+    auto file = std::make_unique<MappedFile>();
+    if (!file->open(path)) return false;
+    const uint8_t *data = file->data();
+    const size_t size = file->size();
+
+    // .glb：12 字节文件头，之后是 JSON 块与可选的 BIN 块，每块以 (长度, 类型) 开头
+    const char *json = reinterpret_cast<const char *>(data);
+    size_t jsonSize = size;
+    GltfBuffer binary;
+    uint32_t header[3] = {};
+    uint32_t chunk[2] = {};
+    if (size >= 12) std::memcpy(header, data, 12);
+    if (header[0] == 0x46546C67) {  // "glTF"
+        if (size >= 20) std::memcpy(chunk, data + 12, 8);
+        // 第一块必须是 JSON
+        if (header[1] != 2 || chunk[1] != 0x4E4F534A || 20 + (size_t)chunk[0] > size) {
+            std::cout << "ERROR::MESH_IMPORT::INVALID_GLB " << path << std::endl;
+            return false;
+        }
+        json = reinterpret_cast<const char *>(data + 20);
+        jsonSize = chunk[0];
+        size_t next = 20 + (size_t)chunk[0];
+        if (next + 8 <= size) {
+            std::memcpy(chunk, data + next, 8);
+            if (chunk[1] == 0x004E4942 && next + 8 + chunk[0] <= size)
+                binary = {data + next + 8, chunk[0]};
+        }
+    }
+    if (!JsonParser(json, json + jsonSize).parse(gltf.json)) {
+        std::cout << "ERROR::MESH_IMPORT::INVALID_JSON " << path << std::endl;
+        return false;
+    }
+    gltf.files.push_back(std::move(file));
+
+    // 没有 uri 的缓冲是 .glb 的 BIN 块，其余为相对于 .gltf 所在目录的文件
+    const std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    const Json &buffers = gltf.json["buffers"];
+    for (size_t i = 0; i < buffers.size(); i++) {
+        const Json &uri = buffers[i]["uri"];
+        if (uri.is_null()) {
+            gltf.buffers.push_back(binary);
+            continue;
+        }
+        if (uri.string.starts_with("data:")) {
+            std::cout << "ERROR::MESH_IMPORT::DATA_URI_UNSUPPORTED " << path << std::endl;
+            return false;
+        }
+        auto buffer = std::make_unique<MappedFile>();
+        if (!buffer->open((directory / uri.string).string())) return false;
+        gltf.buffers.push_back({buffer->data(), buffer->size()});
+        gltf.files.push_back(std::move(buffer));
+    }
+
+    mesh = IndexedMesh();
+    mesh.components = 8;
+    bool ok = true;
+    const Json &scenes = gltf.json["scenes"];
+    if (scenes.size() > 0) {
+        const Json &nodes = scenes[gltf.json["scene"].index_or(0)]["nodes"];
+        for (size_t i = 0; i < nodes.size() && ok; i++)
+            ok = append_node(gltf, nodes[i].index_or(NONE), glm::mat4(1.0f), 0, mesh);
+    } else {
+        // 没有场景时按原样合并所有网格
+        const Json &meshes = gltf.json["meshes"];
+        for (size_t m = 0; m < meshes.size() && ok; m++) {
+            const Json &primitives = meshes[m]["primitives"];
+            for (size_t i = 0; i < primitives.size() && ok; i++)
+                ok = append_primitive(gltf, primitives[i], glm::mat4(1.0f), mesh);
+        }
+    }
+    if (!ok) {
+        std::cout << "ERROR::MESH_IMPORT::UNSUPPORTED_GLTF_PRIMITIVE " << path << std::endl;
+        return false;
+    }
+    const double parseNs = elapsed_ns(start);
+    auto build = std::chrono::steady_clock::now();
+    generate_normals(mesh, true);
+
+    if (stats != nullptr) {
+        stats->fileBytes = size;
+        for (size_t i = 1; i < gltf.files.size(); i++) stats->fileBytes += gltf.files[i]->size();
+        stats->parseNs = parseNs;
+        stats->buildNs = elapsed_ns(build);
+        stats->threads = 1;
+        stats->chunks = 1;
+    }
+    return true;
+}
+
+bool load_mesh(const std::string &path, IndexedMesh &mesh, uint32_t threads,
+               MeshImportStats *stats)
+{
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension == ".obj") return load_obj(path, mesh, threads, stats);
+    if (extension == ".gltf" || extension == ".glb") return load_gltf(path, mesh, stats);
+    std::cout << "ERROR::MESH_IMPORT::UNKNOWN_FORMAT " << path << std::endl;
+    return false;
+}
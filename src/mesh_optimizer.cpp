@@ -0,0 +1,354 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+namespace {
+constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+// Forsyth, "Linear-Speed Vertex Cache Optimisation" 的参数：模拟 32 项的 LRU 缓存，
+// 刚用过的 3 个顶点得分略低，避免总是沿着一条细长的带子走；剩余三角形少的顶点加分，尽早用完
+constexpr uint32_t LRU_SIZE = 32;
+constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float CACHE_DECAY_POWER = 1.5f;
+constexpr float VALENCE_BOOST_SCALE = 2.0f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+constexpr uint32_t VALENCE_TABLE_SIZE = 64;
+
+struct ScoreTables {
+    float cache[LRU_SIZE];
+    float valence[VALENCE_TABLE_SIZE];
+
+    ScoreTables()
+    {
+        for (uint32_t i = 0; i < LRU_SIZE; i++) {
+            cache[i] = i < 3 ? LAST_TRIANGLE_SCORE
+                             : std::pow(1.0f - (i - 3) / float(LRU_SIZE - 3), CACHE_DECAY_POWER);
+        }
+        valence[0] = 0.0f;
+        for (uint32_t i = 1; i < VALENCE_TABLE_SIZE; i++)
+            valence[i] = VALENCE_BOOST_SCALE * std::pow(float(i), -VALENCE_BOOST_POWER);
+    }
+};
+
+// 不再被任何剩余三角形引用的顶点得分为 -1，cachePosition 为 -1 表示不在缓存中
+float vertex_score(const ScoreTables &tables, int32_t cachePosition, uint32_t remaining)
+{
+    if (remaining == 0) return -1.0f;
+    float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+    if (remaining < VALENCE_TABLE_SIZE) return score + tables.valence[remaining];
+    return score + VALENCE_BOOST_SCALE * std::pow(float(remaining), -VALENCE_BOOST_POWER);
+}
+
+// 以时间戳模拟 FIFO：每次未命中时间戳加一，顶点最后一次载入后的未命中次数不少于 cacheSize 即被挤出
+class FifoCache {
+public:
+    FifoCache(size_t entries, uint32_t size) : stamps_(entries, 0), size_(size), time_(size + 1) {}
+
+    // 返回 true 表示未命中，随即载入
+    bool load(uint32_t entry)
+    {
+        if (time_ - stamps_[entry] < size_) return false;
+        stamps_[entry] = time_++;
+        return true;
+    }
+
+private:
+    std::vector<uint32_t> stamps_;
+    uint32_t size_;
+    uint32_t time_;
+};
+
+glm::vec3 position(const IndexedMesh &mesh, uint32_t index)
+{
+    const float *vertex = &mesh.vertices[(size_t)index * mesh.components];
+    return glm::vec3(vertex[0], vertex[1], vertex[2]);
+}
+}  // namespace
+
+VertexCacheStats analyze_vertex_cache(const IndexedMesh &mesh, uint32_t cacheSize)
+{
+    VertexCacheStats stats;
+    const size_t vertexCount = mesh.vertex_count();
+    const size_t triangleCount = mesh.indices.size() / 3;
+    if (vertexCount == 0 || triangleCount == 0) return stats;
+
+    constexpr size_t LINE_SIZE = 64;
+    constexpr uint32_t LINE_CACHE_SIZE = 64;  // 4 KiB，与顶点缓存一样按 FIFO 替换
+    const size_t vertexBytes = mesh.components * sizeof(float);
+    const size_t bufferBytes = vertexCount * vertexBytes;
+    FifoCache vertices(vertexCount, cacheSize);
+    FifoCache lines((bufferBytes + LINE_SIZE - 1) / LINE_SIZE, LINE_CACHE_SIZE);
+    size_t transformed = 0, fetched = 0;
+    for (uint32_t index : mesh.indices) {
+        if (!vertices.load(index)) continue;
+        transformed++;
+        // 只有没命中 post-transform 缓存的顶点才需要读取
+        size_t begin = index * vertexBytes, end = begin + vertexBytes;
+        for (size_t line = begin / LINE_SIZE; line <= (end - 1) / LINE_SIZE; line++) {
+            if (lines.load(static_cast<uint32_t>(line))) fetched += LINE_SIZE;
+        }
+    }
+    stats.acmr = (double)transformed / triangleCount;
+    stats.atvr = (double)transformed / vertexCount;
+    stats.overfetch = (double)fetched / bufferBytes;
+    return stats;
+}
+
+void optimize_vertex_cache(IndexedMesh &mesh)
+{
+    static const ScoreTables tables;
+    const size_t vertexCount = mesh.vertex_count();
+    const size_t triangleCount = mesh.indices.size() / 3;
+    if (triangleCount == 0) return;
+    const std::vector<uint32_t> &indices = mesh.indices;
+
+    // 每个顶点引用它的三角形，[offsets[v], offsets[v] + remaining[v]) 是还没输出的那些
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (uint32_t index : indices) remaining[index]++;
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + remaining[v];
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+        adjacency[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+    std::vector<int32_t> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScore[v] = vertex_score(tables, -1, remaining[v]);
+    std::vector<float> triangleScore(triangleCount);
+    uint32_t best = NONE;
+    for (size_t t = 0; t < triangleCount; t++) {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] +
+                           vertexScore[indices[t * 3 + 2]];
+        if (best == NONE || triangleScore[t] > triangleScore[best])
+            best = static_cast<uint32_t>(t);
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    std::vector<uint32_t> cache, nextCache;
+    cache.reserve(LRU_SIZE + 3);
+    nextCache.reserve(LRU_SIZE + 3);
+    size_t cursor = 0;
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        // 缓存里的顶点都没有剩余三角形了：从输入顺序中下一个没输出的三角形重新开始
+        if (best == NONE) {
+            while (emitted[cursor]) cursor++;
+            best = static_cast<uint32_t>(cursor);
+        }
+        const uint32_t *triangle = &indices[(size_t)best * 3];
+        output.insert(output.end(), triangle, triangle + 3);
+        emitted[best] = true;
+        for (uint32_t c = 0; c < 3; c++) {
+            uint32_t v = triangle[c];
+            uint32_t *begin = &adjacency[offsets[v]], *end = begin + remaining[v];
+            std::swap(*std::find(begin, end, best), *(end - 1));
+            remaining[v]--;
+        }
+
+        // 新三角形的顶点移到 LRU 最前，超出 LRU_SIZE 的是被挤出的顶点，同样要更新得分
+        nextCache.assign(triangle, triangle + 3);
+        for (uint32_t v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) nextCache.push_back(v);
+        }
+        const size_t cached = std::min<size_t>(nextCache.size(), LRU_SIZE);
+        for (size_t i = 0; i < nextCache.size(); i++)
+            cachePosition[nextCache[i]] = i < cached ? static_cast<int32_t>(i) : -1;
+
+        for (uint32_t v : nextCache) {
+            float score = vertex_score(tables, cachePosition[v], remaining[v]);
+            float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+            for (uint32_t i = offsets[v]; i < offsets[v] + remaining[v]; i++)
+                triangleScore[adjacency[i]] += delta;
+        }
+        // 只有缓存中顶点的三角形得分变高了，最佳的下一个三角形只可能在它们之中
+        best = NONE;
+        for (size_t i = 0; i < cached; i++) {
+            uint32_t v = nextCache[i];
+            for (uint32_t j = offsets[v]; j < offsets[v] + remaining[v]; j++) {
+                uint32_t t = adjacency[j];
+                if (best == NONE || triangleScore[t] > triangleScore[best]) best = t;
+            }
+        }
+        nextCache.resize(cached);
+        std::swap(cache, nextCache);
+    }
+    mesh.indices = std::move(output);
+}
+
+void optimize_overdraw(IndexedMesh &mesh, float threshold)
+{
+    const size_t triangleCount = mesh.indices.size() / 3;
+    if (triangleCount == 0 || mesh.components < 3) return;
+    const std::vector<uint32_t> &indices = mesh.indices;
+
+    // 每个三角形在 16 项 FIFO 中未命中的顶点数
+    constexpr uint32_t CACHE_SIZE = 16;
+    FifoCache cache(mesh.vertex_count(), CACHE_SIZE);
+    std::vector<uint8_t> misses(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (uint32_t c = 0; c < 3; c++) misses[t] += cache.load(indices[t * 3 + c]);
+    }
+
+    // 三个顶点全未命中的三角形之前没有可共用的缓存，在这里切开不增加任何变换；
+    // 每一段内部再在 (几乎) 冷启动的三角形处切开，只要切出的前一簇的 ACMR 不超过整段的 threshold 倍
+    std::vector<size_t> clusters;
+    size_t hardBegin = 0;
+    for (size_t t = 1; t <= triangleCount; t++) {
+        if (t < triangleCount && misses[t] < 3) continue;
+        size_t hardMisses = 0;
+        for (size_t i = hardBegin; i < t; i++) hardMisses += misses[i];
+        const double limit = threshold * (double)hardMisses / (t - hardBegin);
+        size_t begin = hardBegin, running = 0;
+        clusters.push_back(begin);
+        for (size_t i = hardBegin; i < t; i++) {
+            if (i > begin && misses[i] >= 2 && (double)running / (i - begin) <= limit) {
+                clusters.push_back(i);
+                begin = i;
+                running = 0;
+            }
+            running += misses[i];
+        }
+        hardBegin = t;
+    }
+    clusters.push_back(triangleCount);
+
+    // 簇的朝向：面积加权的中心相对整个网格中心、沿面积加权法线方向的距离，越朝外越先画
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    const size_t clusterCount = clusters.size() - 1;
+    std::vector<glm::vec3> centers(clusterCount, glm::vec3(0.0f)), normals(clusterCount);
+    std::vector<float> areas(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; c++) {
+        glm::vec3 normal(0.0f);
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            glm::vec3 p0 = position(mesh, indices[t * 3]), p1 = position(mesh, indices[t * 3 + 1]),
+                      p2 = position(mesh, indices[t * 3 + 2]);
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(n) * 0.5f;
+            centers[c] += (p0 + p1 + p2) * (area / 3.0f);
+            areas[c] += area;
+            normal += n;
+        }
+        meshCenter += centers[c];
+        meshArea += areas[c];
+        if (areas[c] > 0.0f) centers[c] /= areas[c];
+        float length = glm::length(normal);
+        normals[c] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+    }
+    if (meshArea > 0.0f) meshCenter /= meshArea;
+    std::vector<float> keys(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+        keys[c] = glm::dot(centers[c] - meshCenter, normals[c]);
+    std::vector<size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (size_t c : order) {
+        output.insert(output.end(), indices.begin() + clusters[c] * 3,
+                      indices.begin() + clusters[c + 1] * 3);
+    }
+    mesh.indices = std::move(output);
+}
+
+void optimize_vertex_fetch(IndexedMesh &mesh)
+{
+    std::vector<uint32_t> remap(mesh.vertex_count(), NONE);
+    std::vector<float> vertices;
+    vertices.reserve(mesh.vertices.size());
+    uint32_t next = 0;
+    for (uint32_t &index : mesh.indices) {
+        if (remap[index] == NONE) {
+            remap[index] = next++;
+            const float *vertex = &mesh.vertices[(size_t)index * mesh.components];
+            vertices.insert(vertices.end(), vertex, vertex + mesh.components);
+        }
+        index = remap[index];
+    }
+    mesh.vertices = std::move(vertices);
+}
+
+void optimize_mesh(IndexedMesh &mesh)
+{
+    optimize_vertex_cache(mesh);
+    optimize_overdraw(mesh);
+    optimize_vertex_fetch(mesh);
+}
+
+float simplify_clustered(IndexedMesh &mesh, uint32_t gridSize)
+{
+    if (mesh.indices.empty() || mesh.components < 3 || gridSize == 0) return 0.0f;
+    glm::vec3 lower = position(mesh, mesh.indices[0]), upper = lower;
+    for (uint32_t index : mesh.indices) {
+        lower = glm::min(lower, position(mesh, index));
+        upper = glm::max(upper, position(mesh, index));
+    }
+    const glm::vec3 extent = upper - lower;
+    const float cellSize = std::max({extent.x, extent.y, extent.z}) / gridSize;
+    if (cellSize <= 0.0f) return 0.0f;
+
+    // 格子坐标每轴 21 位拼成 64 位键；哈希表里只记录每格离中心最近的顶点
+    const uint64_t NO_CELL = ~0ull;
+    std::vector<uint64_t> cells(mesh.vertex_count(), NO_CELL);
+    std::unordered_map<uint64_t, uint32_t> representatives;
+    auto distance_to_centre = [&](uint32_t vertex, const uint32_t coordinate[3]) {
+        glm::vec3 centre(lower.x + (coordinate[0] + 0.5f) * cellSize,
+                         lower.y + (coordinate[1] + 0.5f) * cellSize,
+                         lower.z + (coordinate[2] + 0.5f) * cellSize);
+        glm::vec3 offset = position(mesh, vertex) - centre;
+        return glm::dot(offset, offset);
+    };
+    for (uint32_t index : mesh.indices) {
+        if (cells[index] != NO_CELL) continue;
+        const glm::vec3 p = (position(mesh, index) - lower) / cellSize;
+        uint32_t coordinate[3];
+        for (uint32_t k = 0; k < 3; k++)
+            coordinate[k] = std::min(static_cast<uint32_t>(std::max(p[k], 0.0f)), gridSize - 1);
+        const uint64_t key = coordinate[0] | (uint64_t)coordinate[1] << 21 |
+                             (uint64_t)coordinate[2] << 42;
+        cells[index] = key;
+        auto [it, inserted] = representatives.try_emplace(key, index);
+        if (!inserted &&
+            distance_to_centre(index, coordinate) < distance_to_centre(it->second, coordinate))
+            it->second = index;
+    }
+
+    // 三角形按最小的索引开头旋转 (卷绕不变)，排序后相邻的重复三角形只保留一个
+    float error = 0.0f;
+    std::vector<std::array<uint32_t, 3>> triangles;
+    triangles.reserve(mesh.indices.size() / 3);
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        std::array<uint32_t, 3> triangle;
+        for (uint32_t c = 0; c < 3; c++) {
+            uint32_t index = mesh.indices[i + c];
+            triangle[c] = representatives[cells[index]];
+            error = std::max(error, glm::length(position(mesh, index) -
+                                                position(mesh, triangle[c])));
+        }
+        if (triangle[0] == triangle[1] || triangle[1] == triangle[2] ||
+            triangle[0] == triangle[2])
+            continue;
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()),
+                    triangle.end());
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+    mesh.indices.clear();
+    for (const std::array<uint32_t, 3> &triangle : triangles)
+        mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+    return error;
+}
@@ -0,0 +1,348 @@
+#include "mip_generator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_SSE2 1
+#endif
+
+// AVX2 不在编译选项中打开，只对单个函数启用，运行时确认 CPU 支持后才会调用
+#if defined(MIP_SSE2) && (defined(__x86_64__) || defined(_M_X64))
+#include <immintrin.h>
+#define MIP_AVX2 1
+#if defined(__GNUC__) || defined(__clang__)
+#define MIP_AVX2_TARGET __attribute__((target("avx2,fma")))
+#else
+#include <intrin.h>
+#define MIP_AVX2_TARGET
+#endif
+#endif
+
+namespace {
+constexpr double PI = 3.14159265358979323846;
+// sRGB 编码表的项数，足以区分最暗处相邻的两个 8 bit 值
+constexpr uint32_t SRGB_ENCODE_SIZE = 16384;
+
+// 可分离的缩小一半的滤波核：输出像素 x 的第 k 个抽头对应源像素 2x + offset + k，越界时取边缘像素
+struct Kernel {
+    int32_t offset;
+    uint32_t taps;
+    float weights[8];
+};
+
+// 第一类零阶修正 Bessel 函数，级数展开
+double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+Kernel make_kernel(MipFilter filter)
+{
+    Kernel kernel = {};
+    if (filter == MipFilter::Box) {
+        kernel.offset = 0;
+        kernel.taps = 2;
+        kernel.weights[0] = kernel.weights[1] = 0.5f;
+        return kernel;
+    }
+    // 目标像素中心在源坐标 2x + 1，8 个抽头覆盖目标像素两侧各 1.75 个像素，窗口半径取 2
+    constexpr double ALPHA = 4.0;
+    constexpr double RADIUS = 2.0;
+    kernel.offset = -3;
+    kernel.taps = 8;
+    double weights[8], sum = 0.0;
+    for (uint32_t k = 0; k < 8; k++) {
+        double t = (k - 3.5) / 2.0;  // 以目标像素为单位的距离
+        double sinc = std::sin(PI * t) / (PI * t);
+        double x = t / RADIUS;
+        double window = bessel_i0(ALPHA * std::sqrt(1.0 - x * x)) / bessel_i0(ALPHA);
+        weights[k] = sinc * window;
+        sum += weights[k];
+    }
+    for (uint32_t k = 0; k < 8; k++) kernel.weights[k] = static_cast<float>(weights[k] / sum);
+    return kernel;
+}
+
+struct SrgbTables {
+    float decode[256];
+    uint8_t encode[SRGB_ENCODE_SIZE];
+};
+
+const SrgbTables &srgb_tables()
+{
+    static const SrgbTables tables = []() {
+        SrgbTables result;
+        for (uint32_t i = 0; i < 256; i++) {
+            double c = i / 255.0;
+            double linear = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+            result.decode[i] = static_cast<float>(linear);
+        }
+        for (uint32_t i = 0; i < SRGB_ENCODE_SIZE; i++) {
+            double linear = (double)i / (SRGB_ENCODE_SIZE - 1);
+            double c = linear <= 0.0031308 ? linear * 12.92
+                                           : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+            result.encode[i] = static_cast<uint8_t>(std::clamp(c * 255.0 + 0.5, 0.0, 255.0));
+        }
+        return result;
+    }();
+    return tables;
+}
+
+// alpha 所在的通道：RGBA 的第 4 个、灰度 + alpha 的第 2 个，其余格式没有 alpha
+uint32_t alpha_channel(uint32_t channels)
+{
+    return channels == 4 ? 3 : channels == 2 ? 1 : 4;
+}
+
+// 展开为每像素 4 个 float，缺少的通道填 0
+void to_float(const uint8_t *pixels, size_t count, uint32_t channels, bool srgb, float *out)
+{
+    const SrgbTables &tables = srgb_tables();
+    const uint32_t alpha = alpha_channel(channels);
+    for (size_t i = 0; i < count; i++) {
+        for (uint32_t c = 0; c < 4; c++) {
+            float value = 0.0f;
+            if (c < channels) {
+                uint8_t v = pixels[i * channels + c];
+                value = srgb && c != alpha ? tables.decode[v] : v / 255.0f;
+            }
+            out[i * 4 + c] = value;
+        }
+    }
+}
+
+void quantize(const float *in, size_t count, uint32_t channels, bool srgb, uint8_t *out)
+{
+    const SrgbTables &tables = srgb_tables();
+    const uint32_t alpha = alpha_channel(channels);
+    for (size_t i = 0; i < count; i++) {
+        for (uint32_t c = 0; c < channels; c++) {
+            // Kaiser 核有负瓣，结果可能略微越界
+            float v = std::clamp(in[i * 4 + c], 0.0f, 1.0f);
+            out[i * channels + c] =
+                srgb && c != alpha
+                    ? tables.encode[static_cast<uint32_t>(v * (SRGB_ENCODE_SIZE - 1) + 0.5f)]
+                    : static_cast<uint8_t>(v * 255.0f + 0.5f);
+        }
+    }
+}
+
+int32_t clamp_index(int32_t index, uint32_t size)
+{
+    return std::clamp(index, 0, static_cast<int32_t>(size) - 1);
+}
+
+// 水平方向：一行 width 个像素缩小为 outWidth 个
+using RowPass = void (*)(const float *in, uint32_t width, float *out, uint32_t outWidth,
+                         const Kernel &kernel);
+// 垂直方向：rows[k] 为第 k 个抽头对应的行，count 个 float 逐个加权求和
+using ColumnPass = void (*)(const float *const *rows, const Kernel &kernel, float *out,
+                            size_t count);
+
+void filter_row_scalar(const float *in, uint32_t width, float *out, uint32_t outWidth,
+                       const Kernel &kernel)
+{
+    for (uint32_t x = 0; x < outWidth; x++) {
+        float sum[4] = {};
+        for (uint32_t k = 0; k < kernel.taps; k++) {
+            const float *pixel = in + clamp_index(2 * x + kernel.offset + k, width) * 4;
+            for (uint32_t c = 0; c < 4; c++) sum[c] += kernel.weights[k] * pixel[c];
+        }
+        for (uint32_t c = 0; c < 4; c++) out[x * 4 + c] = sum[c];
+    }
+}
+
+void filter_columns_scalar(const float *const *rows, const Kernel &kernel, float *out,
+                           size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        float sum = 0.0f;
+        for (uint32_t k = 0; k < kernel.taps; k++) sum += kernel.weights[k] * rows[k][i];
+        out[i] = sum;
+    }
+}
+
+#ifdef MIP_SSE2
+// 每像素的 4 个通道正好是一个 __m128
+void filter_row_sse2(const float *in, uint32_t width, float *out, uint32_t outWidth,
+                     const Kernel &kernel)
+{
+    for (uint32_t x = 0; x < outWidth; x++) {
+        __m128 sum = _mm_setzero_ps();
+        for (uint32_t k = 0; k < kernel.taps; k++) {
+            const float *pixel = in + clamp_index(2 * x + kernel.offset + k, width) * 4;
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(kernel.weights[k]), _mm_loadu_ps(pixel)));
+        }
+        _mm_storeu_ps(out + x * 4, sum);
+    }
+}
+
+// 每行的 float 数总是 4 的倍数
+void filter_columns_sse2(const float *const *rows, const Kernel &kernel, float *out, size_t count)
+{
+    for (size_t i = 0; i < count; i += 4) {
+        __m128 sum = _mm_setzero_ps();
+        for (uint32_t k = 0; k < kernel.taps; k++) {
+            __m128 weight = _mm_set1_ps(kernel.weights[k]);
+            sum = _mm_add_ps(sum, _mm_mul_ps(weight, _mm_loadu_ps(rows[k] + i)));
+        }
+        _mm_storeu_ps(out + i, sum);
+    }
+}
+#endif
+
+#ifdef MIP_AVX2
+bool cpu_has_avx2()
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    // FMA、OSXSAVE、AVX，并且操作系统会保存 YMM 寄存器
+    const int required = (1 << 12) | (1 << 27) | (1 << 28);
+    if ((info[2] & required) != required || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#endif
+}
+
+// 一次处理相邻的两个输出像素，它们的抽头在源图像中相隔两个像素
+MIP_AVX2_TARGET void filter_row_avx2(const float *in, uint32_t width, float *out,
+                                     uint32_t outWidth, const Kernel &kernel)
+{
+    uint32_t x = 0;
+    for (; x + 1 < outWidth; x += 2) {
+        __m256 sum = _mm256_setzero_ps();
+        for (uint32_t k = 0; k < kernel.taps; k++) {
+            int32_t source = 2 * x + kernel.offset + k;
+            __m128 first = _mm_loadu_ps(in + clamp_index(source, width) * 4);
+            __m128 second = _mm_loadu_ps(in + clamp_index(source + 2, width) * 4);
+            __m256 pixels = _mm256_insertf128_ps(_mm256_castps128_ps256(first), second, 1);
+            sum = _mm256_fmadd_ps(_mm256_set1_ps(kernel.weights[k]), pixels, sum);
+        }
+        _mm256_storeu_ps(out + x * 4, sum);
+    }
+    for (; x < outWidth; x++) {
+        __m128 sum = _mm_setzero_ps();
+        for (uint32_t k = 0; k < kernel.taps; k++) {
+            const float *pixel = in + clamp_index(2 * x + kernel.offset + k, width) * 4;
+            sum = _mm_fmadd_ps(_mm_set1_ps(kernel.weights[k]), _mm_loadu_ps(pixel), sum);
+        }
+        _mm_storeu_ps(out + x * 4, sum);
+    }
+}
+
+MIP_AVX2_TARGET void filter_columns_avx2(const float *const *rows, const Kernel &kernel,
+                                         float *out, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 sum = _mm256_setzero_ps();
+        for (uint32_t k = 0; k < kernel.taps; k++)
+            sum = _mm256_fmadd_ps(_mm256_set1_ps(kernel.weights[k]), _mm256_loadu_ps(rows[k] + i),
+                                  sum);
+        _mm256_storeu_ps(out + i, sum);
+    }
+    for (; i < count; i += 4) {
+        __m128 sum = _mm_setzero_ps();
+        for (uint32_t k = 0; k < kernel.taps; k++)
+            sum = _mm_fmadd_ps(_mm_set1_ps(kernel.weights[k]), _mm_loadu_ps(rows[k] + i), sum);
+        _mm_storeu_ps(out + i, sum);
+    }
+}
+#endif
+
+struct Implementation {
+    RowPass row;
+    ColumnPass columns;
+    const char *name;
+};
+
+const Implementation SCALAR = {filter_row_scalar, filter_columns_scalar, "scalar"};
+
+const Implementation &best_implementation()
+{
+#ifdef MIP_AVX2
+    static const Implementation AVX2 = {filter_row_avx2, filter_columns_avx2, "AVX2"};
+    if (cpu_has_avx2()) return AVX2;
+#endif
+#ifdef MIP_SSE2
+    static const Implementation SSE2 = {filter_row_sse2, filter_columns_sse2, "SSE2"};
+    return SSE2;
+#else
+    return SCALAR;
+#endif
+}
+
+MipChain generate(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels,
+                  const MipOptions &options, const Implementation &implementation)
+{
+    MipChain chain;
+    if (width <= 1 && height <= 1) return chain;
+    const Kernel kernel = make_kernel(options.filter);
+    // 整条链大约是 level 0 的 1/3
+    chain.data.reserve((size_t)width * height * channels / 3 + 64);
+
+    std::vector<float> current((size_t)width * height * 4);
+    to_float(pixels, (size_t)width * height, channels, options.srgb, current.data());
+    std::vector<float> horizontal, next;
+    const float *rows[8];
+    // 某一维已经是 1 时所有抽头都落在同一个像素上，权重和为 1，这一维保持不变
+    while (width > 1 || height > 1) {
+        uint32_t nextWidth = std::max(width / 2, 1u);
+        uint32_t nextHeight = std::max(height / 2, 1u);
+        horizontal.resize((size_t)nextWidth * height * 4);
+        for (uint32_t y = 0; y < height; y++) {
+            implementation.row(current.data() + (size_t)y * width * 4, width,
+                               horizontal.data() + (size_t)y * nextWidth * 4, nextWidth, kernel);
+        }
+        next.resize((size_t)nextWidth * nextHeight * 4);
+        for (uint32_t y = 0; y < nextHeight; y++) {
+            for (uint32_t k = 0; k < kernel.taps; k++) {
+                int32_t row = clamp_index(2 * y + kernel.offset + k, height);
+                rows[k] = horizontal.data() + (size_t)row * nextWidth * 4;
+            }
+            implementation.columns(rows, kernel, next.data() + (size_t)y * nextWidth * 4,
+                                   (size_t)nextWidth * 4);
+        }
+
+        MipChain::Level level = {nextWidth, nextHeight, chain.data.size(),
+                                 (size_t)nextWidth * nextHeight * channels};
+        chain.data.resize(level.offset + level.size);
+        quantize(next.data(), (size_t)nextWidth * nextHeight, channels, options.srgb,
+                 chain.data.data() + level.offset);
+        chain.levels.push_back(level);
+        std::swap(current, next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    return chain;
+}
+}  // namespace
+
+MipChain generate_mips(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels,
+                       const MipOptions &options)
+{
+    return generate(pixels, width, height, channels, options, best_implementation());
+}
+
+MipChain generate_mips_scalar(const uint8_t *pixels, uint32_t width, uint32_t height,
+                              uint32_t channels, const MipOptions &options)
+{
+    return generate(pixels, width, height, channels, options, SCALAR);
+}
+
+const char *mip_simd_path()
+{
+    return best_implementation().name;
+}
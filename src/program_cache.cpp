@@ -0,0 +1,200 @@
+#include "program_cache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <vector>
+
+namespace {
+constexpr char BINARY_MAGIC[4] = {'G', 'L', 'P', 'B'};
+constexpr uint32_t BINARY_VERSION = 1;
+
+// 缓存文件头，之后紧跟 length 字节的 program binary
+struct BinaryHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t driverHash;
+    uint64_t sourceHash;
+    uint32_t format;
+    uint32_t length;
+};
+
+// FNV-1a，hash 传入上一段的结果即可把多段字符串串起来
+uint64_t hash_append(uint64_t hash, std::string_view text)
+{
+    for (char c : text) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    // 段与段之间插入分隔，避免 "ab"+"c" 与 "a"+"bc" 相同
+    hash ^= 0xff;
+    hash *= 0x100000001b3ull;
+    return hash;
+}
+
+uint64_t source_hash(const std::string &vertexCode, const std::string &fragmentCode)
+{
+    return hash_append(hash_append(0xcbf29ce484222325ull, vertexCode), fragmentCode);
+}
+
+std::string_view gl_string(GLenum name)
+{
+    const char *value = reinterpret_cast<const char *>(glGetString(name));
+    return value == nullptr ? std::string_view() : std::string_view(value);
+}
+
+double elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+}  // namespace
+
+ProgramCache::ProgramCache(std::string directory) : directory_(std::move(directory)) {}
+
+bool ProgramCache::available()
+{
+    if (availability_ < 0) {
+        GLint formats = 0;
+        if (GLAD_GL_VERSION_4_1) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        availability_ = formats > 0 ? 1 : 0;
+        uint64_t hash = 0xcbf29ce484222325ull;
+        hash = hash_append(hash, gl_string(GL_VENDOR));
+        hash = hash_append(hash, gl_string(GL_RENDERER));
+        hash = hash_append(hash, gl_string(GL_VERSION));
+        driverHash_ = hash;
+    }
+    return enabled_ && availability_ == 1;
+}
+
+std::string ProgramCache::path_for(uint64_t sourceHash) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(sourceHash));
+    return directory_ + "/" + name;
+}
+
+uint32_t ProgramCache::load(const std::string &vertexCode, const std::string &fragmentCode)
+{
+    if (!available()) {
+        misses_++;
+        return 0;
+    }
+    auto start = std::chrono::steady_clock::now();
+    uint64_t sourceHash = source_hash(vertexCode, fragmentCode);
+    std::string path = path_for(sourceHash);
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        misses_++;
+        return 0;
+    }
+    BinaryHeader header;
+    std::vector<char> binary;
+    bool valid = static_cast<bool>(file.read(reinterpret_cast<char *>(&header), sizeof(header))) &&
+                 std::memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0 &&
+                 header.version == BINARY_VERSION && header.driverHash == driverHash_ &&
+                 header.sourceHash == sourceHash;
+    if (valid) {
+        binary.resize(header.length);
+        valid = static_cast<bool>(file.read(binary.data(), header.length));
+    }
+    file.close();
+
+    uint32_t program = 0;
+    if (valid) {
+        program = glCreateProgram();
+        glProgramBinary(program, header.format, binary.data(), header.length);
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+    if (program == 0) {
+        // 损坏、驱动变化或被驱动拒绝：删掉文件，本次回退到从源码构建并重新写入
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        rejected_++;
+        misses_++;
+        return 0;
+    }
+    hits_++;
+    loadNs_ += elapsed_ns(start);
+    return program;
+}
+
+void ProgramCache::prepare(uint32_t program)
+{
+    if (available()) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramCache::store(uint32_t program, const std::string &vertexCode,
+                         const std::string &fragmentCode, double compileNs)
+{
+    compileNs_ += compileNs;
+    if (!available()) return;
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    BinaryHeader header;
+    std::memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.driverHash = driverHash_;
+    header.sourceHash = source_hash(vertexCode, fragmentCode);
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    header.format = format;
+    header.length = static_cast<uint32_t>(length);
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+    // 先写临时文件再 rename，其他进程或中途崩溃都不会读到写了一半的文件
+    std::string path = path_for(header.sourceHash);
+    std::string temporary = path + ".tmp" + std::to_string(std::random_device {}());
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(binary.data(), header.length);
+        if (!file) {
+            std::cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED " << temporary << std::endl;
+            file.close();
+            std::filesystem::remove(temporary, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        std::cout << "ERROR::PROGRAM_CACHE::RENAME_FAILED " << path << ": " << ec.message()
+                  << std::endl;
+        std::filesystem::remove(temporary, ec);
+    }
+}
+
+void ProgramCache::report() const
+{
+    std::cout << "program cache: " << hits_ << " hits";
+    if (hits_ > 0) std::cout << " (" << loadNs_ * 1e-6 / hits_ << " ms/program loaded)";
+    std::cout << ", " << misses_ << " misses";
+    if (misses_ > 0) std::cout << " (" << compileNs_ * 1e-6 / misses_ << " ms/program compiled)";
+    if (rejected_ > 0) std::cout << ", " << rejected_ << " rejected";
+    if (availability_ == 0) std::cout << ", program binaries unsupported by the driver";
+    std::cout << std::endl;
+}
+
+ProgramCache &program_cache()
+{
+    static ProgramCache cache;
+    return cache;
+}
@@ -0,0 +1,187 @@
+#include "render_queue.h"
+
+#include <algorithm>
+#include <bit>
+
+#include "gl_state.h"
+
+namespace {
+// key 的布局，高位优先：
+//   不透明: pass(2) | program(12) | 纹理组合(12) | VAO(14) | 深度(24)，状态相同的命令由近到远
+//   半透明: pass(2) | 反转的深度(24) | program(12) | 纹理组合(12) | VAO(14)，由远到近
+constexpr uint32_t PASS_SHIFT = 62;
+constexpr uint32_t PROGRAM_BITS = 12;
+constexpr uint32_t TEXTURE_BITS = 12;
+constexpr uint32_t VERTEX_ARRAY_BITS = 14;
+constexpr uint32_t DEPTH_BITS = 24;
+constexpr uint32_t STATE_BITS = PROGRAM_BITS + TEXTURE_BITS + VERTEX_ARRAY_BITS;
+
+// 非负 float 的位模式与数值同序，去掉低 7 位尾数后正好是 24 位，精度随距离对数下降
+uint64_t depth_bits(float depth)
+{
+    if (!(depth > 0.0f)) return 0;
+    return std::bit_cast<uint32_t>(depth) >> (31 - DEPTH_BITS);
+}
+
+// 新名字分配下一个编号，超出位数的都并到最后一个编号上：排序效果变差但结果仍然正确
+template <typename Name>
+uint64_t dense_id(std::unordered_map<Name, uint32_t> &ids, Name name, uint32_t bits)
+{
+    auto it = ids.try_emplace(name, static_cast<uint32_t>(ids.size())).first;
+    return std::min(it->second, (1u << bits) - 1);
+}
+
+// LSD 基数排序，每趟 8 位；所有 key 在某一字节上相同时跳过这一趟
+template <typename Item>
+void radix_sort(std::vector<Item> &items, std::vector<Item> &scratch)
+{
+    size_t n = items.size();
+    if (n < 2) return;
+    uint32_t counts[8][256] = {};
+    for (const Item &item : items) {
+        for (uint32_t pass = 0; pass < 8; pass++) counts[pass][(item.key >> (pass * 8)) & 0xff]++;
+    }
+    scratch.resize(n);
+    Item *source = items.data();
+    Item *destination = scratch.data();
+    for (uint32_t pass = 0; pass < 8; pass++) {
+        uint32_t shift = pass * 8;
+        if (counts[pass][(source[0].key >> shift) & 0xff] == n) continue;
+        uint32_t offsets[256];
+        uint32_t sum = 0;
+        for (uint32_t i = 0; i < 256; i++) {
+            offsets[i] = sum;
+            sum += counts[pass][i];
+        }
+        for (size_t i = 0; i < n; i++)
+            destination[offsets[(source[i].key >> shift) & 0xff]++] = source[i];
+        std::swap(source, destination);
+    }
+    if (source != items.data()) std::copy(source, source + n, items.data());
+}
+
+uint32_t index_size(GLenum type)
+{
+    switch (type) {
+        case GL_UNSIGNED_BYTE: return 1;
+        case GL_UNSIGNED_SHORT: return 2;
+        default: return 4;
+    }
+}
+}  // namespace
+
+uint64_t RenderQueue::make_key(const DrawCommand &command, float depth)
+{
+    uint64_t program = dense_id(programIds_, command.shader->id_, PROGRAM_BITS);
+    uint64_t textureSet = dense_id(
+        textureSetIds_, (uint64_t)command.textures[0] << 32 | command.textures[1], TEXTURE_BITS);
+    uint64_t vertexArray = dense_id(vertexArrayIds_, command.vao, VERTEX_ARRAY_BITS);
+    uint64_t state = program << (TEXTURE_BITS + VERTEX_ARRAY_BITS) |
+                     textureSet << VERTEX_ARRAY_BITS | vertexArray;
+    if (command.pass == DrawPass::Opaque) return state << DEPTH_BITS | depth_bits(depth);
+    uint64_t farFirst = ((1ull << DEPTH_BITS) - 1) - depth_bits(depth);
+    return 1ull << PASS_SHIFT | farFirst << STATE_BITS | state;
+}
+
+void RenderQueue::push(const DrawCommand &command, float depth, uint32_t instance)
+{
+    order_.push_back({make_key(command, depth), static_cast<uint32_t>(commands_.size())});
+    commands_.push_back({command, instance});
+}
+
+void RenderQueue::submit(const DrawCommand &command, float depth, const glm::mat4 &model)
+{
+    push(command, depth, static_cast<uint32_t>(models_.size()));
+    models_.push_back(model);
+}
+
+void RenderQueue::submit(const DrawCommand &command, float depth)
+{
+    push(command, depth, 0);
+}
+
+void RenderQueue::sort()
+{
+    // 单个物体的法线矩阵攒到这里一起求，走 build_instances 的 SSE 路径
+    instances_.resize(models_.size());
+    build_instances(models_.data(), models_.size(), TransformKind::General, instances_.data());
+    radix_sort(order_, scratch_);
+}
+
+RenderQueue::Stats RenderQueue::execute() const
+{
+    Stats stats;
+    const Shader *shader = nullptr;
+    uint32_t program = 0;
+    uint32_t vao = 0;
+    uint32_t textures[DRAW_TEXTURE_UNITS] = {};
+    bool first = true;
+    bool blending = false;
+    for (const SortItem &item : order_) {
+        const QueuedCommand &queued = commands_[item.index];
+        const DrawCommand &command = queued.command;
+        if (command.pass == DrawPass::Transparent && !blending) {
+            gl_state().enable(GL_BLEND);
+            gl_state().blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            gl_state().depth_mask(false);
+            blending = true;
+        }
+        if (first || command.shader != shader || command.shader->id_ != program) {
+            shader = command.shader;
+            program = shader->id_;
+            shader->use();
+            stats.programs++;
+        }
+        if (first || command.vao != vao) {
+            vao = command.vao;
+            gl_state().bind_vertex_array(vao);
+            stats.vertexArrays++;
+        }
+        for (uint32_t unit = 0; unit < DRAW_TEXTURE_UNITS; unit++) {
+            if (command.textures[unit] == 0) continue;
+            if (!first && command.textures[unit] == textures[unit]) continue;
+            textures[unit] = command.textures[unit];
+            gl_state().bind_texture(unit, GL_TEXTURE_2D, textures[unit]);
+            stats.textures++;
+        }
+        first = false;
+
+        // 当前顶点属性值不属于 VAO，关闭的属性数组读到的就是这里设置的常量
+        if (command.instanceCount == 0) {
+            const InstanceData &instance = instances_[queued.instance];
+            for (uint32_t c = 0; c < 4; c++)
+                glVertexAttrib4fv(INSTANCE_MODEL_LOCATION + c, &instance.model[c][0]);
+            for (uint32_t c = 0; c < 3; c++)
+                glVertexAttrib3fv(INSTANCE_NORMAL_LOCATION + c, &instance.normal[c][0]);
+        }
+        if (command.indexType == GL_NONE) {
+            if (command.instanceCount == 0)
+                glDrawArrays(command.mode, command.first, command.count);
+            else
+                glDrawArraysInstanced(command.mode, command.first, command.count,
+                                      command.instanceCount);
+        } else {
+            const void *offset =
+                (const void *)(uintptr_t)(command.first * index_size(command.indexType));
+            if (command.instanceCount == 0)
+                glDrawElements(command.mode, command.count, command.indexType, offset);
+            else
+                glDrawElementsInstanced(command.mode, command.count, command.indexType, offset,
+                                        command.instanceCount);
+        }
+        stats.draws++;
+    }
+    if (blending) {
+        gl_state().depth_mask(true);
+        gl_state().disable(GL_BLEND);
+    }
+    return stats;
+}
+
+void RenderQueue::clear()
+{
+    commands_.clear();
+    order_.clear();
+    models_.clear();
+    instances_.clear();
+}
@@ -1,100 +1,454 @@
 #include "shader.h"
 
-// 构造器读取并构建着色器
-Shader::Shader(const char *vertexPath, const char *fragmentPath)
+#include <algorithm>
+
+#include "gl_state.h"
+#include "program_cache.h"
+
+namespace {
+// 展开 GLSL 源码中的 #include "file"，路径相对于当前 shader 文件所在目录
+// GLSL 本身不支持 #include，这样多个 program 可以共享 lighting.glsl 之类的公共代码
+// dependencies 非空时记录所有被展开的文件，供热重载判断哪些 program 受影响
+std::string expand_includes(const std::string &source, const std::string &path,
+                            std::vector<std::string> *dependencies, int depth = 0)
+{
+    std::string dir;
+    size_t slash = path.find_last_of("/\\");
+    if (slash != std::string::npos) dir = path.substr(0, slash + 1);
+
+    std::istringstream in(source);
+    std::ostringstream out;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t begin = line.find_first_not_of(" \t");
+        if (begin == std::string::npos || line.compare(begin, 8, "#include") != 0) {
+            out << line << '\n';
+            continue;
+        }
+        size_t open = line.find('"', begin);
+        size_t close = line.find('"', open + 1);
+        if (open == std::string::npos || close == std::string::npos || depth >= 8) {
+            std::cout << "ERROR::SHADER::INVALID_INCLUDE " << path << ": " << line << std::endl;
+            continue;
+        }
+        std::string includePath = dir + line.substr(open + 1, close - open - 1);
+        std::ifstream includeFile(includePath);
+        if (!includeFile) {
+            std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND " << includePath << std::endl;
+            continue;
+        }
+        std::stringstream includeStream;
+        includeStream << includeFile.rdbuf();
+        if (dependencies != nullptr) dependencies->push_back(includePath);
+        out << expand_includes(includeStream.str(), includePath, dependencies, depth + 1);
+    }
+    return out.str();
+}
+
+// 按名字排序并去重，同名时保留最后传入的那个
+ShaderDefines canonical_defines(const ShaderDefines &defines)
+{
+    ShaderDefines sorted = defines;
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const ShaderDefine &a, const ShaderDefine &b) { return a.name < b.name; });
+    ShaderDefines unique;
+    for (size_t i = 0; i < sorted.size(); i++) {
+        if (i + 1 < sorted.size() && sorted[i + 1].name == sorted[i].name) continue;
+        unique.push_back(std::move(sorted[i]));
+    }
+    return unique;
+}
+}  // namespace
+
+std::string inject_defines(const std::string &source, const ShaderDefines &defines)
+{
+    if (defines.empty()) return source;
+    std::string block;
+    for (const ShaderDefine &define : canonical_defines(defines))
+        block += "#define " + define.name + " " + define.value + "\n";
+
+    // #version 必须是第一条语句，define 只能放在它后面
+    size_t insert = 0;
+    size_t version = source.find("#version");
+    if (version != std::string::npos) {
+        size_t lineEnd = source.find('\n', version);
+        insert = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+    }
+    return source.substr(0, insert) + block + source.substr(insert);
+}
+
+std::string Shader::read_source(const char *path, std::vector<std::string> *dependencies)
 {
-    // 1. 从文件路径中获取顶点/片段着色器
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
+    if (dependencies != nullptr) dependencies->push_back(path);
+    std::string code;
+    std::ifstream file;
     // 保证ifstream对象可以抛出异常：
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     try {
-        // 打开文件
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        // 读取文件的缓冲内容到数据流中
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        // 关闭文件处理器
-        vShaderFile.close();
-        fShaderFile.close();
-        // 转换数据流到string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        file.open(path);
+        std::stringstream stream;
+        stream << file.rdbuf();
+        file.close();
+        code = stream.str();
     } catch (std::ifstream::failure e) {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
     }
-    const char *vShaderCode = vertexCode.c_str();
-    const char *fShaderCode = fragmentCode.c_str();
+    return expand_includes(code, path, dependencies);
+}
+
+// 构造器读取并构建着色器
+Shader::Shader(const char *vertexPath, const char *fragmentPath, const ShaderDefines &defines,
+               BuildMode mode)
+    : vertexPath_(vertexPath), fragmentPath_(fragmentPath), defines_(defines)
+{
+    // 1. 从文件路径中获取顶点/片段着色器，展开 include 并注入 define
+    build(inject_defines(read_source(vertexPath, &dependencies_), defines),
+          inject_defines(read_source(fragmentPath, &dependencies_), defines), mode);
+}
+
+Shader Shader::from_source(std::string vertexCode, std::string fragmentCode, BuildMode mode)
+{
+    Shader shader;
+    shader.build(std::move(vertexCode), std::move(fragmentCode), mode);
+    return shader;
+}
 
+void Shader::build(std::string vertexCode, std::string fragmentCode, BuildMode mode)
+{
+    // 2. 源码 (含展开后的 include 与 define) 与驱动都没变时，直接从磁盘缓存恢复 program
+    id_ = program_cache().load(vertexCode, fragmentCode);
+    if (id_ != 0) {
+        reflect_uniforms();
+        return;
+    }
+    begin_build(std::move(vertexCode), std::move(fragmentCode));
+    if (mode == BuildMode::Sync) finish();
+}
+
+namespace {
+// GL_KHR_parallel_shader_compile 不在 glad 生成的范围内，常量与函数指针手动补上
+constexpr GLenum GL_MAX_SHADER_COMPILER_THREADS_KHR = 0x91B0;
+constexpr GLenum GL_COMPLETION_STATUS_KHR = 0x91B1;
+typedef void(APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+bool parallelCompile = false;
+
+uint32_t submit_stage(GLenum type, const std::string &code)
+{
+    const char *source = code.c_str();
+    uint32_t shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    return shader;
+}
+
+void check_stage(uint32_t shader, const char *stage)
+{
     int32_t success;
     char infoLog[512];
-    // vertex shader
-    uint32_t vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vShaderCode, NULL);
-    glCompileShader(vertexShader);
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
     if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-    // fragment shader
-    uint32_t fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
-    glCompileShader(fragmentShader);
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::" << stage << "::COMPILATION_FAILED\n"
+                  << infoLog << std::endl;
     }
+}
+}  // namespace
+
+bool Shader::enable_parallel_compile(GLADloadproc load)
+{
+    const char *names[2][2] = {{"GL_KHR_parallel_shader_compile", "glMaxShaderCompilerThreadsKHR"},
+                               {"GL_ARB_parallel_shader_compile", "glMaxShaderCompilerThreadsARB"}};
+    parallelCompile = false;
+    for (auto &[extension, function] : names) {
+        if (!has_extension(extension)) continue;
+        auto maxThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(load(function));
+        // 0xFFFFFFFF 表示由驱动决定线程数
+        if (maxThreads != nullptr) maxThreads(0xFFFFFFFF);
+        parallelCompile = true;
+        break;
+    }
+    return parallelCompile;
+}
+
+// 依次提交两个 stage 的编译与链接，驱动可以在后台线程上完成它们
+void Shader::begin_build(std::string vertexCode, std::string fragmentCode)
+{
+    auto pending = std::make_unique<PendingBuild>();
+    pending->start = std::chrono::steady_clock::now();
+    pending->vertexShader = submit_stage(GL_VERTEX_SHADER, vertexCode);
+    pending->fragmentShader = submit_stage(GL_FRAGMENT_SHADER, fragmentCode);
     id_ = glCreateProgram();
-    glAttachShader(id_, vertexShader);
-    glAttachShader(id_, fragmentShader);
+    program_cache().prepare(id_);
+    glAttachShader(id_, pending->vertexShader);
+    glAttachShader(id_, pending->fragmentShader);
     glLinkProgram(id_);
+    pending->vertexCode = std::move(vertexCode);
+    pending->fragmentCode = std::move(fragmentCode);
+    pending_ = std::move(pending);
+}
+
+bool Shader::ready() const
+{
+    if (!pending_) return true;
+    if (parallelCompile) {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(id_, GL_COMPLETION_STATUS_KHR, &completed);
+        if (!completed) return false;
+    }
+    finish();
+    return true;
+}
+
+// 第一次查询编译/链接状态，驱动在这里等待后台编译结束
+void Shader::finish() const
+{
+    if (!pending_) return;
+    std::unique_ptr<PendingBuild> pending = std::move(pending_);
+
+    check_stage(pending->vertexShader, "VERTEX");
+    check_stage(pending->fragmentShader, "FRAGMENT");
+    int32_t success;
+    char infoLog[512];
     glGetProgramiv(id_, GL_LINK_STATUS, &success);
     if (!success) {
         glGetProgramInfoLog(id_, 512, NULL, infoLog);
         std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
     }
+    glDeleteShader(pending->vertexShader);
+    glDeleteShader(pending->fragmentShader);
+
+    double buildNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() -
+                                                              pending->start)
+                         .count();
+    program_cache().store(id_, pending->vertexCode, pending->fragmentCode, buildNs);
+    reflect_uniforms();
+}
+
+void Shader::discard()
+{
+    // 还没 finish() 的构建，shader object 只有 finish() 才会删除
+    if (pending_) {
+        glDeleteShader(pending_->vertexShader);
+        glDeleteShader(pending_->fragmentShader);
+        pending_.reset();
+    }
+    glDeleteProgram(id_);
+}
+
+void Shader::reload()
+{
+    // 只有从文件构造的 Shader 才知道去哪里重新读取源码
+    if (vertexPath_.empty() || fragmentPath_.empty()) return;
+    // 上一次重载还没完成时直接丢弃它，以最新的文件内容为准
+    if (reloading_) reloading_->discard();
+    reloading_ = std::make_unique<Shader>(vertexPath_.c_str(), fragmentPath_.c_str(), defines_,
+                                          BuildMode::Async);
+}
+
+bool Shader::poll_reload()
+{
+    if (!reloading_ || !reloading_->ready()) return false;
+    std::unique_ptr<Shader> next = std::move(reloading_);
+
+    int32_t success = 0;
+    glGetProgramiv(next->id_, GL_LINK_STATUS, &success);
+    if (!success) {
+        // 编译/链接错误已经由 finish() 输出，旧 program 保持不变
+        std::cout << "ERROR::SHADER::RELOAD_FAILED keeping the previous program for "
+                  << vertexPath_ << " + " << fragmentPath_ << std::endl;
+        glDeleteProgram(next->id_);
+        return true;
+    }
+    glDeleteProgram(id_);
+    id_ = next->id_;
+    uniforms_ = std::move(next->uniforms_);
+    dependencies_ = std::move(next->dependencies_);
+    generation_++;
+    std::cout << "shader reloaded: " << vertexPath_ << " + " << fragmentPath_ << std::endl;
+    return true;
+}
+
+namespace {
+// 0 被用来标记空槽，真实哈希值恰好为 0 时映射为 1
+uint64_t slot_hash(std::string_view name)
+{
+    uint64_t hash = uniform_hash(name);
+    return hash == 0 ? 1 : hash;
+}
+}  // namespace
+
+// 反射所有 active uniform，之后的查询都不再经过驱动
+void Shader::reflect_uniforms() const
+{
+    int32_t count = 0;
+    int32_t maxLength = 0;
+    glGetProgramiv(id_, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(id_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<std::pair<std::string, int32_t>> entries;
+    std::string name(static_cast<size_t>(maxLength), '\0');
+    for (int32_t i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(id_, i, maxLength, &length, &size, &type, name.data());
+        std::string uniformName(name.data(), length);
+        int32_t location = glGetUniformLocation(id_, uniformName.c_str());
+        // uniform block 中的成员没有 location，由 UBO 负责
+        if (location < 0) continue;
+
+        // 数组 uniform 返回的名字形如 "arr[0]"，size 为数组长度；"arr"、"arr[0]" ... "arr[size-1]"
+        // 都需要能查到。规范不保证元素的 location 连续，每个元素单独查询，只在反射时付出这些调用
+        if (uniformName.size() > 3 && uniformName.ends_with("[0]")) {
+            std::string base = uniformName.substr(0, uniformName.size() - 3);
+            entries.emplace_back(base, location);
+            entries.emplace_back(uniformName, location);
+            for (GLint j = 1; j < size; j++) {
+                std::string element = base + "[" + std::to_string(j) + "]";
+                int32_t elementLocation = glGetUniformLocation(id_, element.c_str());
+                if (elementLocation >= 0) entries.emplace_back(std::move(element), elementLocation);
+            }
+        } else {
+            entries.emplace_back(std::move(uniformName), location);
+        }
+    }
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // 负载因子不超过 0.5，线性探测的查找基本一次命中
+    size_t capacity = 16;
+    while (capacity < entries.size() * 2) capacity *= 2;
+    uniforms_.assign(capacity, UniformSlot {});
+    for (auto &[uniformName, location] : entries) insert_uniform(std::move(uniformName), location);
+}
+
+void Shader::insert_uniform(std::string name, int32_t location) const
+{
+    uint64_t hash = slot_hash(name);
+    size_t mask = uniforms_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        UniformSlot &slot = uniforms_[i];
+        if (slot.hash == 0) {
+            slot = {hash, location, std::move(name)};
+            return;
+        }
+        if (slot.hash == hash && slot.name == name) return;
+    }
+}
+
+int32_t Shader::location(std::string_view name) const
+{
+    finish();
+    if (uniforms_.empty()) return -1;
+    uint64_t hash = slot_hash(name);
+    size_t mask = uniforms_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const UniformSlot &slot = uniforms_[i];
+        if (slot.hash == 0) return -1;
+        if (slot.hash == hash && slot.name == name) return slot.location;
+    }
 }
 
 // 使用/激活程序
-void Shader::use()
+void Shader::use() const
+{
+    finish();
+    gl_state().use_program(id_);
+}
+
+// 句柄版本的 uniform 工具函数
+void Shader::set(Uniform<bool> uniform, bool value) const
+{
+    glUniform1i(uniform.location, (int)value);
+}
+void Shader::set(Uniform<int> uniform, int value) const
+{
+    glUniform1i(uniform.location, value);
+}
+void Shader::set(Uniform<float> uniform, float value) const
+{
+    glUniform1f(uniform.location, value);
+}
+void Shader::set(Uniform<glm::vec3> uniform, float x, float y, float z) const
+{
+    glUniform3f(uniform.location, x, y, z);
+}
+void Shader::set(Uniform<glm::vec3> uniform, const glm::vec3 &value) const
+{
+    glUniform3fv(uniform.location, 1, &value[0]);
+}
+void Shader::set(Uniform<glm::mat4> uniform, const glm::mat4 &value) const
 {
-    glUseProgram(id_);
+    glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &value[0][0]);
 }
 
 // uniform工具函数
-void Shader::set_bool(const std::string &name, bool value) const
+void Shader::set_bool(std::string_view name, bool value) const
 {
-    glUniform1i(glGetUniformLocation(id_, name.c_str()), (int)value);
+    glUniform1i(location(name), (int)value);
 }
 
-void Shader::set_int(const std::string &name, int value) const
+void Shader::set_int(std::string_view name, int value) const
 {
-    glUniform1i(glGetUniformLocation(id_, name.c_str()), value);
+    glUniform1i(location(name), value);
 }
 
-void Shader::set_float(const std::string &name, float value) const
+void Shader::set_float(std::string_view name, float value) const
 {
-    glUniform1f(glGetUniformLocation(id_, name.c_str()), value);
+    glUniform1f(location(name), value);
 }
-void Shader::set_vec3(const std::string &name, float x, float y, float z) const
+void Shader::set_vec3(std::string_view name, float x, float y, float z) const
 {
-    glUniform3f(glGetUniformLocation(id_, name.c_str()), x, y, z);
+    glUniform3f(location(name), x, y, z);
 }
-void Shader::set_vec3(const std::string &name, const glm::vec3 &value) const
+void Shader::set_vec3(std::string_view name, const glm::vec3 &value) const
 {
-    glUniform3fv(glGetUniformLocation(id_, name.c_str()), 1, &value[0]);
+    glUniform3fv(location(name), 1, &value[0]);
 }
-void Shader::set_mat4(const std::string &name, glm::mat4 &value) const
+void Shader::set_mat4(std::string_view name, const glm::mat4 &value) const
+{
+    glUniformMatrix4fv(location(name), 1, GL_FALSE, &value[0][0]);
+}
+
+const Shader &ShaderVariants::get(const char *vertexPath, const char *fragmentPath,
+                                  const ShaderDefines &defines, BuildMode mode)
+{
+    // 排序后的 define 列表，两级的键共用
+    std::string defineKey;
+    for (const ShaderDefine &define : canonical_defines(defines))
+        defineKey += ";" + define.name + "=" + define.value;
+
+    // 第一级按路径查找，不读文件；路径之间插入 '\0' 避免拼接歧义
+    std::string pathKey = std::string(vertexPath) + '\0' + fragmentPath + defineKey;
+    auto resolved = resolved_.find(pathKey);
+    if (resolved != resolved_.end()) {
+        hits_++;
+        return *resolved->second;
+    }
+
+    std::string vertexCode = Shader::read_source(vertexPath);
+    std::string fragmentCode = Shader::read_source(fragmentPath);
+    // 第二级的键为 源码哈希 + define 列表，内容相同的不同路径共用一个 program
+    std::string key = std::to_string(uniform_hash(vertexCode + '\0' + fragmentCode)) + defineKey;
+    auto found = variants_.find(key);
+    if (found != variants_.end()) {
+        hits_++;
+        return *(resolved_[std::move(pathKey)] = found->second.get());
+    }
+    misses_++;
+    auto shader = std::make_unique<Shader>(Shader::from_source(
+        inject_defines(vertexCode, defines), inject_defines(fragmentCode, defines), mode));
+    const Shader *built = variants_.emplace(std::move(key), std::move(shader)).first->second.get();
+    return *(resolved_[std::move(pathKey)] = built);
+}
+
+void ShaderVariants::reload()
+{
+    resolved_.clear();
+}
+
+void ShaderVariants::release()
 {
-    glUniformMatrix4fv(glGetUniformLocation(id_, name.c_str()), 1, GL_FALSE, &value[0][0]);
+    for (auto &[key, shader] : variants_) glDeleteProgram(shader->id_);
+    variants_.clear();
+    resolved_.clear();
 }
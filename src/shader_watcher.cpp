@@ -0,0 +1,112 @@
+#include "shader_watcher.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+ShaderWatcher::ShaderWatcher(std::string directory) : directory_(std::move(directory))
+{
+#ifdef __linux__
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    // 编辑器保存文件有直接写入与写临时文件再 rename 两种方式，两种事件都要监听
+    if (inotifyFd_ < 0 || wakeFd_ < 0 ||
+        inotify_add_watch(inotifyFd_, directory_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cout << "ERROR::SHADER_WATCHER::INOTIFY_FAILED " << directory_ << std::endl;
+        return;
+    }
+    thread_ = std::thread(&ShaderWatcher::run, this);
+#else
+    std::cout << "shader hot reload needs inotify and is disabled on this platform" << std::endl;
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+#ifdef __linux__
+    if (thread_.joinable()) {
+        uint64_t one = 1;
+        if (write(wakeFd_, &one, sizeof(one)) != sizeof(one))
+            std::cout << "ERROR::SHADER_WATCHER::WAKE_FAILED" << std::endl;
+        thread_.join();
+    }
+    if (inotifyFd_ >= 0) close(inotifyFd_);
+    if (wakeFd_ >= 0) close(wakeFd_);
+#endif
+}
+
+void ShaderWatcher::watch(Shader &shader)
+{
+    shaders_.push_back(&shader);
+}
+
+void ShaderWatcher::run()
+{
+#ifdef __linux__
+    // inotify_event 后面跟着变长的文件名，按 inotify(7) 的建议对齐缓冲区
+    alignas(inotify_event) char buffer[4096];
+    pollfd fds[2] = {{inotifyFd_, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            std::cout << "ERROR::SHADER_WATCHER::POLL_FAILED" << std::endl;
+            return;
+        }
+        if (fds[1].revents & POLLIN) return;
+        if (!(fds[0].revents & POLLIN)) continue;
+
+        ssize_t length;
+        std::vector<std::string> files;
+        while ((length = read(inotifyFd_, buffer, sizeof(buffer))) > 0) {
+            for (char *ptr = buffer; ptr < buffer + length;) {
+                const inotify_event *event = reinterpret_cast<const inotify_event *>(ptr);
+                if (event->len > 0) files.emplace_back(event->name);
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+        if (files.empty()) continue;
+        std::lock_guard<std::mutex> lock(mutex_);
+        changedFiles_.insert(changedFiles_.end(), files.begin(), files.end());
+        changed_.store(true, std::memory_order_release);
+    }
+#endif
+}
+
+void ShaderWatcher::update()
+{
+    // 没有文件变化、也没有进行中的重载时，每帧只有这一次原子读
+    if (changed_.load(std::memory_order_acquire)) {
+        std::vector<std::string> files;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            files.swap(changedFiles_);
+            changed_.store(false, std::memory_order_relaxed);
+        }
+        std::vector<std::filesystem::path> changed;
+        for (const std::string &file : files)
+            changed.push_back((std::filesystem::path(directory_) / file).lexically_normal());
+
+        for (Shader *shader : shaders_) {
+            const std::vector<std::string> &dependencies = shader->dependencies();
+            bool affected = std::any_of(
+                dependencies.begin(), dependencies.end(), [&](const std::string &dependency) {
+                    auto path = std::filesystem::path(dependency).lexically_normal();
+                    return std::find(changed.begin(), changed.end(), path) != changed.end();
+                });
+            if (!affected) continue;
+            shader->reload();
+            if (std::find(reloading_.begin(), reloading_.end(), shader) == reloading_.end())
+                reloading_.push_back(shader);
+        }
+    }
+    if (reloading_.empty()) return;
+    std::erase_if(reloading_, [](Shader *shader) { return shader->poll_reload(); });
+}
@@ -0,0 +1,225 @@
+#include "texture_array.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "gl_state.h"
+#include "stb_image.h"
+
+namespace {
+GLenum channel_format(uint32_t channels)
+{
+    switch (channels) {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 3: return GL_RGB;
+        default: return GL_RGBA;
+    }
+}
+
+// RGB 也存成 RGBA8：RGB8 不保证可以作为 framebuffer 附件，GL 4.3 以下扩容时要从 FBO 读回，
+// 而驱动通常本来就把 RGB8 补齐成 4 字节
+GLenum internal_format(uint32_t channels)
+{
+    switch (channels) {
+        case 1: return GL_R8;
+        case 2: return GL_RG8;
+        default: return GL_RGBA8;
+    }
+}
+
+uint32_t texel_bytes(uint32_t channels)
+{
+    return channels == 3 ? 4 : channels;
+}
+
+uint32_t level_size(uint32_t size, uint32_t level)
+{
+    return std::max(1u, size >> level);
+}
+}  // namespace
+
+TextureArrays::TextureArrays(uint32_t maxLayers)
+{
+    GLint limit = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &limit);
+    // 层号以 16 bit 保存在 MaterialLayers 中
+    maxLayers_ = std::min({maxLayers, static_cast<uint32_t>(std::max(limit, 1)), 65536u});
+    maxLayers_ = std::max(maxLayers_, 1u);
+}
+
+uint32_t TextureArrays::allocate(const Array &array, uint32_t capacity) const
+{
+    uint32_t id;
+    glGenTextures(1, &id);
+    gl_state().edit_texture(GL_TEXTURE_2D_ARRAY, id);
+    // 3.3 没有 glTexStorage3D，逐级分配不带数据的存储
+    gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    GLenum format = channel_format(array.channels);
+    for (uint32_t level = 0; level < array.levels; level++) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internal_format(array.channels),
+                     level_size(array.width, level), level_size(array.height, level), capacity, 0,
+                     format, GL_UNSIGNED_BYTE, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, array.levels - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                    array.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return id;
+}
+
+void TextureArrays::grow(Array &array)
+{
+    uint32_t capacity = std::min(array.capacity * 2, maxLayers_);
+    uint32_t id = allocate(array, capacity);
+    if (GLAD_GL_VERSION_4_3) {
+        for (uint32_t level = 0; level < array.levels; level++) {
+            glCopyImageSubData(array.id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, id,
+                               GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, level_size(array.width, level),
+                               level_size(array.height, level), array.layers);
+        }
+    } else {
+        // 把旧 array 的每一层每一级依次挂到读 framebuffer 上，拷进新 array 的同一位置
+        if (copyFramebuffer_ == 0) glGenFramebuffers(1, &copyFramebuffer_);
+        gl_state().bind_framebuffer(GL_READ_FRAMEBUFFER, copyFramebuffer_);
+        for (uint32_t level = 0; level < array.levels; level++) {
+            for (uint32_t layer = 0; layer < array.layers; layer++) {
+                glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, array.id,
+                                          level, layer);
+                glCopyTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, 0, 0,
+                                    level_size(array.width, level),
+                                    level_size(array.height, level));
+            }
+        }
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0, 0);
+        gl_state().bind_framebuffer(GL_READ_FRAMEBUFFER, 0);
+    }
+    gl_state().delete_textures(1, &array.id);
+    array.id = id;
+    array.capacity = capacity;
+    grows_++;
+}
+
+TextureLayer TextureArrays::add(const uint8_t *pixels, uint32_t width, uint32_t height,
+                                uint32_t channels, const MipChain &mips)
+{
+    TextureLayer handle;
+    if (pixels == nullptr || width == 0 || height == 0 || channels == 0 || channels > 4) {
+        std::cout << "ERROR::TEXTURE_ARRAY::INVALID_IMAGE" << std::endl;
+        return handle;
+    }
+    const uint32_t levels = static_cast<uint32_t>(mips.levels.size()) + 1;
+
+    // 同一规格只有最后一个 array 可能还有空位，前面的都已经达到上限
+    uint32_t index = TextureLayer::INVALID;
+    for (uint32_t i = static_cast<uint32_t>(arrays_.size()); i-- > 0;) {
+        const Array &array = arrays_[i];
+        if (array.width == width && array.height == height && array.channels == channels &&
+            array.levels == levels) {
+            if (array.layers < maxLayers_) index = i;
+            break;
+        }
+    }
+    if (index == TextureLayer::INVALID) {
+        Array array = {0, width, height, channels, levels, 0, std::min(INITIAL_LAYERS, maxLayers_)};
+        array.id = allocate(array, array.capacity);
+        index = static_cast<uint32_t>(arrays_.size());
+        arrays_.push_back(array);
+    }
+    Array &array = arrays_[index];
+    if (array.layers == array.capacity) grow(array);
+
+    handle.array = index;
+    handle.layer = array.layers++;
+    gl_state().edit_texture(GL_TEXTURE_2D_ARRAY, array.id);
+    gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    // RGB 等格式的行宽不一定是 4 的倍数
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    GLenum format = channel_format(channels);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, handle.layer, width, height, 1, format,
+                    GL_UNSIGNED_BYTE, pixels);
+    for (size_t i = 0; i < mips.levels.size(); i++) {
+        const MipChain::Level &level = mips.levels[i];
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(i + 1), 0, 0, handle.layer,
+                        level.width, level.height, 1, format, GL_UNSIGNED_BYTE,
+                        mips.data.data() + level.offset);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    return handle;
+}
+
+TextureLayer TextureArrays::load(const std::string &path, bool flipVertically,
+                                 const MipOptions &mipOptions)
+{
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load_thread(flipVertically);
+    unsigned char *pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+    if (pixels == nullptr) {
+        std::cout << "ERROR::TEXTURE_ARRAY::LOAD_FAILED: " << path << std::endl;
+        return TextureLayer();
+    }
+    MipChain mips = generate_mips(pixels, width, height, channels, mipOptions);
+    TextureLayer handle = add(pixels, width, height, channels, mips);
+    stbi_image_free(pixels);
+    return handle;
+}
+
+void TextureArrays::bind(uint32_t unit, uint32_t array) const
+{
+    gl_state().bind_texture(unit, GL_TEXTURE_2D_ARRAY, arrays_[array].id);
+}
+
+TextureArrays::Stats TextureArrays::stats() const
+{
+    Stats stats;
+    stats.arrays = static_cast<uint32_t>(arrays_.size());
+    stats.grows = grows_;
+    for (const Array &array : arrays_) {
+        stats.layers += array.layers;
+        size_t layerBytes = 0;
+        for (uint32_t level = 0; level < array.levels; level++) {
+            layerBytes += (size_t)level_size(array.width, level) *
+                          level_size(array.height, level) * texel_bytes(array.channels);
+        }
+        stats.bytes += layerBytes * array.capacity;
+    }
+    return stats;
+}
+
+void TextureArrays::release()
+{
+    for (Array &array : arrays_) gl_state().delete_textures(1, &array.id);
+    arrays_.clear();
+    if (copyFramebuffer_ != 0) gl_state().delete_framebuffers(1, &copyFramebuffer_);
+    copyFramebuffer_ = 0;
+}
+
+MaterialLayerBuffer::MaterialLayerBuffer()
+{
+    glGenBuffers(1, &id_);
+}
+
+void MaterialLayerBuffer::attach(uint32_t vao) const
+{
+    gl_state().bind_vertex_array(vao);
+    gl_state().bind_buffer(GL_ARRAY_BUFFER, id_);
+    // 整数层号按原值转成 float (不归一化)，sampler2DArray 的层坐标本来就是 float
+    glEnableVertexAttribArray(INSTANCE_LAYER_LOCATION);
+    glVertexAttribPointer(INSTANCE_LAYER_LOCATION, 2, GL_UNSIGNED_SHORT, GL_FALSE,
+                          sizeof(MaterialLayers), (void *)0);
+    glVertexAttribDivisor(INSTANCE_LAYER_LOCATION, 1);
+    gl_state().bind_vertex_array(0);
+}
+
+void MaterialLayerBuffer::upload(const MaterialLayers *layers, size_t count)
+{
+    gl_state().bind_buffer(GL_ARRAY_BUFFER, id_);
+    if (count > capacity_) {
+        capacity_ = count;
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(MaterialLayers), layers, GL_DYNAMIC_DRAW);
+    } else if (count > 0) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(MaterialLayers), layers);
+    }
+}
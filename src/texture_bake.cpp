@@ -0,0 +1,221 @@
+#include "texture_bake.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+#include "block_compress.h"
+#include "mip_generator.h"
+#include "stb_image.h"
+
+namespace {
+GLenum channel_format(uint32_t channels)
+{
+    switch (channels) {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 3: return GL_RGB;
+        default: return GL_RGBA;
+    }
+}
+
+size_t align_up(size_t size)
+{
+    return (size + BAKED_DATA_ALIGNMENT - 1) & ~(BAKED_DATA_ALIGNMENT - 1);
+}
+}  // namespace
+
+bool bake_texture(const std::string &source, const std::string &destination,
+                  const BakeOptions &options)
+{
+    stbi_set_flip_vertically_on_load_thread(options.flipVertically);
+    int width = 0, height = 0, channels = 0;
+    unsigned char *pixels = stbi_load(source.c_str(), &width, &height, &channels, 0);
+    if (pixels == nullptr) {
+        std::cout << "ERROR::TEXTURE_BAKE::DECODE_FAILED " << source << std::endl;
+        return false;
+    }
+    bool baked = bake_pixels(pixels, width, height, channels, destination, options);
+    stbi_image_free(pixels);
+    return baked;
+}
+
+bool bake_pixels(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels,
+                 const std::string &destination, const BakeOptions &options)
+{
+    // 与 GL 的 mip 链长度一致：floor(log2(max(width, height))) + 1
+    MipChain mips =
+        generate_mips(pixels, width, height, channels, {options.mipFilter, options.srgb});
+    std::vector<std::vector<uint8_t>> levels;
+    std::vector<BakedLevel> table;
+    levels.emplace_back(pixels, pixels + (size_t)width * height * channels);
+    table.push_back({0, levels.back().size(), width, height});
+    for (const MipChain::Level &level : mips.levels) {
+        auto begin = mips.data.begin() + level.offset;
+        levels.emplace_back(begin, begin + level.size);
+        table.push_back({0, level.size, level.width, level.height});
+    }
+
+    BakedTextureHeader header = {};
+    std::memcpy(header.magic, BAKED_TEXTURE_MAGIC, sizeof(header.magic));
+    header.version = BAKED_TEXTURE_VERSION;
+    header.width = width;
+    header.height = height;
+    header.levelCount = static_cast<uint32_t>(table.size());
+    header.channels = channels;
+    header.format = channel_format(channels);
+    header.internalFormat = header.format;
+    header.type = GL_UNSIGNED_BYTE;
+    if (options.compress || options.normalMap) {
+        // mip 链在未压缩的数据上生成，之后逐级独立压缩
+        BlockFormat format = options.normalMap ? BlockFormat::BC5 : block_format_for(channels);
+        const BlockFormatInfo &info = block_format_info(format);
+        for (size_t i = 0; i < table.size(); i++) {
+            levels[i] = compress_blocks(levels[i].data(), table[i].width, table[i].height,
+                                        channels, format);
+            table[i].size = levels[i].size();
+        }
+        header.channels = info.channels;
+        header.format = info.format;
+        header.internalFormat = info.internalFormat;
+        header.blockBytes = info.blockBytes;
+    }
+    size_t offset = align_up(sizeof(header) + table.size() * sizeof(BakedLevel));
+    for (BakedLevel &level : table) {
+        level.offset = offset;
+        offset = align_up(offset + level.size);
+    }
+
+    std::ofstream file(destination, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(BakedLevel));
+    // 每级之前补零到对齐位置，文件大小为最后一级对齐后的结束位置
+    const char padding[BAKED_DATA_ALIGNMENT] = {};
+    size_t position = sizeof(header) + table.size() * sizeof(BakedLevel);
+    for (size_t i = 0; i < table.size(); i++) {
+        file.write(padding, table[i].offset - position);
+        file.write(reinterpret_cast<const char *>(levels[i].data()), levels[i].size());
+        position = table[i].offset + table[i].size;
+    }
+    file.write(padding, offset - position);
+    if (!file) {
+        std::cout << "ERROR::TEXTURE_BAKE::WRITE_FAILED " << destination << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string baked_texture_path(const std::string &source)
+{
+    return std::filesystem::path(source).replace_extension(BAKED_TEXTURE_EXTENSION).string();
+}
+
+std::string prefer_baked(const std::string &source)
+{
+    std::string baked = baked_texture_path(source);
+    std::error_code error;
+    auto bakedTime = std::filesystem::last_write_time(baked, error);
+    if (error) return source;
+    auto sourceTime = std::filesystem::last_write_time(source, error);
+    // 源文件不存在 (只发布了烘焙结果) 时同样使用烘焙文件
+    if (!error && sourceTime > bakedTime) return source;
+    return baked;
+}
+
+bool BakedTexture::open(const std::string &path)
+{
+    if (!file_.open(path)) return false;
+    const size_t size = file_.size();
+    header_ = reinterpret_cast<const BakedTextureHeader *>(file_.data());
+    bool valid = size >= sizeof(BakedTextureHeader) &&
+                 std::memcmp(header_->magic, BAKED_TEXTURE_MAGIC, sizeof(header_->magic)) == 0 &&
+                 header_->version == BAKED_TEXTURE_VERSION && header_->levelCount > 0 &&
+                 header_->levelCount <= 32 && header_->channels >= 1 && header_->channels <= 4 &&
+                 size >= sizeof(BakedTextureHeader) + header_->levelCount * sizeof(BakedLevel);
+    if (valid) {
+        levels_ = reinterpret_cast<const BakedLevel *>(file_.data() + sizeof(BakedTextureHeader));
+        std::optional<BlockFormat> format = block_format_from_gl(header_->internalFormat);
+        // upload_level 原样把这些字段交给 glTexImage2D/glCompressedTexImage2D，与 bake_pixels
+        // 写入的组合不符的文件在这里拒绝
+        valid = header_->type == GL_UNSIGNED_BYTE && levels_[0].width == header_->width &&
+                levels_[0].height == header_->height;
+        if (header_->blockBytes != 0) {
+            const BlockFormatInfo *info = format ? &block_format_info(*format) : nullptr;
+            valid = valid && info && info->blockBytes == header_->blockBytes &&
+                    info->format == header_->format && info->channels == header_->channels;
+        } else {
+            valid = valid && header_->format == channel_format(header_->channels) &&
+                    header_->internalFormat == header_->format;
+        }
+        for (uint32_t i = 0; i < header_->levelCount && valid; i++) {
+            const BakedLevel &level = levels_[i];
+            uint64_t expected =
+                header_->blockBytes != 0
+                    ? compressed_size(*format, level.width, level.height)
+                    : (uint64_t)level.width * level.height * header_->channels;
+            valid = level.offset <= size && level.size <= size - level.offset &&
+                    level.size == expected;
+        }
+    }
+    if (!valid) {
+        std::cout << "ERROR::TEXTURE_BAKE::INVALID_FILE " << path << std::endl;
+        file_.close();
+        header_ = nullptr;
+        levels_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+size_t BakedTexture::data_bytes() const
+{
+    size_t bytes = 0;
+    for (uint32_t i = 0; i < header_->levelCount; i++) bytes += levels_[i].size;
+    return bytes;
+}
+
+size_t BakedTexture::resident_bytes(uint32_t index) const
+{
+    const BakedLevel &level = levels_[index];
+    if (header_->blockBytes == 0) return level.size;
+    std::optional<BlockFormat> format = block_format_from_gl(header_->internalFormat);
+    if (block_format_supported(*format)) return level.size;
+    return (size_t)level.width * level.height * block_format_info(*format).channels;
+}
+
+void BakedTexture::upload_level(uint32_t index) const
+{
+    std::optional<BlockFormat> format;
+    if (header_->blockBytes != 0) format = block_format_from_gl(header_->internalFormat);
+    const BakedLevel &level = levels_[index];
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (format && block_format_supported(*format)) {
+        glCompressedTexImage2D(GL_TEXTURE_2D, index, header_->internalFormat, level.width,
+                               level.height, 0, static_cast<GLsizei>(level.size),
+                               level_data(index));
+    } else if (format) {
+        std::vector<uint8_t> pixels =
+            decompress_blocks(level_data(index), level.width, level.height, *format);
+        glTexImage2D(GL_TEXTURE_2D, index, header_->format, level.width, level.height, 0,
+                     header_->format, header_->type, pixels.data());
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, index, header_->internalFormat, level.width, level.height, 0,
+                     header_->format, header_->type, level_data(index));
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void BakedTexture::upload() const
+{
+    std::optional<BlockFormat> format;
+    if (header_->blockBytes != 0) format = block_format_from_gl(header_->internalFormat);
+    if (format && !block_format_supported(*format))
+        std::cout << "ERROR::TEXTURE_BAKE::FORMAT_UNSUPPORTED " << block_format_info(*format).name
+                  << ", decompressing on the CPU" << std::endl;
+    for (uint32_t i = 0; i < header_->levelCount; i++) upload_level(i);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header_->levelCount - 1);
+}
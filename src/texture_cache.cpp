@@ -0,0 +1,140 @@
+#include "texture_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include "gl_state.h"
+#include "mapped_file.h"
+
+namespace {
+// 4 路独立的乘法-移位混合，每轮 32 字节，链之间没有依赖，速度接近内存带宽
+uint64_t content_hash(const uint8_t *data, size_t size)
+{
+    constexpr uint64_t MULTIPLIER = 0x9E3779B97F4A7C15ull;
+    uint64_t lanes[4] = {size, size ^ 0x6A09E667F3BCC908ull, ~size, size + MULTIPLIER};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (uint32_t lane = 0; lane < 4; lane++) {
+            uint64_t word;
+            std::memcpy(&word, data + i + lane * 8, 8);
+            lanes[lane] = (lanes[lane] ^ word) * MULTIPLIER;
+            lanes[lane] ^= lanes[lane] >> 29;
+        }
+    }
+    uint64_t hash = lanes[0];
+    for (uint32_t lane = 1; lane < 4; lane++) hash = (hash ^ lanes[lane]) * MULTIPLIER;
+    for (; i < size; i += 8) {
+        uint64_t word = 0;
+        std::memcpy(&word, data + i, std::min<size_t>(8, size - i));
+        hash = (hash ^ word) * MULTIPLIER;
+        hash ^= hash >> 29;
+    }
+    return hash ^ (hash >> 32);
+}
+
+// 采样与解码选项不同的同一图像是不同的纹理
+std::string options_key(const TextureOptions &options)
+{
+    return std::to_string(options.flipVertically) + ',' + std::to_string(options.wrap) + ',' +
+           std::to_string(options.minFilter) + ',' + std::to_string(options.magFilter) + ',' +
+           std::to_string(static_cast<int>(options.mipFilter)) + ',' +
+           std::to_string(options.srgb);
+}
+}  // namespace
+
+TextureCache::TextureCache(TextureLoader &loader, bool shareContent)
+    : loader_(loader), shareContent_(shareContent)
+{
+}
+
+uint32_t TextureCache::acquire(const std::string &path, const TextureOptions &options)
+{
+    stats_.requests++;
+    const std::string optionsKey = options_key(options);
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+    const std::string pathKey = (error ? path : canonical.string()) + '\n' + optionsKey;
+    if (auto it = paths_.find(pathKey); it != paths_.end()) {
+        entries_[it->second].references++;
+        stats_.pathHits++;
+        return it->second;
+    }
+
+    // 新路径：映射文件求内容哈希，比解码便宜得多，命中时连解码一起省掉
+    std::string contentKey;
+    MappedFile file;
+    if (shareContent_ && std::filesystem::is_regular_file(path, error) && file.open(path)) {
+        contentKey = optionsKey + '\n' + std::to_string(content_hash(file.data(), file.size())) +
+                     ':' + std::to_string(file.size());
+        if (auto it = contents_.find(contentKey); it != contents_.end()) {
+            Entry &entry = entries_[it->second];
+            MappedFile other;
+            if (other.open(entry.path) && other.size() == file.size() &&
+                std::memcmp(other.data(), file.data(), file.size()) == 0) {
+                entry.references++;
+                entry.pathKeys.push_back(pathKey);
+                paths_[pathKey] = it->second;
+                stats_.contentHits++;
+                return it->second;
+            }
+            // 哈希碰撞，或者登记的文件已经被改写，这个纹理不再按内容共享
+            contentKey.clear();
+        }
+    }
+
+    uint32_t texture = loader_.load(path, options);
+    entries_[texture] = {{pathKey}, contentKey, path, 1};
+    paths_[pathKey] = texture;
+    if (!contentKey.empty()) contents_[contentKey] = texture;
+    return texture;
+}
+
+void TextureCache::release(uint32_t texture)
+{
+    auto it = entries_.find(texture);
+    if (it == entries_.end()) {
+        std::cout << "ERROR::TEXTURE_CACHE::UNKNOWN_TEXTURE " << texture << std::endl;
+        return;
+    }
+    if (--it->second.references > 0) return;
+    erase(texture);
+    stats_.evictions++;
+}
+
+void TextureCache::erase(uint32_t texture)
+{
+    const Entry &entry = entries_.at(texture);
+    for (const std::string &key : entry.pathKeys) paths_.erase(key);
+    if (!entry.contentKey.empty()) contents_.erase(entry.contentKey);
+    loader_.cancel(texture);
+    gl_state().delete_textures(1, &texture);
+    entries_.erase(texture);
+}
+
+void TextureCache::clear()
+{
+    for (const auto &[texture, entry] : entries_) {
+        loader_.cancel(texture);
+        gl_state().delete_textures(1, &texture);
+    }
+    entries_.clear();
+    paths_.clear();
+    contents_.clear();
+}
+
+uint32_t TextureCache::references(uint32_t texture) const
+{
+    auto it = entries_.find(texture);
+    return it == entries_.end() ? 0 : it->second.references;
+}
+
+TextureCache::Stats TextureCache::stats() const
+{
+    Stats stats = stats_;
+    stats.textures = static_cast<uint32_t>(entries_.size());
+    for (const auto &[texture, entry] : entries_)
+        stats.residentBytes += loader_.texture_bytes(texture);
+    return stats;
+}
@@ -0,0 +1,283 @@
+#include "texture_loader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+#include "gl_state.h"
+#include "stb_image.h"
+
+namespace {
+GLenum channel_format(int channels)
+{
+    switch (channels) {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 3: return GL_RGB;
+        default: return GL_RGBA;
+    }
+}
+
+bool uses_mipmaps(GLint minFilter)
+{
+    return minFilter != GL_NEAREST && minFilter != GL_LINEAR;
+}
+}  // namespace
+
+TextureLoader::TextureLoader(uint32_t threads, size_t stagingBytes) : ring_(stagingBytes)
+{
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    threads = std::max(threads, 1u);
+    for (uint32_t i = 0; i < threads; i++) workers_.emplace_back(&TextureLoader::run, this);
+}
+
+TextureLoader::~TextureLoader()
+{
+    stop();
+}
+
+void TextureLoader::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    jobReady_.notify_all();
+    for (std::thread &worker : workers_) worker.join();
+    workers_.clear();
+    for (Decoded &image : ready_) stbi_image_free(image.pixels);
+    ready_.clear();
+}
+
+void TextureLoader::release()
+{
+    stop();
+    ring_.release();
+}
+
+uint32_t TextureLoader::load(const std::string &path, const TextureOptions &options)
+{
+    const uint8_t placeholder[4] = {128, 128, 128, 255};
+    uint32_t texture;
+    glGenTextures(1, &texture);
+    gl_state().edit_texture(GL_TEXTURE_2D, texture);
+    // 1x1 的 level 0 本身就是完整的 mipmap 链，带 mipmap 的过滤方式也能直接采样
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, options.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, options.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, options.minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, options.magFilter);
+
+    const uint64_t serial = nextSerial_++;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back({serial, texture, path, options});
+    }
+    jobReady_.notify_one();
+    submitted_++;
+    inFlight_[texture] = serial;
+    residentBytes_[texture] = sizeof(placeholder);
+    return texture;
+}
+
+bool TextureLoader::cancel(uint32_t texture)
+{
+    residentBytes_.erase(texture);
+    auto it = inFlight_.find(texture);
+    if (it == inFlight_.end()) return false;
+    const uint64_t serial = it->second;
+    inFlight_.erase(it);
+    {
+        // 还在排队的任务直接移除，已被工作线程取走的等结果出来后丢弃
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto job = std::find_if(jobs_.begin(), jobs_.end(),
+                                [serial](const Job &job) { return job.serial == serial; });
+        if (job != jobs_.end()) {
+            jobs_.erase(job);
+            completed_++;
+            return true;
+        }
+    }
+    cancelled_.insert(serial);
+    return true;
+}
+
+size_t TextureLoader::texture_bytes(uint32_t texture) const
+{
+    auto it = residentBytes_.find(texture);
+    return it == residentBytes_.end() ? 0 : it->second;
+}
+
+void TextureLoader::run()
+{
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            jobReady_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+            if (stopping_) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        int width = 0, height = 0, channels = 0;
+        unsigned char *pixels = nullptr;
+        std::unique_ptr<BakedTexture> baked;
+        if (std::string_view(job.path).ends_with(BAKED_TEXTURE_EXTENSION)) {
+            // 烘焙文件不需要解码，在这里映射并把页读进内存，GL 线程上传时不会再缺页
+            baked = std::make_unique<BakedTexture>();
+            if (baked->open(job.path)) {
+                baked->prefetch();
+                width = baked->header().width;
+                height = baked->header().height;
+                channels = baked->header().channels;
+            } else {
+                baked.reset();
+            }
+        } else {
+            // 翻转开关是线程局部的，各任务互不影响
+            stbi_set_flip_vertically_on_load_thread(job.options.flipVertically);
+            pixels = stbi_load(job.path.c_str(), &width, &height, &channels, 0);
+        }
+        MipChain mips;
+        if (pixels != nullptr && uses_mipmaps(job.options.minFilter)) {
+            mips = generate_mips(pixels, width, height, channels,
+                                 {job.options.mipFilter, job.options.srgb});
+        }
+        // 持久映射时在工作线程上把整条链拷进 staging，GL 线程只剩下发出上传命令；
+        // ring 已满时保留原来的内存，由 GL 线程再尝试 stage
+        PixelUploadRing::Allocation staging;
+        if (pixels != nullptr && ring_.persistent()) {
+            size_t bytes = (size_t)width * height * channels;
+            staging = ring_.allocate(bytes + mips.data.size());
+            if (staging.serial != 0) {
+                std::memcpy(staging.data, pixels, bytes);
+                if (!mips.data.empty())
+                    std::memcpy(staging.data + bytes, mips.data.data(), mips.data.size());
+                stbi_image_free(pixels);
+                pixels = nullptr;
+                mips.data = {};
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ready_.push_back({std::move(job), pixels, width, height, channels, std::move(mips),
+                              staging, std::move(baked)});
+        }
+        decoded_.notify_one();
+    }
+}
+
+void TextureLoader::upload(const Decoded &image)
+{
+    completed_++;
+    if (cancelled_.erase(image.job.serial) > 0) {
+        // 工作线程写入的 staging 区域没有被任何命令引用，随本帧的 fence 一起回收
+        ring_.submit(image.staging);
+        if (image.pixels != nullptr) stbi_image_free(image.pixels);
+        return;
+    }
+    inFlight_.erase(image.job.texture);
+    if (image.pixels == nullptr && image.staging.serial == 0 && !image.baked) {
+        std::cout << "ERROR::TEXTURE_LOADER::DECODE_FAILED " << image.job.path << std::endl;
+        return;
+    }
+    if (image.baked) {
+        // mip 链已经烘焙好，从映射的文件逐级上传
+        auto start = std::chrono::steady_clock::now();
+        gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        gl_state().edit_texture(GL_TEXTURE_2D, image.job.texture);
+        image.baked->upload();
+        uploadStats_.uploadNs += std::chrono::duration<double, std::nano>(
+                                     std::chrono::steady_clock::now() - start)
+                                     .count();
+        uploadStats_.bytes += image.baked->data_bytes();
+        uploadStats_.direct++;
+        residentBytes_[image.job.texture] = image.baked->data_bytes();
+        return;
+    }
+    const size_t bytes = (size_t)image.width * image.height * image.channels;
+    const std::vector<MipChain::Level> &levels = image.mips.levels;
+    const size_t mipBytes = levels.empty() ? 0 : levels.back().offset + levels.back().size;
+    auto start = std::chrono::steady_clock::now();
+    // 工作线程已经写入 staging 时 mip 链紧跟在 level 0 之后；否则在这里分别 stage 两者，
+    // 放不下的部分从客户端内存直接上传
+    PixelUploadRing::Allocation staging = image.staging;
+    PixelUploadRing::Allocation mipStaging;
+    size_t mipOffset = staging.offset + bytes;
+    if (staging.serial == 0) staging = ring_.stage(image.pixels, bytes);
+
+    GLenum format = channel_format(image.channels);
+    auto upload_level = [&](GLint level, uint32_t width, uint32_t height, bool staged,
+                            size_t offset, const uint8_t *pixels) {
+        // 绑定了 PIXEL_UNPACK_BUFFER 时 glTexImage2D 的数据指针是 buffer 内的偏移
+        gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, staged ? ring_.id_ : 0);
+        const void *data = staged ? reinterpret_cast<const void *>(offset) : pixels;
+        glTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, format, GL_UNSIGNED_BYTE,
+                     data);
+    };
+    gl_state().edit_texture(GL_TEXTURE_2D, image.job.texture);
+    // RGB 等格式的行宽不一定是 4 的倍数
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    upload_level(0, image.width, image.height, staging.serial != 0, staging.offset, image.pixels);
+    // mip 链在 level 0 的 glTexImage2D 发出之后才 stage：放不下时 orphan 模式会换掉 PBO 的存储，
+    // 已经发出的命令仍读旧存储，而还没发出的 level 0 会读到未定义的新存储
+    if (image.staging.serial == 0 && mipBytes > 0) {
+        mipStaging = ring_.stage(image.mips.data.data(), mipBytes);
+        mipOffset = mipStaging.offset;
+    }
+    const bool mipsStaged = image.staging.serial != 0 || mipStaging.serial != 0;
+    for (size_t i = 0; i < levels.size(); i++) {
+        upload_level(static_cast<GLint>(i + 1), levels[i].width, levels[i].height, mipsStaged,
+                     mipOffset + levels[i].offset, image.mips.data.data() + levels[i].offset);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    if (!levels.empty()) glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels.size());
+    ring_.submit(staging);
+    ring_.submit(mipStaging);
+    uploadStats_.uploadNs += std::chrono::duration<double, std::nano>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+    uploadStats_.bytes += bytes + mipBytes;
+    residentBytes_[image.job.texture] = bytes + mipBytes;
+    if (staging.serial != 0)
+        uploadStats_.staged++;
+    else
+        uploadStats_.direct++;
+    if (image.pixels != nullptr) stbi_image_free(image.pixels);
+}
+
+void TextureLoader::update(size_t byteBudget)
+{
+    frameBytes_ = 0;
+    while (true) {
+        Decoded image;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (ready_.empty()) break;
+            size_t bytes = (size_t)ready_.front().width * ready_.front().height *
+                           ready_.front().channels;
+            if (frameBytes_ > 0 && frameBytes_ + bytes > byteBudget) break;
+            image = std::move(ready_.front());
+            ready_.pop_front();
+            frameBytes_ += bytes;
+        }
+        upload(image);
+    }
+    // 其它代码的 glTexImage2D 传的是客户端指针，不能留着 PBO 绑定
+    gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    // 每帧一个 fence，同时回收已经完成的区域
+    ring_.fence();
+}
+
+void TextureLoader::finish()
+{
+    while (pending() > 0) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            decoded_.wait(lock, [this]() { return !ready_.empty(); });
+        }
+        update(SIZE_MAX);
+    }
+}
@@ -0,0 +1,209 @@
+#include "texture_residency.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <optional>
+
+#include "block_compress.h"
+#include "gl_state.h"
+
+TextureResidency::TextureResidency(size_t budgetBytes, size_t uploadBudget)
+    : budget_(budgetBytes), uploadBudget_(uploadBudget)
+{
+}
+
+uint32_t TextureResidency::add(const std::string &path)
+{
+    auto file = std::make_unique<BakedTexture>();
+    if (!file->open(path)) return INVALID;
+    const BakedTextureHeader &header = file->header();
+
+    Texture texture = {};
+    texture.levels = header.levelCount;
+    std::optional<BlockFormat> format = block_format_from_gl(header.internalFormat);
+    texture.compressed = header.blockBytes != 0 && block_format_supported(*format);
+    texture.tail = texture.levels - 1;
+    while (texture.tail > 0 &&
+           std::max(file->level(texture.tail - 1).width, file->level(texture.tail - 1).height) <=
+               RESIDENT_TAIL_SIZE)
+        texture.tail--;
+    size_t tailBytes = 0;
+    for (uint32_t i = 0; i < texture.levels; i++) {
+        texture.levelBytes.push_back(file->resident_bytes(i));
+        if (i >= texture.tail) tailBytes += texture.levelBytes[i];
+    }
+    // 常驻级别不能丢弃，腾不出位置时拒绝加入，而不是让驻留量超出预算
+    if (!make_room(tailBytes, true, nullptr) && !make_room(tailBytes, false, nullptr)) {
+        std::cout << "ERROR::TEXTURE_RESIDENCY::OVER_BUDGET " << path << " needs " << tailBytes
+                  << " resident bytes" << std::endl;
+        return INVALID;
+    }
+
+    glGenTextures(1, &texture.id);
+    gl_state().edit_texture(GL_TEXTURE_2D, texture.id);
+    gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    for (uint32_t i = texture.tail; i < texture.levels; i++) {
+        file->upload_level(i);
+        resident_ += texture.levelBytes[i];
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.tail);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.levels - 1);
+    peak_ = std::max(peak_, resident_);
+
+    texture.file = std::move(file);
+    texture.base = texture.tail;
+    texture.wanted = texture.tail;
+    textures_.push_back(std::move(texture));
+    return static_cast<uint32_t>(textures_.size() - 1);
+}
+
+void TextureResidency::set_view(const Camera &camera, float viewportHeight)
+{
+    eye_ = camera.Position;
+    pixelsPerUnit_ = viewportHeight / (2.0f * std::tan(glm::radians(camera.Zoom) * 0.5f));
+}
+
+void TextureResidency::use(uint32_t handle, const glm::vec3 &center, float radius)
+{
+    Texture &texture = textures_[handle];
+    // 相机在包围球内时按极近处理，需要最高一级
+    float distance = std::max(glm::length(center - eye_) - radius, 1e-3f);
+    texture.pixels = std::max(texture.pixels, 2.0f * radius * pixelsPerUnit_ / distance);
+    texture.lastUsed = frame_;
+}
+
+void TextureResidency::stream_in(Texture &texture)
+{
+    const uint32_t level = texture.base - 1;
+    gl_state().edit_texture(GL_TEXTURE_2D, texture.id);
+    texture.file->upload_level(level);
+    // 新的一级上传完之后才放开采样，纹理始终是完整的
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    texture.base = level;
+    resident_ += texture.levelBytes[level];
+    peak_ = std::max(peak_, resident_);
+    frameUploaded_ += texture.levelBytes[level];
+    levelsStreamed_++;
+}
+
+void TextureResidency::drop(Texture &texture)
+{
+    const uint32_t level = texture.base++;
+    const BakedTextureHeader &header = texture.file->header();
+    gl_state().edit_texture(GL_TEXTURE_2D, texture.id);
+    // 先把采样范围移出这一级，再把它重新定义为空图像
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.base);
+    if (texture.compressed)
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, header.internalFormat, 0, 0, 0, 0, nullptr);
+    else
+        glTexImage2D(GL_TEXTURE_2D, level, header.format, 0, 0, 0, header.format, header.type,
+                     nullptr);
+    resident_ -= texture.levelBytes[level];
+    levelsDropped_++;
+}
+
+bool TextureResidency::make_room(size_t bytes, bool onlyUnwanted, const Texture *except)
+{
+    if (resident_ + bytes <= budget_) return true;
+    // 最久未使用的在前；同一帧使用过的，屏幕上小的在前
+    std::vector<Texture *> victims;
+    for (Texture &texture : textures_) {
+        uint32_t keep = onlyUnwanted ? texture.wanted : texture.tail;
+        if (&texture != except && texture.base < keep) victims.push_back(&texture);
+    }
+    std::sort(victims.begin(), victims.end(), [](const Texture *a, const Texture *b) {
+        if (a->lastUsed != b->lastUsed) return a->lastUsed < b->lastUsed;
+        return a->pixels < b->pixels;
+    });
+    for (Texture *victim : victims) {
+        uint32_t keep = onlyUnwanted ? victim->wanted : victim->tail;
+        while (victim->base < keep && resident_ + bytes > budget_) drop(*victim);
+        if (resident_ + bytes <= budget_) return true;
+    }
+    return false;
+}
+
+void TextureResidency::update()
+{
+    auto start = std::chrono::steady_clock::now();
+    frameUploaded_ = 0;
+    starved_ = 0;
+    gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // 最长边 size 的纹理覆盖 pixels 个像素时，纹素与像素一比一的级别是 log2(size / pixels)
+    for (Texture &texture : textures_) {
+        texture.wanted = texture.tail;
+        if (texture.lastUsed != frame_) continue;
+        const BakedTextureHeader &header = texture.file->header();
+        float ratio = std::max(header.width, header.height) / std::max(texture.pixels, 1.0f);
+        uint32_t level = ratio <= 1.0f ? 0 : static_cast<uint32_t>(std::floor(std::log2(ratio)));
+        texture.wanted = std::min(level, texture.tail);
+    }
+
+    // 预算被调低：先丢用不到的级别，仍然超出时连正在使用的也按 LRU 丢弃
+    if (resident_ > budget_ && !make_room(0, true, nullptr)) make_room(0, false, nullptr);
+
+    // 缺得多的优先，缺得一样多时屏幕上大的优先
+    std::vector<Texture *> queue;
+    for (Texture &texture : textures_) {
+        if (texture.wanted < texture.base) queue.push_back(&texture);
+    }
+    std::sort(queue.begin(), queue.end(), [](const Texture *a, const Texture *b) {
+        uint32_t missingA = a->base - a->wanted, missingB = b->base - b->wanted;
+        if (missingA != missingB) return missingA > missingB;
+        return a->pixels > b->pixels;
+    });
+    // 每轮每个纹理只补一级，避免一张大纹理独占本帧的上传预算
+    bool progress = true, exhausted = false;
+    while (progress && !exhausted) {
+        progress = false;
+        for (Texture *texture : queue) {
+            if (texture->base <= texture->wanted) continue;
+            size_t bytes = texture->levelBytes[texture->base - 1];
+            // 与 TextureLoader 一样，本帧还没上传过时即使超出预算也放行一级，否则大级别永远排不上
+            if (frameUploaded_ > 0 && frameUploaded_ + bytes > uploadBudget_) {
+                exhausted = true;
+                break;
+            }
+            if (!make_room(bytes, true, texture)) continue;
+            stream_in(*texture);
+            progress = true;
+        }
+    }
+    for (Texture &texture : textures_) {
+        if (texture.lastUsed == frame_ && texture.base > texture.wanted) starved_++;
+        texture.pixels = 0.0f;
+    }
+    frameUploadNs_ =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+            .count();
+    frame_++;
+}
+
+TextureResidency::Stats TextureResidency::stats() const
+{
+    Stats stats;
+    stats.budget = budget_;
+    stats.resident = resident_;
+    stats.peak = peak_;
+    stats.frameUploaded = frameUploaded_;
+    stats.frameUploadNs = frameUploadNs_;
+    stats.textures = static_cast<uint32_t>(textures_.size());
+    stats.starved = starved_;
+    stats.levelsStreamed = levelsStreamed_;
+    stats.levelsDropped = levelsDropped_;
+    return stats;
+}
+
+void TextureResidency::release()
+{
+    for (Texture &texture : textures_) gl_state().delete_textures(1, &texture.id);
+    textures_.clear();
+    resident_ = 0;
+}
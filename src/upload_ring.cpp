@@ -0,0 +1,214 @@
+#include "upload_ring.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "gl_state.h"
+
+namespace {
+// 每个区域按 64 字节对齐，避免不同线程写入的区域共享 cache line
+constexpr size_t ALLOCATION_ALIGNMENT = 64;
+
+size_t align_up(size_t size)
+{
+    return (size + ALLOCATION_ALIGNMENT - 1) & ~(ALLOCATION_ALIGNMENT - 1);
+}
+}  // namespace
+
+PixelUploadRing::PixelUploadRing(size_t capacity) : capacity_(align_up(capacity))
+{
+    if (capacity_ == 0) return;
+    glGenBuffers(1, &id_);
+    gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, id_);
+    if (GLAD_GL_VERSION_4_4) {
+        // COHERENT：工作线程写入后无需 glFlushMappedBufferRange，之后发出的上传命令就能看到
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, capacity_, nullptr, flags);
+        mapped_ = static_cast<uint8_t *>(
+            glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, capacity_, flags));
+    } else {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, capacity_, nullptr, GL_STREAM_DRAW);
+    }
+    gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+PixelUploadRing::Allocation PixelUploadRing::allocate_locked(size_t size)
+{
+    Allocation allocation;
+    size = align_up(size);
+    if (size == 0 || size > capacity_ || used_ == capacity_) return allocation;
+    if (used_ == 0) head_ = 0;
+    size_t tail = (head_ + capacity_ - used_) % capacity_;
+    size_t offset;
+    size_t skipped = 0;
+    if (head_ >= tail) {
+        // 空闲区间为 [head, capacity) 与 [0, tail)，尾部放不下时跳过它回绕到开头
+        if (capacity_ - head_ >= size) {
+            offset = head_;
+        } else if (tail >= size) {
+            offset = 0;
+            skipped = capacity_ - head_;
+        } else {
+            return allocation;
+        }
+    } else {
+        if (tail - head_ < size) return allocation;
+        offset = head_;
+    }
+    head_ = (offset + size) % capacity_;
+    used_ += skipped + size;
+    peak_ = std::max(peak_, used_);
+
+    allocation.data = mapped_ ? mapped_ + offset : nullptr;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.serial = nextSerial_++;
+    // orphan 模式不回收单个区域，整个 buffer 一起被 orphan
+    if (mapped_) regions_.push_back({allocation.serial, skipped + size});
+    return allocation;
+}
+
+PixelUploadRing::Allocation PixelUploadRing::allocate(size_t size)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!mapped_) return Allocation();
+    return allocate_locked(size);
+}
+
+PixelUploadRing::Allocation PixelUploadRing::stage(const void *pixels, size_t size)
+{
+    Allocation allocation;
+    if (!enabled()) return allocation;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            allocation = allocate_locked(size);
+        }
+        if (allocation.serial != 0 || align_up(size) > capacity_) break;
+        if (!mapped_) {
+            orphan();
+        } else if (!poll_fences(true)) {
+            // 剩下的区域都还没有 submit (工作线程写入的图像尚未上传)，等不到空间
+            return allocation;
+        }
+    }
+    if (allocation.serial == 0) return allocation;
+
+    if (mapped_) {
+        std::memcpy(allocation.data, pixels, size);
+    } else {
+        // 区域在这次 orphan 之后没有被写过，不需要与 GPU 同步
+        gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, id_);
+        void *data = glMapBufferRange(
+            GL_PIXEL_UNPACK_BUFFER, allocation.offset, allocation.size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (data != nullptr) std::memcpy(data, pixels, size);
+        if (data == nullptr || !glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) allocation = Allocation();
+    }
+    return allocation;
+}
+
+void PixelUploadRing::submit(const Allocation &allocation)
+{
+    if (!mapped_ || allocation.serial == 0) return;
+    if (pendingFence_ == 0) pendingFence_ = nextFence_++;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Region &region : regions_) {
+        if (region.serial == allocation.serial) {
+            region.fence = pendingFence_;
+            break;
+        }
+    }
+}
+
+void PixelUploadRing::fence()
+{
+    if (!mapped_) return;
+    if (pendingFence_ != 0) {
+        fences_.push_back({pendingFence_, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)});
+        pendingFence_ = 0;
+    }
+    poll_fences(false);
+}
+
+void PixelUploadRing::retire_locked(uint64_t completed)
+{
+    while (!regions_.empty() && regions_.front().fence != 0 &&
+           regions_.front().fence <= completed) {
+        used_ -= regions_.front().bytes;
+        regions_.pop_front();
+    }
+}
+
+bool PixelUploadRing::poll_fences(bool wait)
+{
+    if (wait && fences_.empty() && pendingFence_ != 0) {
+        // 本帧已经 submit 的区域还没有 fence，先补一个
+        fences_.push_back({pendingFence_, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)});
+        pendingFence_ = 0;
+    }
+    uint64_t completed = 0;
+    while (!fences_.empty()) {
+        GLenum result = glClientWaitSync(fences_.front().sync, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED && wait && completed == 0) {
+            auto start = std::chrono::steady_clock::now();
+            result = glClientWaitSync(fences_.front().sync, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                      1000000000ull);
+            fenceWaitNs_ += std::chrono::duration<double, std::nano>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+            fenceWaits_++;
+        }
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) break;
+        completed = fences_.front().serial;
+        glDeleteSync(fences_.front().sync);
+        fences_.pop_front();
+    }
+    if (completed == 0) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t before = used_;
+    retire_locked(completed);
+    return used_ < before;
+}
+
+void PixelUploadRing::orphan()
+{
+    gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, id_);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, capacity_, nullptr, GL_STREAM_DRAW);
+    std::lock_guard<std::mutex> lock(mutex_);
+    head_ = 0;
+    used_ = 0;
+    orphans_++;
+}
+
+void PixelUploadRing::release()
+{
+    if (!enabled()) return;
+    for (Fence &fence : fences_) glDeleteSync(fence.sync);
+    fences_.clear();
+    gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, id_);
+    if (mapped_) glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    gl_state().delete_buffers(1, &id_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    mapped_ = nullptr;
+    id_ = 0;
+    capacity_ = 0;
+    regions_.clear();
+    used_ = 0;
+}
+
+PixelUploadRing::Stats PixelUploadRing::stats() const
+{
+    Stats stats;
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.capacity = capacity_;
+    stats.persistent = mapped_ != nullptr;
+    stats.inUse = used_;
+    stats.peak = peak_;
+    stats.fenceWaits = fenceWaits_;
+    stats.fenceWaitNs = fenceWaitNs_;
+    stats.orphans = orphans_;
+    return stats;
+}
@@ -0,0 +1,316 @@
+#include "vertex_layout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "gl_state.h"
+
+namespace {
+uint16_t float_to_half(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = (bits >> 16) & 0x8000;
+    const uint32_t magnitude = bits & 0x7FFFFFFF;
+    if (magnitude >= 0x7F800000) return sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0);
+    // 舍入后不小于 65520 的数溢出为无穷
+    if (magnitude >= 0x477FF000) return sign | 0x7C00;
+    // 小于 2^-14 时为 half 的非规格化数，以 2^-24 为单位舍入
+    if (magnitude < 0x38800000) {
+        float absolute;
+        std::memcpy(&absolute, &magnitude, sizeof(absolute));
+        return sign | static_cast<uint16_t>(std::nearbyint(absolute * 16777216.0f));
+    }
+    // 指数的偏置从 127 改为 15，尾数截掉 13 位，就近舍入到偶数
+    uint32_t half = (magnitude - 0x38000000) >> 13;
+    const uint32_t rest = magnitude & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+    return sign | static_cast<uint16_t>(half);
+}
+
+float half_to_float(uint16_t half)
+{
+    const uint32_t sign = (half & 0x8000u) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1F;
+    const uint32_t mantissa = half & 0x3FF;
+    if (exponent == 0) {
+        float value = mantissa / 16777216.0f;
+        return sign ? -value : value;
+    }
+    uint32_t bits = sign | (mantissa << 13) |
+                    (exponent == 31 ? 0x7F800000 : (exponent + 112) << 23);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+int32_t to_snorm(float value, int32_t max)
+{
+    return static_cast<int32_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * max));
+}
+
+// 与 GL 4.2 之后的规则相同：-max 与 -max - 1 都还原为 -1
+float from_snorm(int32_t value, int32_t max)
+{
+    return std::max(value / float(max), -1.0f);
+}
+
+// 与 shader/octahedral.glsl 中的 EncodeNormal/DecodeNormal 相同
+void encode_octahedral(const float *n, float *out)
+{
+    float sum = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+    float x = sum > 0.0f ? n[0] / sum : 0.0f, y = sum > 0.0f ? n[1] / sum : 0.0f;
+    if (n[2] < 0.0f) {
+        float wrappedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float wrappedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = wrappedX;
+        y = wrappedY;
+    }
+    out[0] = x;
+    out[1] = y;
+}
+
+void decode_octahedral(float x, float y, float *n)
+{
+    n[0] = x;
+    n[1] = y;
+    n[2] = 1.0f - std::abs(x) - std::abs(y);
+    float t = std::clamp(-n[2], 0.0f, 1.0f);
+    n[0] += n[0] >= 0.0f ? -t : t;
+    n[1] += n[1] >= 0.0f ? -t : t;
+    float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    for (uint32_t c = 0; c < 3; c++) n[c] /= length;
+}
+
+// 向下取整的格点及其右、上、右上 4 个候选中，选还原后与原方向夹角最小的那个，
+// 8 位时误差明显小于直接四舍五入
+void quantize_octahedral(const float *n, int32_t max, int32_t *out)
+{
+    float encoded[2];
+    encode_octahedral(n, encoded);
+    const int32_t baseX = static_cast<int32_t>(std::floor(encoded[0] * max));
+    const int32_t baseY = static_cast<int32_t>(std::floor(encoded[1] * max));
+    float best = -2.0f;
+    for (int32_t dy = 0; dy <= 1; dy++) {
+        for (int32_t dx = 0; dx <= 1; dx++) {
+            int32_t x = std::clamp(baseX + dx, -max, max), y = std::clamp(baseY + dy, -max, max);
+            float decoded[3];
+            decode_octahedral(x / float(max), y / float(max), decoded);
+            float dot = decoded[0] * n[0] + decoded[1] * n[1] + decoded[2] * n[2];
+            if (dot > best) {
+                best = dot;
+                out[0] = x;
+                out[1] = y;
+            }
+        }
+    }
+}
+
+uint32_t format_size(const VertexAttribute &attribute)
+{
+    switch (attribute.format) {
+        case VertexFormat::Float: return attribute.components * 4;
+        case VertexFormat::Half:
+        case VertexFormat::Unorm16:
+        case VertexFormat::Snorm16: return attribute.components * 2;
+        case VertexFormat::Int2_10_10_10: return 4;
+        case VertexFormat::Octahedral8: return 2;
+        case VertexFormat::Octahedral16: return 4;
+    }
+    return 0;
+}
+
+// GL 要求属性的偏移是其分量类型大小的整数倍
+uint32_t format_alignment(VertexFormat format)
+{
+    switch (format) {
+        case VertexFormat::Float:
+        case VertexFormat::Int2_10_10_10: return 4;
+        case VertexFormat::Half:
+        case VertexFormat::Unorm16:
+        case VertexFormat::Snorm16:
+        case VertexFormat::Octahedral16: return 2;
+        case VertexFormat::Octahedral8: return 1;
+    }
+    return 4;
+}
+}  // namespace
+
+VertexLayout::VertexLayout(const std::vector<VertexAttribute> &attributes)
+    : attributes_(attributes)
+{
+    uint32_t offset = 0;
+    for (const VertexAttribute &attribute : attributes_) {
+        const uint32_t alignment = format_alignment(attribute.format);
+        offset = (offset + alignment - 1) / alignment * alignment;
+        offsets_.push_back(offset);
+        offset += format_size(attribute);
+        components_ += attribute.components;
+    }
+    stride_ = (offset + 3) / 4 * 4;
+}
+
+std::vector<uint8_t> VertexLayout::pack(const float *vertices, size_t vertexCount) const
+{
+    std::vector<uint8_t> data(vertexCount * stride_, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        const float *source = vertices + v * components_;
+        uint8_t *vertex = &data[v * stride_];
+        for (size_t a = 0; a < attributes_.size(); a++) {
+            const VertexAttribute &attribute = attributes_[a];
+            uint8_t *dst = vertex + offsets_[a];
+            switch (attribute.format) {
+                case VertexFormat::Float:
+                    std::memcpy(dst, source, attribute.components * sizeof(float));
+                    break;
+                case VertexFormat::Half:
+                case VertexFormat::Unorm16:
+                case VertexFormat::Snorm16:
+                    for (uint32_t c = 0; c < attribute.components; c++) {
+                        uint16_t value;
+                        if (attribute.format == VertexFormat::Half)
+                            value = float_to_half(source[c]);
+                        else if (attribute.format == VertexFormat::Unorm16)
+                            value = static_cast<uint16_t>(
+                                std::lround(std::clamp(source[c], 0.0f, 1.0f) * 65535.0f));
+                        else
+                            value = static_cast<uint16_t>(to_snorm(source[c], 32767));
+                        std::memcpy(dst + c * 2, &value, 2);
+                    }
+                    break;
+                case VertexFormat::Int2_10_10_10: {
+                    uint32_t packed = 0;
+                    for (uint32_t c = 0; c < 3; c++) {
+                        float value = c < attribute.components ? source[c] : 0.0f;
+                        packed |= (static_cast<uint32_t>(to_snorm(value, 511)) & 0x3FF) << (c * 10);
+                    }
+                    std::memcpy(dst, &packed, 4);
+                    break;
+                }
+                case VertexFormat::Octahedral8:
+                case VertexFormat::Octahedral16: {
+                    const bool wide = attribute.format == VertexFormat::Octahedral16;
+                    int32_t encoded[2];
+                    quantize_octahedral(source, wide ? 32767 : 127, encoded);
+                    for (uint32_t c = 0; c < 2; c++) {
+                        if (wide) {
+                            int16_t value = static_cast<int16_t>(encoded[c]);
+                            std::memcpy(dst + c * 2, &value, 2);
+                        } else {
+                            dst[c] = static_cast<uint8_t>(static_cast<int8_t>(encoded[c]));
+                        }
+                    }
+                    break;
+                }
+            }
+            source += attribute.components;
+        }
+    }
+    return data;
+}
+
+std::vector<float> VertexLayout::unpack(const uint8_t *data, size_t vertexCount) const
+{
+    std::vector<float> vertices(vertexCount * components_);
+    for (size_t v = 0; v < vertexCount; v++) {
+        float *dst = &vertices[v * components_];
+        const uint8_t *vertex = data + v * stride_;
+        for (size_t a = 0; a < attributes_.size(); a++) {
+            const VertexAttribute &attribute = attributes_[a];
+            const uint8_t *source = vertex + offsets_[a];
+            switch (attribute.format) {
+                case VertexFormat::Float:
+                    std::memcpy(dst, source, attribute.components * sizeof(float));
+                    break;
+                case VertexFormat::Half:
+                case VertexFormat::Unorm16:
+                case VertexFormat::Snorm16:
+                    for (uint32_t c = 0; c < attribute.components; c++) {
+                        uint16_t value;
+                        std::memcpy(&value, source + c * 2, 2);
+                        if (attribute.format == VertexFormat::Half)
+                            dst[c] = half_to_float(value);
+                        else if (attribute.format == VertexFormat::Unorm16)
+                            dst[c] = value / 65535.0f;
+                        else
+                            dst[c] = from_snorm(static_cast<int16_t>(value), 32767);
+                    }
+                    break;
+                case VertexFormat::Int2_10_10_10: {
+                    uint32_t packed;
+                    std::memcpy(&packed, source, 4);
+                    for (uint32_t c = 0; c < attribute.components && c < 3; c++) {
+                        // 10 位有符号数：移到最高位再算术右移完成符号扩展
+                        int32_t value = static_cast<int32_t>(packed << (22 - c * 10)) >> 22;
+                        dst[c] = from_snorm(value, 511);
+                    }
+                    break;
+                }
+                case VertexFormat::Octahedral8:
+                case VertexFormat::Octahedral16: {
+                    float encoded[2];
+                    for (uint32_t c = 0; c < 2; c++) {
+                        if (attribute.format == VertexFormat::Octahedral16) {
+                            int16_t value;
+                            std::memcpy(&value, source + c * 2, 2);
+                            encoded[c] = from_snorm(value, 32767);
+                        } else {
+                            encoded[c] = from_snorm(static_cast<int8_t>(source[c]), 127);
+                        }
+                    }
+                    float decoded[3];
+                    decode_octahedral(encoded[0], encoded[1], decoded);
+                    std::copy_n(decoded, std::min(attribute.components, 3u), dst);
+                    break;
+                }
+            }
+            dst += attribute.components;
+        }
+    }
+    return vertices;
+}
+
+void VertexLayout::attach(uint32_t vao, uint32_t vbo) const
+{
+    gl_state().bind_vertex_array(vao);
+    gl_state().bind_buffer(GL_ARRAY_BUFFER, vbo);
+    for (uint32_t location = 0; location < attributes_.size(); location++) {
+        const VertexAttribute &attribute = attributes_[location];
+        GLint size = static_cast<GLint>(attribute.components);
+        GLenum type = GL_FLOAT;
+        GLboolean normalized = GL_TRUE;
+        switch (attribute.format) {
+            case VertexFormat::Float: normalized = GL_FALSE; break;
+            case VertexFormat::Half:
+                type = GL_HALF_FLOAT;
+                normalized = GL_FALSE;
+                break;
+            case VertexFormat::Unorm16: type = GL_UNSIGNED_SHORT; break;
+            case VertexFormat::Snorm16: type = GL_SHORT; break;
+            case VertexFormat::Int2_10_10_10:
+                type = GL_INT_2_10_10_10_REV;
+                size = 4;
+                break;
+            case VertexFormat::Octahedral8:
+                type = GL_BYTE;
+                size = 2;
+                break;
+            case VertexFormat::Octahedral16:
+                type = GL_SHORT;
+                size = 2;
+                break;
+        }
+        glVertexAttribPointer(location, size, type, normalized, stride_,
+                              (void *)(uintptr_t)offsets_[location]);
+        glEnableVertexAttribArray(location);
+    }
+}
+
+ShaderDefines VertexLayout::defines() const
+{
+    if (attributes_.size() > 1 && (attributes_[1].format == VertexFormat::Octahedral8 ||
+                                   attributes_[1].format == VertexFormat::Octahedral16))
+        return {{"OCTAHEDRAL_NORMALS", "1"}};
+    return {};
+}